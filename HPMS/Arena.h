@@ -0,0 +1,102 @@
+/*
+ * HPMS Arena Allocator - Per-Run Bump Allocation
+ *
+ * A scenario sizes one arena up front for its workload and scratch data.
+ * Allocation is a pointer bump; nothing is freed individually.
+ * Between algorithm runs the arena is rewound to a mark (or reset), so the
+ * same memory is reused instead of being freed and reallocated.
+ *
+ * If a run needs more than the first block holds, another block twice the
+ * size is chained on. Blocks are kept across rewinds, so the steady state
+ * is still zero allocations per run.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#define ARENA_ALIGN 16
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t capacity;
+    size_t used;
+    _Alignas(ARENA_ALIGN) unsigned char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    ArenaBlock *current;
+} Arena;
+
+/* Position to rewind to; everything allocated after it is discarded */
+typedef struct {
+    ArenaBlock *block;
+    size_t used;
+} ArenaMark;
+
+static inline ArenaBlock *arena_new_block(size_t capacity) {
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + capacity);
+    if (block == NULL) return NULL;
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+/* Returns 0 on success, -1 if the first block cannot be allocated */
+static inline int arena_init(Arena *arena, size_t capacity) {
+    arena->head = arena->current = arena_new_block(capacity);
+    return arena->head != NULL ? 0 : -1;
+}
+
+static inline void arena_free(Arena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = arena->current = NULL;
+}
+
+/* Returns NULL only if a new block is needed and malloc fails */
+static inline void *arena_alloc(Arena *arena, size_t bytes) {
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ArenaBlock *block = arena->current;
+    while (block->used + bytes > block->capacity) {
+        if (block->next == NULL) {
+            size_t capacity = block->capacity * 2;
+            if (capacity < bytes) capacity = bytes;
+            block->next = arena_new_block(capacity);
+            if (block->next == NULL) return NULL;
+        }
+        block = block->next;
+        block->used = 0;  // blocks after the current one hold no live data
+    }
+
+    arena->current = block;
+    void *ptr = block->data + block->used;
+    block->used += bytes;
+    return ptr;
+}
+
+static inline ArenaMark arena_mark(const Arena *arena) {
+    ArenaMark mark = {arena->current, arena->current->used};
+    return mark;
+}
+
+static inline void arena_rewind(Arena *arena, ArenaMark mark) {
+    arena->current = mark.block;
+    arena->current->used = mark.used;
+}
+
+static inline void arena_reset(Arena *arena) {
+    arena->current = arena->head;
+    arena->head->used = 0;
+}
+
+#endif
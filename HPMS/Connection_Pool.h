@@ -0,0 +1,356 @@
+/*
+ * HPMS Connection Pool - Fixed Workers Over a Bounded Resource Pool
+ *
+ * Callers submit requests instead of creating a thread per request. A
+ * fixed set of worker threads takes requests from lock-free MPMC rings
+ * (Ring_Buffer.h), one per priority class, acquires one of the pool's
+ * connections and runs the request with it.
+ *
+ * - Fairness: workers serve classes by weighted round robin (POOL_WEIGHTS,
+ *   4:2:1), so critical requests get most of the slots but a flood of
+ *   them never starves routine work.
+ * - Deadlines: every request carries an absolute deadline. One still
+ *   queued when its deadline passes runs with connection -1, so the caller
+ *   can report the timeout, and never ties up a connection.
+ * - pool_acquire / pool_release hand out connections directly, with a
+ *   timeout, for code that does its own threading.
+ *
+ * The same API builds on POSIX (pthreads, semaphores) and Win32 (threads,
+ * semaphores, critical sections).
+ */
+
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#endif
+
+#include "Latency_Histogram.h"
+#include "Ring_Buffer.h"
+
+#define POOL_CLASSES        3          // 0 = critical, 1 = urgent, 2 = routine
+#define POOL_MAX_WORKERS    256
+#define POOL_MAX_CONNECTIONS 256
+#define POOL_WEIGHTS        {4, 2, 1}  // dequeue share per class when all are backlogged
+
+/* ---------------------------------------------------------------------- */
+/* Platform layer                                                          */
+/* ---------------------------------------------------------------------- */
+
+#ifdef _WIN32
+typedef HANDLE pool_thread_t;
+typedef HANDLE pool_sem_t;
+typedef CRITICAL_SECTION pool_mutex_t;
+
+static inline int pool_sem_init(pool_sem_t *s, int count) {
+    *s = CreateSemaphore(NULL, count, 0x7fffffff, NULL);
+    return *s != NULL ? 0 : -1;
+}
+static inline void pool_sem_destroy(pool_sem_t *s) { CloseHandle(*s); }
+static inline void pool_sem_post(pool_sem_t *s) { ReleaseSemaphore(*s, 1, NULL); }
+static inline void pool_sem_wait(pool_sem_t *s) { WaitForSingleObject(*s, INFINITE); }
+/* 0 if acquired, -1 if timeout_ms passed first */
+static inline int pool_sem_timedwait(pool_sem_t *s, int64_t timeout_ms) {
+    return WaitForSingleObject(*s, timeout_ms > 0 ? (DWORD)timeout_ms : 0) == WAIT_OBJECT_0 ? 0 : -1;
+}
+static inline void pool_mutex_init(pool_mutex_t *m) { InitializeCriticalSection(m); }
+static inline void pool_mutex_destroy(pool_mutex_t *m) { DeleteCriticalSection(m); }
+static inline void pool_mutex_lock(pool_mutex_t *m) { EnterCriticalSection(m); }
+static inline void pool_mutex_unlock(pool_mutex_t *m) { LeaveCriticalSection(m); }
+
+static inline int64_t pool_now_us(void) {
+    static LARGE_INTEGER freq;          // fixed at boot: read it once
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (int64_t)(now.QuadPart / freq.QuadPart * 1000000 +
+                     now.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+}
+#else
+typedef pthread_t pool_thread_t;
+typedef sem_t pool_sem_t;
+typedef pthread_mutex_t pool_mutex_t;
+
+static inline int pool_sem_init(pool_sem_t *s, int count) { return sem_init(s, 0, count); }
+static inline void pool_sem_destroy(pool_sem_t *s) { sem_destroy(s); }
+static inline void pool_sem_post(pool_sem_t *s) { sem_post(s); }
+static inline void pool_sem_wait(pool_sem_t *s) {
+    while (sem_wait(s) != 0 && errno == EINTR) {}
+}
+/* 0 if acquired, -1 if timeout_ms passed first */
+static inline int pool_sem_timedwait(pool_sem_t *s, int64_t timeout_ms) {
+    if (timeout_ms <= 0) return sem_trywait(s) == 0 ? 0 : -1;
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    int rc;
+    while ((rc = sem_timedwait(s, &deadline)) != 0 && errno == EINTR) {}
+    return rc == 0 ? 0 : -1;
+}
+static inline void pool_mutex_init(pool_mutex_t *m) { pthread_mutex_init(m, NULL); }
+static inline void pool_mutex_destroy(pool_mutex_t *m) { pthread_mutex_destroy(m); }
+static inline void pool_mutex_lock(pool_mutex_t *m) { pthread_mutex_lock(m); }
+static inline void pool_mutex_unlock(pool_mutex_t *m) { pthread_mutex_unlock(m); }
+
+static inline int64_t pool_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+static inline void pool_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* ---------------------------------------------------------------------- */
+/* Pool                                                                    */
+/* ---------------------------------------------------------------------- */
+
+/* Runs on a worker; connection is -1 if the deadline passed before a connection was free */
+typedef void (*PoolTask)(void *arg, int connection);
+
+typedef struct {
+    PoolTask task;
+    void *arg;
+    int64_t submitted_us;
+    int64_t deadline_us;
+    int priority_class;
+} PoolRequest;
+
+typedef struct {
+    long completed;
+    long expired;
+    LatencyHistogram wait_us;          // submit -> start, completed requests only
+} PoolClassStats;
+
+typedef struct ConnectionPool ConnectionPool;
+
+typedef struct {
+    ConnectionPool *pool;
+    pool_thread_t thread;
+    PoolClassStats stats[POOL_CLASSES];  // this worker's share, summed at shutdown
+} PoolWorker;
+
+struct ConnectionPool {
+    RingBuffer *queues[POOL_CLASSES];
+    pool_sem_t queued;                 // one count per request sitting in a ring
+    pool_sem_t free_connections;       // one count per connection on the free stack
+    pool_mutex_t free_lock;
+    int free_stack[POOL_MAX_CONNECTIONS];
+    int free_top;
+    int connections;
+    PoolWorker *workers;
+    int worker_count;
+    _Atomic uint32_t turn;             // weighted round-robin cursor shared by the workers
+    uint8_t schedule[16];              // class order for one round, from POOL_WEIGHTS
+    int schedule_len;
+    _Atomic int stopping;
+    PoolClassStats totals[POOL_CLASSES];  // workers' counters, summed at shutdown
+};
+
+/* Direct checkout: a connection index, or -1 if none came free within timeout_ms */
+static inline int pool_acquire(ConnectionPool *pool, int64_t timeout_ms) {
+    if (pool_sem_timedwait(&pool->free_connections, timeout_ms) != 0) return -1;
+    pool_mutex_lock(&pool->free_lock);
+    int connection = pool->free_stack[--pool->free_top];
+    pool_mutex_unlock(&pool->free_lock);
+    return connection;
+}
+
+static inline void pool_release(ConnectionPool *pool, int connection) {
+    pool_mutex_lock(&pool->free_lock);
+    pool->free_stack[pool->free_top++] = connection;
+    pool_mutex_unlock(&pool->free_lock);
+    pool_sem_post(&pool->free_connections);
+}
+
+/*
+ * Next request by weighted round robin; the caller holds one count of
+ * pool->queued. Returns -1 only once the pool is stopping and drained.
+ */
+static inline int pool_take(ConnectionPool *pool, PoolRequest *request) {
+    uint32_t turn = atomic_fetch_add_explicit(&pool->turn, 1, memory_order_relaxed);
+    int first = pool->schedule[turn % pool->schedule_len];
+    for (;;) {
+        // Preferred class first, then the rest by priority, so no slot is wasted on an empty class
+        if (ring_pop(pool->queues[first], request) == 0) return 0;
+        for (int c = 0; c < POOL_CLASSES; c++)
+            if (c != first && ring_pop(pool->queues[c], request) == 0) return 0;
+        // Submissions end before shutdown, so a stopping pool with empty rings has no more work
+        if (atomic_load_explicit(&pool->stopping, memory_order_acquire)) return -1;
+        // Otherwise a producer has counted its request but is still copying it in
+        pool_pause();
+    }
+}
+
+static inline void pool_run_one(PoolWorker *worker, PoolRequest *request) {
+    ConnectionPool *pool = worker->pool;
+    PoolClassStats *stats = &worker->stats[request->priority_class];
+    int64_t now = pool_now_us();
+    int connection = now < request->deadline_us
+                         ? pool_acquire(pool, (request->deadline_us - now + 999) / 1000)
+                         : -1;
+    if (connection < 0) {
+        stats->expired++;
+        request->task(request->arg, -1);
+        return;
+    }
+    lh_record(&stats->wait_us, (uint64_t)(pool_now_us() - request->submitted_us));
+    request->task(request->arg, connection);
+    pool_release(pool, connection);
+    stats->completed++;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI pool_worker_main(LPVOID arg)
+#else
+static void *pool_worker_main(void *arg)
+#endif
+{
+    PoolWorker *worker = arg;
+    ConnectionPool *pool = worker->pool;
+    PoolRequest request;
+    for (;;) {
+        pool_sem_wait(&pool->queued);
+        if (pool_take(pool, &request) != 0) break;  // one of shutdown's extra counts
+        pool_run_one(worker, &request);
+    }
+    return 0;
+}
+
+/* Stop the workers started so far: each one takes an extra count and finds the rings empty */
+static inline void pool_stop_workers(ConnectionPool *pool) {
+    atomic_store_explicit(&pool->stopping, 1, memory_order_release);
+    for (int w = 0; w < pool->worker_count; w++) pool_sem_post(&pool->queued);
+    for (int w = 0; w < pool->worker_count; w++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool->workers[w].thread, INFINITE);
+        CloseHandle(pool->workers[w].thread);
+#else
+        pthread_join(pool->workers[w].thread, NULL);
+#endif
+    }
+}
+
+/* How far pool_init got, so a failure undoes exactly that much */
+#define POOL_INIT_QUEUES 0             // rings (some may be NULL)
+#define POOL_INIT_LOCK   1             // + free_lock
+#define POOL_INIT_QUEUED 2             // + queued semaphore
+#define POOL_INIT_SEMS   3             // + free_connections semaphore; workers per worker_count
+
+static inline int pool_init_failed(ConnectionPool *pool, int stage) {
+    if (stage >= POOL_INIT_SEMS) pool_stop_workers(pool);
+    free(pool->workers);
+    pool->workers = NULL;
+    for (int c = 0; c < POOL_CLASSES; c++) free(pool->queues[c]);
+    if (stage >= POOL_INIT_SEMS) pool_sem_destroy(&pool->free_connections);
+    if (stage >= POOL_INIT_QUEUED) pool_sem_destroy(&pool->queued);
+    if (stage >= POOL_INIT_LOCK) pool_mutex_destroy(&pool->free_lock);
+    return -1;
+}
+
+/*
+ * connections: size of the resource pool; workers: threads serving the
+ * queues (usually the same); queue_capacity: per class, a power of two.
+ * Returns 0, or -1 on bad arguments or allocation failure, with nothing
+ * left allocated or running.
+ */
+static inline int pool_init(ConnectionPool *pool, int connections, int workers, uint32_t queue_capacity) {
+    static const int weights[POOL_CLASSES] = POOL_WEIGHTS;
+    if (connections < 1 || connections > POOL_MAX_CONNECTIONS || workers < 1 ||
+        workers > POOL_MAX_WORKERS)
+        return -1;
+
+    memset(pool, 0, sizeof(*pool));
+    for (int c = 0; c < POOL_CLASSES; c++) {
+        pool->queues[c] = malloc(ring_bytes(queue_capacity, sizeof(PoolRequest)));
+        if (pool->queues[c] == NULL || ring_init(pool->queues[c], queue_capacity, sizeof(PoolRequest)) != 0)
+            return pool_init_failed(pool, POOL_INIT_QUEUES);
+        for (int w = 0; w < weights[c]; w++) pool->schedule[pool->schedule_len++] = (uint8_t)c;
+    }
+    pool->connections = connections;
+    for (int i = 0; i < connections; i++) pool->free_stack[i] = connections - 1 - i;
+    pool->free_top = connections;
+    pool_mutex_init(&pool->free_lock);
+    if (pool_sem_init(&pool->queued, 0) != 0) return pool_init_failed(pool, POOL_INIT_LOCK);
+    if (pool_sem_init(&pool->free_connections, connections) != 0)
+        return pool_init_failed(pool, POOL_INIT_QUEUED);
+
+    pool->workers = calloc(workers, sizeof(PoolWorker));
+    if (pool->workers == NULL) return pool_init_failed(pool, POOL_INIT_SEMS);
+    for (int w = 0; w < workers; w++) {
+        pool->workers[w].pool = pool;
+        for (int c = 0; c < POOL_CLASSES; c++) lh_init(&pool->workers[w].stats[c].wait_us);
+#ifdef _WIN32
+        pool->workers[w].thread = CreateThread(NULL, 0, pool_worker_main, &pool->workers[w], 0, NULL);
+        if (pool->workers[w].thread == NULL) return pool_init_failed(pool, POOL_INIT_SEMS);
+#else
+        if (pthread_create(&pool->workers[w].thread, NULL, pool_worker_main, &pool->workers[w]) != 0)
+            return pool_init_failed(pool, POOL_INIT_SEMS);
+#endif
+        pool->worker_count++;
+    }
+    return 0;
+}
+
+/*
+ * Queue task(arg, connection) in a priority class, to start within
+ * timeout_ms. Returns 0, or -1 if that class's queue is full.
+ */
+static inline int pool_submit(ConnectionPool *pool, int priority_class, PoolTask task, void *arg,
+                              int64_t timeout_ms) {
+    if (priority_class < 0) priority_class = 0;
+    if (priority_class >= POOL_CLASSES) priority_class = POOL_CLASSES - 1;
+    PoolRequest request = {task, arg, pool_now_us(), 0, priority_class};
+    request.deadline_us = request.submitted_us + timeout_ms * 1000;
+    if (ring_push(pool->queues[priority_class], &request) != 0) return -1;
+    pool_sem_post(&pool->queued);
+    return 0;
+}
+
+/* Totals for one class across all workers; valid after pool_shutdown */
+static inline void pool_stats(const ConnectionPool *pool, int priority_class, PoolClassStats *out) {
+    *out = pool->totals[priority_class];
+}
+
+/* Finish every queued request, then stop the workers and free the pool; call after the last submit */
+static inline void pool_shutdown(ConnectionPool *pool) {
+    pool_stop_workers(pool);
+    for (int c = 0; c < POOL_CLASSES; c++) {
+        PoolClassStats *total = &pool->totals[c];
+        total->completed = total->expired = 0;
+        lh_init(&total->wait_us);
+        for (int w = 0; w < pool->worker_count; w++) {
+            const PoolClassStats *s = &pool->workers[w].stats[c];
+            total->completed += s->completed;
+            total->expired += s->expired;
+            lh_merge(&total->wait_us, &s->wait_us);
+        }
+    }
+    free(pool->workers);
+    pool->workers = NULL;
+    for (int c = 0; c < POOL_CLASSES; c++) free(pool->queues[c]);
+    pool_sem_destroy(&pool->queued);
+    pool_sem_destroy(&pool->free_connections);
+    pool_mutex_destroy(&pool->free_lock);
+}
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ * HPMS CPU Isolation - Reserved Cores and Priority Classes for Emergency Work
+ *
+ * An IsoPlan splits the CPUs the process may run on (its affinity mask,
+ * which taskset, cgroups or a job object may have narrowed) in two:
+ *
+ * - emergency cores (the top `reserved` CPUs; CPU 0 usually takes the most
+ *   interrupts, so it stays with background work), where emergency-class
+ *   threads run at real-time priority (SCHED_FIFO on Linux,
+ *   THREAD_PRIORITY_TIME_CRITICAL in a HIGH_PRIORITY_CLASS process on
+ *   Windows), falling back to the best priority the process is allowed;
+ * - the remaining cores, where background threads (backups, reports) run
+ *   at idle priority and can never be scheduled onto an emergency core.
+ *
+ * With too few CPUs to reserve any, both classes share every CPU and only
+ * the priority split remains (plan.shared is set).
+ *
+ * A real-time thread that spins forever would starve its core, so
+ * emergency threads run under an IsoWatchdog: the thread calls
+ * iso_heartbeat() once per unit of work, and a watchdog thread at the
+ * highest real-time priority demotes it to normal scheduling if no
+ * heartbeat arrives within the timeout, and restores it once heartbeats
+ * resume.
+ *
+ * Linux builds need _GNU_SOURCE defined before the first #include
+ * (cpu_set_t, SCHED_IDLE). Up to 64 CPUs are handled.
+ */
+
+#ifndef CPU_ISOLATION_H
+#define CPU_ISOLATION_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+#define ISO_RT_PRIORITY 50         // SCHED_FIFO priority for emergency threads
+
+typedef enum { ISO_EMERGENCY, ISO_BACKGROUND } IsoClass;
+
+/* What a thread actually got: best first */
+typedef enum { ISO_PRIO_REALTIME, ISO_PRIO_HIGH, ISO_PRIO_NORMAL, ISO_PRIO_LOW, ISO_PRIO_IDLE } IsoPriority;
+
+typedef struct {
+    int cpus;
+    uint64_t emergency_mask;       // bit n = CPU n
+    uint64_t background_mask;
+    int shared;                    // too few CPUs: both masks are every CPU
+} IsoPlan;
+
+static inline const char *iso_priority_name(IsoPriority p) {
+    static const char *names[] = {"real-time", "high", "normal", "low", "idle"};
+    return names[p];
+}
+
+/* ---------------------------------------------------------------------- */
+/* Platform layer                                                          */
+/* ---------------------------------------------------------------------- */
+
+#ifdef _WIN32
+typedef HANDLE iso_thread_t;
+#define ISO_THREAD_FN(name) DWORD WINAPI name(LPVOID arg)
+#define ISO_THREAD_RETURN   return 0
+
+static inline int iso_thread_start(iso_thread_t *t, LPTHREAD_START_ROUTINE fn, void *arg) {
+    *t = CreateThread(NULL, 0, fn, arg, 0, NULL);
+    return *t != NULL ? 0 : -1;
+}
+static inline void iso_thread_join(iso_thread_t t) {
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+static inline unsigned long iso_pid(void) { return GetCurrentProcessId(); }
+
+/* CPUs this process may run on (bit n = CPU n) */
+static inline uint64_t iso_allowed_mask(void) {
+    DWORD_PTR process, system;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process, &system) && process != 0)
+        return (uint64_t)process;
+    return 1;
+}
+
+static inline int64_t iso_now_ns(void) {
+    LARGE_INTEGER now, freq;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&freq);
+    return (int64_t)(now.QuadPart / freq.QuadPart * 1000000000 +
+                     now.QuadPart % freq.QuadPart * 1000000000 / freq.QuadPart);
+}
+
+/* Sleep() has millisecond granularity: sleep most of the way, then yield until the deadline */
+static inline void iso_sleep_until(int64_t deadline_ns) {
+    int64_t left;
+    while ((left = deadline_ns - iso_now_ns()) > 0) {
+        if (left > 2000000) Sleep((DWORD)(left / 1000000 - 1));
+        else SwitchToThread();
+    }
+}
+
+static inline int iso_pin_self(uint64_t mask) {
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)mask) != 0 ? 0 : -1;
+}
+
+static inline IsoPriority iso_set_class(IsoClass cls) {
+    if (cls == ISO_EMERGENCY) {
+        SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
+        return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL) ? ISO_PRIO_REALTIME
+                                                                                       : ISO_PRIO_NORMAL;
+    }
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE) ? ISO_PRIO_IDLE : ISO_PRIO_NORMAL;
+}
+#else
+typedef pthread_t iso_thread_t;
+#define ISO_THREAD_FN(name) void *name(void *arg)
+#define ISO_THREAD_RETURN   return NULL
+
+static inline int iso_thread_start(iso_thread_t *t, void *(*fn)(void *), void *arg) {
+    return pthread_create(t, NULL, fn, arg) == 0 ? 0 : -1;
+}
+static inline void iso_thread_join(iso_thread_t t) { pthread_join(t, NULL); }
+static inline unsigned long iso_pid(void) { return (unsigned long)getpid(); }
+
+/* CPUs this process may run on (bit n = CPU n, CPUs past 63 are ignored) */
+static inline uint64_t iso_allowed_mask(void) {
+    cpu_set_t set;
+    uint64_t mask = 0;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        for (int cpu = 0; cpu < 64; cpu++)
+            if (CPU_ISSET(cpu, &set)) mask |= 1ull << cpu;
+    if (mask == 0) mask = 1;
+    return mask;
+}
+
+static inline int64_t iso_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void iso_sleep_until(int64_t deadline_ns) {
+    struct timespec ts = {deadline_ns / 1000000000, deadline_ns % 1000000000};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+}
+
+/* Restrict the calling thread to the CPUs in mask; returns 0 or -1 */
+static inline int iso_pin_self(uint64_t mask) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < 64; cpu++)
+        if (mask >> cpu & 1) CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+}
+
+/* Give the calling thread its class's priority, or the nearest one allowed */
+static inline IsoPriority iso_set_class(IsoClass cls) {
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    if (cls == ISO_EMERGENCY) {
+        struct sched_param param = {.sched_priority = ISO_RT_PRIORITY};
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) return ISO_PRIO_REALTIME;
+        if (setpriority(PRIO_PROCESS, tid, -10) == 0) return ISO_PRIO_HIGH;  // no CAP_SYS_NICE for RT
+        return ISO_PRIO_NORMAL;
+    }
+    struct sched_param param = {.sched_priority = 0};
+    if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) == 0) return ISO_PRIO_IDLE;
+    if (setpriority(PRIO_PROCESS, tid, 19) == 0) return ISO_PRIO_LOW;
+    return ISO_PRIO_NORMAL;
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Plan                                                                    */
+/* ---------------------------------------------------------------------- */
+
+/* Reserve the top `reserved` allowed CPUs for emergency work; the rest are background */
+static inline void iso_plan(IsoPlan *plan, int reserved) {
+    uint64_t all = iso_allowed_mask();
+    plan->cpus = 0;
+    for (int cpu = 0; cpu < 64; cpu++) plan->cpus += (int)(all >> cpu & 1);
+
+    plan->shared = reserved < 1 || reserved >= plan->cpus;
+    if (plan->shared) {
+        plan->emergency_mask = plan->background_mask = all;
+        return;
+    }
+    // Allowed CPUs need not be 0..n-1: take the highest `reserved` set bits
+    plan->emergency_mask = 0;
+    for (int cpu = 63, taken = 0; cpu >= 0 && taken < reserved; cpu--)
+        if (all >> cpu & 1) {
+            plan->emergency_mask |= 1ull << cpu;
+            taken++;
+        }
+    plan->background_mask = all & ~plan->emergency_mask;
+}
+
+static inline void iso_mask_string(uint64_t mask, char *out, size_t size) {
+    size_t used = 0;
+    out[0] = '\0';
+    for (int cpu = 0; cpu < 64 && used + 4 < size; cpu++)
+        if (mask >> cpu & 1) used += (size_t)snprintf(out + used, size - used, used ? ",%d" : "%d", cpu);
+}
+
+/*
+ * Pin the calling thread to its class's cores and set its priority (stored
+ * in *priority even if pinning fails). Returns 0, or -1 if the thread could
+ * not be pinned and may still run on the other class's cores.
+ */
+static inline int iso_enter_class(const IsoPlan *plan, IsoClass cls, IsoPriority *priority) {
+    int pinned = iso_pin_self(cls == ISO_EMERGENCY ? plan->emergency_mask : plan->background_mask);
+    *priority = iso_set_class(cls);
+    return pinned == 0 ? 0 : -1;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Watchdog                                                                */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+    _Atomic uint64_t heartbeat;
+    _Atomic int stop;
+    _Atomic int demoted;           // currently demoted
+    _Atomic long demotions;
+    int timeout_ms;
+    uint64_t cpu_mask;             // watchdog runs where the watched thread runs
+    int64_t last_demotion_ns;      // how long the thread had gone silent when demoted
+    iso_thread_t watched;
+    iso_thread_t thread;
+} IsoWatchdog;
+
+static inline void iso_heartbeat(IsoWatchdog *wd) {
+    atomic_fetch_add_explicit(&wd->heartbeat, 1, memory_order_relaxed);
+}
+
+static inline void iso_demote(IsoWatchdog *wd, int demote) {
+#ifdef _WIN32
+    SetThreadPriority(wd->watched, demote ? THREAD_PRIORITY_NORMAL : THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    struct sched_param param = {.sched_priority = demote ? 0 : ISO_RT_PRIORITY};
+    pthread_setschedparam(wd->watched, demote ? SCHED_OTHER : SCHED_FIFO, &param);
+#endif
+    atomic_store(&wd->demoted, demote);
+}
+
+static ISO_THREAD_FN(iso_watchdog_main) {
+    IsoWatchdog *wd = arg;
+    // Highest priority on the watched thread's cores, so a runaway cannot starve the watchdog
+    iso_pin_self(wd->cpu_mask);
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    struct sched_param param = {.sched_priority = sched_get_priority_max(SCHED_FIFO)};
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+#endif
+
+    uint64_t seen = atomic_load(&wd->heartbeat);
+    int64_t last_beat = iso_now_ns();
+    int64_t check_ns = (int64_t)wd->timeout_ms * 1000000 / 4;
+    while (!atomic_load(&wd->stop)) {
+        iso_sleep_until(iso_now_ns() + check_ns);
+        uint64_t beat = atomic_load(&wd->heartbeat);
+        int64_t now = iso_now_ns();
+        if (beat != seen) {
+            seen = beat;
+            last_beat = now;
+            if (atomic_load(&wd->demoted)) iso_demote(wd, 0);  // working again: restore
+        } else if (!atomic_load(&wd->demoted) && now - last_beat >= (int64_t)wd->timeout_ms * 1000000) {
+            wd->last_demotion_ns = now - last_beat;
+            iso_demote(wd, 1);
+            atomic_fetch_add(&wd->demotions, 1);
+        }
+    }
+    ISO_THREAD_RETURN;
+}
+
+/* Watch the calling (emergency) thread; it must iso_heartbeat() at least every timeout_ms */
+static inline int iso_watchdog_start(IsoWatchdog *wd, const IsoPlan *plan, int timeout_ms) {
+    atomic_init(&wd->heartbeat, 0);
+    atomic_init(&wd->stop, 0);
+    atomic_init(&wd->demoted, 0);
+    atomic_init(&wd->demotions, 0);
+    wd->timeout_ms = timeout_ms;
+    wd->cpu_mask = plan->emergency_mask;
+    wd->last_demotion_ns = 0;
+#ifdef _WIN32
+    DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &wd->watched, 0,
+                    FALSE, DUPLICATE_SAME_ACCESS);
+#else
+    wd->watched = pthread_self();
+#endif
+    return iso_thread_start(&wd->thread, iso_watchdog_main, wd);
+}
+
+static inline void iso_watchdog_stop(IsoWatchdog *wd) {
+    atomic_store(&wd->stop, 1);
+    iso_thread_join(wd->thread);
+#ifdef _WIN32
+    CloseHandle(wd->watched);
+#endif
+}
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * HPMS Latency Histogram - Fixed-Memory Log-Bucketed Percentiles
+ *
+ * HDR-style layout: values below LH_SUB_COUNT get one bucket each, and every
+ * power of two above that is split into LH_SUB_COUNT linear sub-buckets, so
+ * a bucket is never wider than 1/LH_SUB_COUNT (~3%) of the values in it.
+ * Memory is fixed (LH_BUCKETS counters) however many values are recorded,
+ * and two histograms merge by adding their counters, which lets parallel
+ * workers each record locally and combine at the end.
+ *
+ * Values are unsigned integers in whatever unit the caller uses (simulated
+ * seconds, nanoseconds); anything at or above 2^LH_VALUE_BITS lands in the
+ * last bucket.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define LH_SUB_BITS   5
+#define LH_SUB_COUNT  (1 << LH_SUB_BITS)
+#define LH_VALUE_BITS 32
+#define LH_BUCKETS    (LH_SUB_COUNT * (LH_VALUE_BITS - LH_SUB_BITS + 1))
+
+typedef struct {
+    uint32_t counts[LH_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} LatencyHistogram;
+
+static inline void lh_init(LatencyHistogram *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+static inline int lh_bucket(uint64_t value) {
+    if (value < LH_SUB_COUNT) return (int)value;
+    if (value >> LH_VALUE_BITS) return LH_BUCKETS - 1;
+    int msb = 63 - __builtin_clzll(value);
+    int sub = (int)(value >> (msb - LH_SUB_BITS)) & (LH_SUB_COUNT - 1);
+    return LH_SUB_COUNT + (msb - LH_SUB_BITS) * LH_SUB_COUNT + sub;
+}
+
+/* Largest value that maps to bucket */
+static inline uint64_t lh_bucket_high(int bucket) {
+    if (bucket < LH_SUB_COUNT) return (uint64_t)bucket;
+    int msb = (bucket - LH_SUB_COUNT) / LH_SUB_COUNT + LH_SUB_BITS;
+    uint64_t sub = (uint64_t)((bucket - LH_SUB_COUNT) % LH_SUB_COUNT);
+    uint64_t low = ((uint64_t)1 << msb) | (sub << (msb - LH_SUB_BITS));
+    return low + ((uint64_t)1 << (msb - LH_SUB_BITS)) - 1;
+}
+
+static inline void lh_record(LatencyHistogram *h, uint64_t value) {
+    h->counts[lh_bucket(value)]++;
+    h->total++;
+    if (value > h->max) h->max = value;
+}
+
+/* dst += src */
+static inline void lh_merge(LatencyHistogram *dst, const LatencyHistogram *src) {
+    for (int b = 0; b < LH_BUCKETS; b++) dst->counts[b] += src->counts[b];
+    dst->total += src->total;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+/*
+ * Value at percentile (0-100]: the top of the bucket holding that rank,
+ * capped at the largest recorded value. 0 if the histogram is empty.
+ */
+static inline uint64_t lh_percentile(const LatencyHistogram *h, double percentile) {
+    if (h->total == 0) return 0;
+    double exact = percentile / 100.0 * h->total;
+    uint64_t rank = (uint64_t)exact;
+    if (rank < exact || rank < 1) rank++;  // ceiling, at least the first value
+    if (rank > h->total) rank = h->total;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < LH_BUCKETS; b++) {
+        seen += h->counts[b];
+        if (seen >= rank) {
+            uint64_t high = lh_bucket_high(b);
+            return high < h->max ? high : h->max;
+        }
+    }
+    return h->max;
+}
+
+#endif
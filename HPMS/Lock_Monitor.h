@@ -0,0 +1,313 @@
+/*
+ * HPMS Lock Monitor - Contention Statistics and Live Deadlock Detection
+ *
+ * A MonitoredMutex is a pthread mutex with a name. While monitoring is on,
+ * every acquisition records
+ *
+ * - how long the caller waited for it, and how long it was then held, in
+ *   per-lock histograms (Latency_Histogram.h, microseconds); and
+ * - who holds it and who is waiting for what: a wait-for graph with one
+ *   edge per blocked thread (thread -> lock -> owning thread).
+ *
+ * A thread about to block follows the edges from the lock it wants. If it
+ * comes back to itself the wait would close a cycle: the deadlock is
+ * reported (lm_cycle_handler) before the thread goes to sleep in it. Of
+ * two threads that close a cycle together, the later to publish its wait
+ * always sees the other's, so every cycle is reported.
+ *
+ * Statistics are written only by the thread holding the lock, so they need
+ * no extra synchronization. Waits and holds still in progress (the locks
+ * of a deadlock, say) are timed from when they began, kept in the thread
+ * slot and the lock, so reports show them too. A thread's slot returns to
+ * the table when the thread exits, so thread turnover does not use it up.
+ * With monitoring off (lm_set_enabled(0)) lock and unlock cost one
+ * predictable branch over the plain pthread calls.
+ *
+ * lm_report prints the locks ordered by total time threads spent waiting
+ * for them: the first line is the lock costing the most latency.
+ */
+
+#ifndef LOCK_MONITOR_H
+#define LOCK_MONITOR_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "Latency_Histogram.h"
+
+#define LM_MAX_LOCKS   64
+#define LM_MAX_THREADS 64
+#define LM_NAME_LEN    32
+
+typedef struct {
+    pthread_mutex_t mutex;
+    const char *name;
+    int id;
+    _Atomic int owner;               // thread id holding it, -1 if free
+    _Atomic int64_t acquired_ns;     // when the current hold began, 0 if free
+    long acquisitions;
+    long contended;                  // acquisitions that had to wait
+    int64_t total_wait_us;
+    LatencyHistogram wait_us;
+    LatencyHistogram hold_us;
+} MonitoredMutex;
+
+typedef struct {
+    char name[LM_NAME_LEN];
+    _Atomic int in_use;              // claimed by a live thread
+    _Atomic int waiting_on;          // lock id this thread is blocked on, -1 if none
+    _Atomic int64_t wait_start_ns;   // when that wait began, 0 if none
+} LmThread;
+
+/* Called with the cycle as alternating thread and lock ids: t0 l0 t1 l1 ... (t(i) waits for l(i)) */
+typedef void (*LmCycleHandler)(const int *threads, const int *locks, int length);
+
+static _Atomic int lm_enabled = 1;
+static MonitoredMutex *lm_locks[LM_MAX_LOCKS];
+static _Atomic int lm_lock_count;
+static LmThread lm_threads[LM_MAX_THREADS];
+static _Atomic long lm_cycles;
+static _Thread_local int lm_self = -1;
+static pthread_key_t lm_slot_key;    // per-thread slot + 1, released by the key's destructor
+static pthread_once_t lm_slot_once = PTHREAD_ONCE_INIT;
+
+static inline int64_t lm_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void lm_set_enabled(int enabled) {
+    atomic_store_explicit(&lm_enabled, enabled, memory_order_relaxed);
+}
+
+/* Deadlocks found so far */
+static inline long lm_cycles_detected(void) {
+    return atomic_load(&lm_cycles);
+}
+
+/*
+ * Thread exit: hand the slot back. A thread that exits holding a monitored
+ * lock leaves the lock's owner pointing at a slot someone else may reuse.
+ */
+static void lm_release_slot(void *slot) {
+    LmThread *t = &lm_threads[(int)(intptr_t)slot - 1];
+    atomic_store(&t->waiting_on, -1);
+    atomic_store(&t->wait_start_ns, 0);
+    atomic_store(&t->in_use, 0);
+}
+
+static void lm_create_slot_key(void) {
+    pthread_key_create(&lm_slot_key, lm_release_slot);
+}
+
+/* Name the calling thread in reports (unnamed threads become "thread-N") */
+static inline int lm_thread_name(const char *name) {
+    if (lm_self < 0) {
+        pthread_once(&lm_slot_once, lm_create_slot_key);
+        for (int i = 0; i < LM_MAX_THREADS && lm_self < 0; i++) {
+            int free_slot = 0;
+            if (atomic_compare_exchange_strong(&lm_threads[i].in_use, &free_slot, 1)) lm_self = i;
+        }
+        if (lm_self >= 0) pthread_setspecific(lm_slot_key, (void *)(intptr_t)(lm_self + 1));
+        else lm_self = LM_MAX_THREADS - 1;  // all live: extra threads share the last one
+        atomic_store(&lm_threads[lm_self].waiting_on, -1);
+        atomic_store(&lm_threads[lm_self].wait_start_ns, 0);
+    }
+    if (name != NULL) snprintf(lm_threads[lm_self].name, LM_NAME_LEN, "%s", name);
+    else snprintf(lm_threads[lm_self].name, LM_NAME_LEN, "thread-%d", lm_self);
+    return lm_self;
+}
+
+static inline int lm_self_id(void) {
+    return lm_self >= 0 ? lm_self : lm_thread_name(NULL);
+}
+
+/* How long thread t has been blocked so far, 0 if it is running */
+static inline int64_t lm_waiting_ns(int t, int64_t now) {
+    int64_t start = atomic_load_explicit(&lm_threads[t].wait_start_ns, memory_order_relaxed);
+    return start != 0 && now > start ? now - start : 0;
+}
+
+/* How long m has been held so far, 0 if it is free */
+static inline int64_t lm_held_ns(const MonitoredMutex *m, int64_t now) {
+    int64_t start = atomic_load_explicit(&m->acquired_ns, memory_order_relaxed);
+    return start != 0 && now > start ? now - start : 0;
+}
+
+static inline void lm_print_cycle(const int *threads, const int *locks, int length) {
+    int64_t now = lm_now_ns();
+    printf("\n[LockMonitor] *** DEADLOCK: wait-for cycle of %d threads ***\n", length);
+    for (int i = 0; i < length; i++)
+        printf("[LockMonitor]   %s waits for '%s' (%.1f ms so far), held by %s for %.1f ms\n",
+               lm_threads[threads[i]].name, lm_locks[locks[i]]->name, lm_waiting_ns(threads[i], now) / 1e6,
+               lm_threads[threads[(i + 1) % length]].name, lm_held_ns(lm_locks[locks[i]], now) / 1e6);
+}
+
+static LmCycleHandler lm_cycle_handler = lm_print_cycle;
+
+/* Returns 0, or -1 if LM_MAX_LOCKS locks are already registered */
+static inline int lm_mutex_init(MonitoredMutex *m, const char *name) {
+    int id = atomic_fetch_add(&lm_lock_count, 1);
+    if (id >= LM_MAX_LOCKS) {
+        atomic_fetch_sub(&lm_lock_count, 1);
+        return -1;
+    }
+    pthread_mutex_init(&m->mutex, NULL);
+    m->name = name;
+    m->id = id;
+    atomic_init(&m->owner, -1);
+    atomic_init(&m->acquired_ns, 0);
+    m->acquisitions = 0;
+    m->contended = 0;
+    m->total_wait_us = 0;
+    lh_init(&m->wait_us);
+    lh_init(&m->hold_us);
+    lm_locks[id] = m;
+    return 0;
+}
+
+static inline void lm_mutex_destroy(MonitoredMutex *m) {
+    pthread_mutex_destroy(&m->mutex);
+}
+
+/* self is about to wait for lock: follow the wait-for edges and report a cycle back to self */
+static inline void lm_check_cycle(int self, const MonitoredMutex *lock) {
+    int threads[LM_MAX_THREADS], locks[LM_MAX_THREADS];
+    int length = 0;
+    int waiting_for = lock->id;
+
+    threads[length] = self;
+    while (length < LM_MAX_THREADS) {
+        locks[length++] = waiting_for;
+        int owner = atomic_load(&lm_locks[waiting_for]->owner);
+        if (owner < 0) return;              // free, or being taken: no cycle through here
+        if (owner == self) {
+            atomic_fetch_add(&lm_cycles, 1);
+            lm_cycle_handler(threads, locks, length);
+            return;
+        }
+        if (length == LM_MAX_THREADS) return;
+        waiting_for = atomic_load(&lm_threads[owner].waiting_on);
+        if (waiting_for < 0) return;        // owner is running, it will release
+        threads[length] = owner;
+    }
+}
+
+static inline void lm_lock(MonitoredMutex *m) {
+    if (!atomic_load_explicit(&lm_enabled, memory_order_relaxed)) {
+        pthread_mutex_lock(&m->mutex);
+        return;
+    }
+    int self = lm_self_id();
+    int64_t waited_us = 0;
+    int contended = pthread_mutex_trylock(&m->mutex) != 0;
+    if (contended) {
+        int64_t start = lm_now_ns();  // the uncontended path reads the clock once, below
+        atomic_store_explicit(&lm_threads[self].wait_start_ns, start, memory_order_relaxed);
+        atomic_store(&lm_threads[self].waiting_on, m->id);
+        lm_check_cycle(self, m);
+        pthread_mutex_lock(&m->mutex);
+        atomic_store(&lm_threads[self].waiting_on, -1);
+        atomic_store_explicit(&lm_threads[self].wait_start_ns, 0, memory_order_relaxed);
+        waited_us = (lm_now_ns() - start) / 1000;
+    }
+    atomic_store(&m->owner, self);
+
+    // We hold the lock: the counters are ours alone
+    atomic_store_explicit(&m->acquired_ns, lm_now_ns(), memory_order_relaxed);
+    m->acquisitions++;
+    m->contended += contended;
+    m->total_wait_us += waited_us;
+    lh_record(&m->wait_us, (uint64_t)waited_us);
+}
+
+static inline void lm_unlock(MonitoredMutex *m) {
+    int64_t acquired = atomic_load_explicit(&m->acquired_ns, memory_order_relaxed);
+    if (acquired != 0) {
+        lh_record(&m->hold_us, (uint64_t)((lm_now_ns() - acquired) / 1000));
+        atomic_store_explicit(&m->acquired_ns, 0, memory_order_relaxed);
+        atomic_store(&m->owner, -1);
+    }
+    pthread_mutex_unlock(&m->mutex);
+}
+
+/* Zero every lock's counters; call while no monitored lock is held */
+static inline void lm_reset(void) {
+    for (int i = 0; i < atomic_load(&lm_lock_count); i++) {
+        MonitoredMutex *m = lm_locks[i];
+        m->acquisitions = m->contended = 0;
+        m->total_wait_us = 0;
+        lh_init(&m->wait_us);
+        lh_init(&m->hold_us);
+    }
+}
+
+/*
+ * Waits on lock id still in progress: their sum and the longest, in
+ * microseconds, each also recorded into waits unless it is NULL
+ */
+static inline int lm_pending_waits(int id, int64_t now, LatencyHistogram *waits, int64_t *total_us,
+                                   int64_t *longest_us) {
+    int waiters = 0;
+    *total_us = *longest_us = 0;
+    for (int t = 0; t < LM_MAX_THREADS; t++) {
+        if (!atomic_load(&lm_threads[t].in_use) || atomic_load(&lm_threads[t].waiting_on) != id) continue;
+        int64_t us = lm_waiting_ns(t, now) / 1000;
+        *total_us += us;
+        if (us > *longest_us) *longest_us = us;
+        if (waits != NULL) lh_record(waits, (uint64_t)us);
+        waiters++;
+    }
+    return waiters;
+}
+
+/*
+ * One line per lock, most total waiting first. A wait still in progress
+ * counts as a contended acquisition timed so far, so the locks of a
+ * deadlock show their waits; a lock held right now gets a second line
+ * with its holder and how long so far. Call while the locks are quiet,
+ * or stuck.
+ */
+static inline void lm_report(void) {
+    int order[LM_MAX_LOCKS];
+    int64_t pending_us[LM_MAX_LOCKS], longest_us[LM_MAX_LOCKS];
+    int waiters[LM_MAX_LOCKS];
+    int count = atomic_load(&lm_lock_count);
+    int64_t now = lm_now_ns();
+
+    for (int i = 0; i < count; i++) {
+        waiters[i] = lm_pending_waits(i, now, NULL, &pending_us[i], &longest_us[i]);
+        int64_t total = lm_locks[i]->total_wait_us + pending_us[i];
+        int j = i;
+        while (j > 0 && lm_locks[order[j - 1]]->total_wait_us + pending_us[order[j - 1]] < total) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    printf("%-22s %8s %9s %10s %10s %10s %10s %10s\n", "Lock", "Acquired", "Contended",
+           "Wait total", "Wait p99", "Wait max", "Hold p50", "Hold p99");
+    for (int i = 0; i < count; i++) {
+        int id = order[i];
+        const MonitoredMutex *m = lm_locks[id];
+        if (m->acquisitions == 0 && waiters[id] == 0) continue;
+        LatencyHistogram waits = m->wait_us;
+        lm_pending_waits(id, now, &waits, &pending_us[id], &longest_us[id]);
+        long attempts = m->acquisitions + waiters[id];
+        printf("%-22s %8ld %8.1f%% %8.1fms %8.2fms %8.2fms %8.2fms %8.2fms\n", m->name,
+               m->acquisitions, 100.0 * (m->contended + waiters[id]) / attempts,
+               (m->total_wait_us + pending_us[id]) / 1000.0, lh_percentile(&waits, 99) / 1000.0,
+               waits.max / 1000.0, lh_percentile(&m->hold_us, 50) / 1000.0, lh_percentile(&m->hold_us, 99) / 1000.0);
+        int owner = atomic_load(&m->owner);
+        if (owner >= 0)
+            printf("%-22s   held by %s for %.2fms so far, %d waiting (longest %.2fms)\n", "",
+                   lm_threads[owner].name, lm_held_ns(m, now) / 1e6, waiters[id], longest_us[id] / 1000.0);
+    }
+}
+
+#endif
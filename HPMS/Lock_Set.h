@@ -0,0 +1,178 @@
+/*
+ * HPMS Lock Set - Take Several Locks at Once Without Deadlock
+ *
+ * Every lock has a rank from the hospital-wide lock hierarchy (smaller is
+ * taken first). A transaction adds all the locks it needs to a LockSet in
+ * any order and calls lock_set_acquire, which
+ *
+ * - takes them in rank order (address order for equal ranks), so no two
+ *   transactions can wait on each other in a circle; and
+ * - only ever try-locks. If one lock is busy, it releases everything it
+ *   holds, backs off (exponential with jitter, capped at
+ *   LS_BACKOFF_MAX_US), and starts over. A waiter never holds one lock
+ *   while waiting for another, so even code outside the hierarchy cannot
+ *   deadlock against it, and the wait can end at a deadline.
+ *
+ * The same API builds on POSIX (pthread mutexes) and Win32 (critical
+ * sections).
+ */
+
+#ifndef LOCK_SET_H
+#define LOCK_SET_H
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define LS_MAX_LOCKS      32
+#define LS_BACKOFF_MAX_US 1000   // longest pause between attempts
+#define LS_NO_DEADLINE    (-1)
+
+/* ---------------------------------------------------------------------- */
+/* Platform layer                                                          */
+/* ---------------------------------------------------------------------- */
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION ls_mutex_t;
+
+static inline void ls_mutex_init(ls_mutex_t *m) { InitializeCriticalSection(m); }
+static inline void ls_mutex_destroy(ls_mutex_t *m) { DeleteCriticalSection(m); }
+static inline int ls_mutex_trylock(ls_mutex_t *m) { return TryEnterCriticalSection(m) ? 0 : -1; }
+static inline void ls_mutex_unlock(ls_mutex_t *m) { LeaveCriticalSection(m); }
+
+static inline int64_t ls_now_us(void) {
+    LARGE_INTEGER now, freq;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&freq);
+    return (int64_t)(now.QuadPart / freq.QuadPart * 1000000 +
+                     now.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+}
+
+static inline void ls_pause_us(uint32_t us) {
+    if (us < 1000) SwitchToThread();  // Sleep() cannot go below a millisecond
+    else Sleep(us / 1000);
+}
+#else
+typedef pthread_mutex_t ls_mutex_t;
+
+static inline void ls_mutex_init(ls_mutex_t *m) { pthread_mutex_init(m, NULL); }
+static inline void ls_mutex_destroy(ls_mutex_t *m) { pthread_mutex_destroy(m); }
+static inline int ls_mutex_trylock(ls_mutex_t *m) { return pthread_mutex_trylock(m) == 0 ? 0 : -1; }
+static inline void ls_mutex_unlock(ls_mutex_t *m) { pthread_mutex_unlock(m); }
+
+static inline int64_t ls_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline void ls_pause_us(uint32_t us) {
+    if (us < 50) sched_yield();
+    else usleep(us);
+}
+#endif
+
+/* ---------------------------------------------------------------------- */
+/* Ranked locks and lock sets                                              */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+    ls_mutex_t mutex;
+    uint32_t rank;             // position in the lock hierarchy
+    const char *name;
+} RankedLock;
+
+typedef struct {
+    RankedLock *locks[LS_MAX_LOCKS];
+    int count;
+    int held;                  // locks[0..held) are currently taken
+    uint32_t seed;             // backoff jitter
+    long attempts;             // full passes over the set, all acquires so far
+    long backoffs;             // passes that hit a busy lock and started over
+    int64_t last_wait_us;      // how long the last acquire took
+} LockSet;
+
+static inline void ranked_lock_init(RankedLock *lock, uint32_t rank, const char *name) {
+    ls_mutex_init(&lock->mutex);
+    lock->rank = rank;
+    lock->name = name;
+}
+
+static inline void ranked_lock_destroy(RankedLock *lock) {
+    ls_mutex_destroy(&lock->mutex);
+}
+
+/* seed only varies the backoff jitter between threads */
+static inline void lock_set_init(LockSet *set, uint32_t seed) {
+    set->count = 0;
+    set->held = 0;
+    set->seed = seed * 2654435769u | 1;
+    set->attempts = 0;
+    set->backoffs = 0;
+    set->last_wait_us = 0;
+}
+
+/* Empty the set for the next transaction (keeps the counters); nothing may be held */
+static inline void lock_set_clear(LockSet *set) {
+    set->count = 0;
+}
+
+/* Add a lock, kept sorted by rank; adding one twice is harmless. Returns 0, or -1 if full */
+static inline int lock_set_add(LockSet *set, RankedLock *lock) {
+    int i = set->count;
+    for (int j = 0; j < set->count; j++)
+        if (set->locks[j] == lock) return 0;
+    if (set->count == LS_MAX_LOCKS) return -1;
+    while (i > 0 && (set->locks[i - 1]->rank > lock->rank ||
+                     (set->locks[i - 1]->rank == lock->rank && set->locks[i - 1] > lock))) {
+        set->locks[i] = set->locks[i - 1];
+        i--;
+    }
+    set->locks[i] = lock;
+    set->count++;
+    return 0;
+}
+
+static inline void lock_set_release(LockSet *set) {
+    while (set->held > 0) ls_mutex_unlock(&set->locks[--set->held]->mutex);  // reverse order
+}
+
+/*
+ * Take every lock in the set. timeout_ms bounds the whole wait
+ * (LS_NO_DEADLINE waits as long as it takes). Returns 0 with all locks
+ * held, or -1 on timeout with none held.
+ */
+static inline int lock_set_acquire(LockSet *set, int64_t timeout_ms) {
+    int64_t start = ls_now_us();
+    uint32_t backoff_us = 1;
+
+    for (;;) {
+        set->attempts++;
+        while (set->held < set->count && ls_mutex_trylock(&set->locks[set->held]->mutex) == 0)
+            set->held++;
+        if (set->held == set->count) {
+            set->last_wait_us = ls_now_us() - start;
+            return 0;
+        }
+
+        // Busy: hold nothing while we wait, then start over from the lowest rank
+        lock_set_release(set);
+        set->backoffs++;
+        if (timeout_ms != LS_NO_DEADLINE && ls_now_us() - start >= timeout_ms * 1000) {
+            set->last_wait_us = ls_now_us() - start;
+            return -1;
+        }
+        set->seed = set->seed * 1103515245u + 12345u;
+        ls_pause_us(backoff_us / 2 + (set->seed >> 16) % (backoff_us / 2 + 1));
+        if (backoff_us < LS_BACKOFF_MAX_US) backoff_us *= 2;
+    }
+}
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * HPMS Patient Store - Hash-Indexed In-Memory Patient Records
+ *
+ * Records live in a slab pool: fixed-size slots carved from chunks of
+ * PS_SLAB_RECORDS, each slot padded to a cache line so neighbouring
+ * records never share one. Freed slots go on a free list and are reused.
+ *
+ * The index is an open-addressing hash table with linear probing. Each
+ * entry is one 64-bit word, (patient id << 32) | (slot + 1), so a reader
+ * sees either the old or the new entry, never half of one. 0 is an empty
+ * entry and a slot of 0 marks a removed one (tombstone, reused by inserts).
+ * Patient id 0 is reserved.
+ *
+ * Concurrency is read-mostly:
+ * - ps_lookup takes no lock. It probes the index and copies the record
+ *   under the record's seqlock, so readers never block each other.
+ * - ps_update changes one record under its own seqlock. Updates of
+ *   different patients run in parallel and do not touch the index.
+ * - ps_read + ps_commit is the optimistic form: read a record and its
+ *   version, decide with no lock held, then commit only if the version
+ *   has not moved (a seqlock compare-and-swap), else re-read.
+ * - ps_insert / ps_remove change the index and the pool, serialized by
+ *   one writer mutex that readers never take.
+ *
+ * Capacity is fixed at init (no rehash); the table is sized to stay at
+ * most half full.
+ */
+
+#ifndef PATIENT_STORE_H
+#define PATIENT_STORE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Seqlock.h"
+
+#define PS_SLAB_BITS    10
+#define PS_SLAB_RECORDS (1 << PS_SLAB_BITS)
+
+/* The record itself; 8-byte multiple so the seqlock copies it in words */
+typedef struct {
+    _Alignas(8) uint32_t patient_id;
+    uint8_t diagnosis;
+    uint8_t status;
+    uint8_t reserved[2];
+    char name[24];
+    char allergy_info[100];
+    char prescription[100];
+} PatientData;
+
+_Static_assert(sizeof(PatientData) % 8 == 0, "seqlock copies PatientData in 8-byte words");
+
+typedef struct {
+    _Alignas(64) Seqlock lock;
+    PatientData data;
+} StoredPatient;
+
+typedef struct {
+    _Atomic uint64_t *index;
+    uint32_t mask;              // table size - 1
+    StoredPatient **slabs;      // chunk pointers, allocated on first use
+    uint32_t capacity;          // most records held at once
+    uint32_t used;              // slots ever handed out (high-water mark)
+    uint32_t count;             // records currently stored
+    uint32_t *free_slots;       // recycled slots, LIFO
+    uint32_t free_count;
+    pthread_mutex_t writer;
+} PatientStore;
+
+static inline uint32_t ps_hash(uint32_t patient_id) {
+    uint32_t h = patient_id * 2654435769u;  // Fibonacci hashing spreads sequential ids
+    return h ^ (h >> 16);                    // and this folds the well-mixed high bits down
+}
+
+static inline StoredPatient *ps_slot(const PatientStore *ps, uint32_t slot) {
+    return &ps->slabs[slot >> PS_SLAB_BITS][slot & (PS_SLAB_RECORDS - 1)];
+}
+
+/* Returns 0 on success, -1 if memory cannot be allocated */
+static inline int ps_init(PatientStore *ps, uint32_t capacity) {
+    uint32_t table = 16;
+    while (table < 2 * capacity) table *= 2;
+
+    memset(ps, 0, sizeof(*ps));
+    ps->index = calloc(table, sizeof(*ps->index));
+    ps->slabs = calloc((capacity + PS_SLAB_RECORDS - 1) / PS_SLAB_RECORDS, sizeof(*ps->slabs));
+    ps->free_slots = malloc((capacity + 1) * sizeof(*ps->free_slots));
+    if (ps->index == NULL || ps->slabs == NULL || ps->free_slots == NULL) {
+        free(ps->index);
+        free(ps->slabs);
+        free(ps->free_slots);
+        return -1;
+    }
+    ps->mask = table - 1;
+    ps->capacity = capacity;
+    pthread_mutex_init(&ps->writer, NULL);
+    return 0;
+}
+
+/* No readers or writers may still be running */
+static inline void ps_free(PatientStore *ps) {
+    for (uint32_t c = 0; c < (ps->capacity + PS_SLAB_RECORDS - 1) / PS_SLAB_RECORDS; c++)
+        free(ps->slabs[c]);
+    free(ps->slabs);
+    free(ps->index);
+    free(ps->free_slots);
+    pthread_mutex_destroy(&ps->writer);
+}
+
+/* Index entry position for patient_id, or -1; caller holds the writer mutex */
+static inline int64_t ps_find_entry(const PatientStore *ps, uint32_t patient_id) {
+    for (uint32_t i = ps_hash(patient_id) & ps->mask, probes = 0; probes <= ps->mask;
+         i = (i + 1) & ps->mask, probes++) {
+        uint64_t entry = atomic_load_explicit(&ps->index[i], memory_order_relaxed);
+        if (entry == 0) return -1;
+        if ((uint32_t)(entry >> 32) == patient_id && (uint32_t)entry != 0) return i;
+    }
+    return -1;
+}
+
+static inline StoredPatient *ps_alloc_slot(PatientStore *ps, uint32_t *slot) {
+    if (ps->free_count > 0) {
+        *slot = ps->free_slots[--ps->free_count];
+    } else {
+        if (ps->used == ps->capacity) return NULL;
+        *slot = ps->used;
+        StoredPatient **slab = &ps->slabs[*slot >> PS_SLAB_BITS];
+        if (*slab == NULL) {
+            *slab = aligned_alloc(_Alignof(StoredPatient), PS_SLAB_RECORDS * sizeof(StoredPatient));
+            if (*slab == NULL) return NULL;
+            for (int r = 0; r < PS_SLAB_RECORDS; r++) seqlock_init(&(*slab)[r].lock);
+        }
+        ps->used++;
+    }
+    return ps_slot(ps, *slot);
+}
+
+/*
+ * Add a patient, or replace the record if the id is already stored.
+ * Returns 0, or -1 if the id is 0 or the store is full.
+ */
+static inline int ps_insert(PatientStore *ps, const PatientData *record) {
+    uint32_t patient_id = record->patient_id;
+    if (patient_id == 0) return -1;
+
+    pthread_mutex_lock(&ps->writer);
+    int64_t existing = ps_find_entry(ps, patient_id);
+    if (existing >= 0) {
+        uint64_t entry = atomic_load_explicit(&ps->index[existing], memory_order_relaxed);
+        StoredPatient *stored = ps_slot(ps, (uint32_t)entry - 1);
+        seqlock_write(&stored->lock, &stored->data, record, sizeof(*record));
+        pthread_mutex_unlock(&ps->writer);
+        return 0;
+    }
+
+    uint32_t slot;
+    StoredPatient *stored = ps_alloc_slot(ps, &slot);
+    if (stored == NULL) {
+        pthread_mutex_unlock(&ps->writer);
+        return -1;
+    }
+    seqlock_write(&stored->lock, &stored->data, record, sizeof(*record));
+
+    // First empty or removed entry on the probe path; the release store publishes the record
+    uint32_t i = ps_hash(patient_id) & ps->mask;
+    while ((uint32_t)atomic_load_explicit(&ps->index[i], memory_order_relaxed) != 0)
+        i = (i + 1) & ps->mask;
+    atomic_store_explicit(&ps->index[i], ((uint64_t)patient_id << 32) | (slot + 1),
+                          memory_order_release);
+    ps->count++;
+    pthread_mutex_unlock(&ps->writer);
+    return 0;
+}
+
+/* Returns 1 if the patient was stored, 0 if not */
+static inline int ps_remove(PatientStore *ps, uint32_t patient_id) {
+    pthread_mutex_lock(&ps->writer);
+    int64_t i = ps_find_entry(ps, patient_id);
+    if (i < 0) {
+        pthread_mutex_unlock(&ps->writer);
+        return 0;
+    }
+    uint64_t entry = atomic_load_explicit(&ps->index[i], memory_order_relaxed);
+    atomic_store_explicit(&ps->index[i], (uint64_t)patient_id << 32, memory_order_release);
+
+    // Clear the id so a reader that found the old entry sees a miss, not a stranger's record
+    StoredPatient *stored = ps_slot(ps, (uint32_t)entry - 1);
+    PatientData empty = {0};
+    seqlock_write(&stored->lock, &stored->data, &empty, sizeof(empty));
+    ps->free_slots[ps->free_count++] = (uint32_t)entry - 1;
+    ps->count--;
+    pthread_mutex_unlock(&ps->writer);
+    return 1;
+}
+
+/*
+ * Copy a consistent snapshot of the patient into out, and its version
+ * for a later ps_commit. Returns 1 if found, 0 if not.
+ */
+static inline int ps_read(const PatientStore *ps, uint32_t patient_id, PatientData *out, uint32_t *version) {
+    *version = 0;
+    for (uint32_t i = ps_hash(patient_id) & ps->mask, probes = 0; probes <= ps->mask;
+         i = (i + 1) & ps->mask, probes++) {
+        uint64_t entry = atomic_load_explicit(&ps->index[i], memory_order_acquire);
+        if (entry == 0) return 0;
+        if ((uint32_t)(entry >> 32) != patient_id || (uint32_t)entry == 0) continue;
+
+        const StoredPatient *stored = ps_slot(ps, (uint32_t)entry - 1);
+        out->patient_id = 0;  // (only to keep -Wmaybe-uninitialized quiet; the copy overwrites it)
+        do {
+            *version = seqlock_read_begin(&stored->lock);
+            seqlock_load(out, &stored->data, sizeof(*out));
+        } while (seqlock_read_retry(&stored->lock, *version));
+        return out->patient_id == patient_id;  // slot recycled since the probe: removed
+    }
+    return 0;
+}
+
+/* Copy a consistent snapshot of the patient into out; returns 1 if found, 0 if not */
+static inline int ps_lookup(const PatientStore *ps, uint32_t patient_id, PatientData *out) {
+    uint32_t version;
+    return ps_read(ps, patient_id, out, &version);
+}
+
+/*
+ * Change one stored patient in place: update(record, arg) edits a copy,
+ * which is written back under the record's seqlock. Only that record's
+ * readers can ever retry. Returns 1 if the patient was found, 0 if not.
+ */
+static inline int ps_update(PatientStore *ps, uint32_t patient_id,
+                            void (*update)(PatientData *record, void *arg), void *arg) {
+    for (uint32_t i = ps_hash(patient_id) & ps->mask, probes = 0; probes <= ps->mask;
+         i = (i + 1) & ps->mask, probes++) {
+        uint64_t entry = atomic_load_explicit(&ps->index[i], memory_order_acquire);
+        if (entry == 0) return 0;
+        if ((uint32_t)(entry >> 32) != patient_id || (uint32_t)entry == 0) continue;
+
+        StoredPatient *stored = ps_slot(ps, (uint32_t)entry - 1);
+        PatientData copy;
+        seqlock_write_begin(&stored->lock);
+        memcpy(&copy, &stored->data, sizeof(copy));  // no other writer while we hold it
+        int found = copy.patient_id == patient_id;
+        if (found) {
+            update(&copy, arg);
+            copy.patient_id = patient_id;
+            seqlock_store(&stored->data, &copy, sizeof(copy));
+        }
+        seqlock_write_end(&stored->lock);
+        return found;
+    }
+    return 0;
+}
+
+/*
+ * Optimistic read-decide-write: like ps_update, but only if the record is
+ * still at the version ps_read returned, i.e. nobody changed it while the
+ * caller was deciding. Nothing is locked while the caller decides.
+ * Returns 1 if committed, 0 if the patient is gone, -1 if the record
+ * changed (re-read and decide again).
+ */
+static inline int ps_commit(PatientStore *ps, uint32_t patient_id, uint32_t version,
+                            void (*update)(PatientData *record, void *arg), void *arg) {
+    for (uint32_t i = ps_hash(patient_id) & ps->mask, probes = 0; probes <= ps->mask;
+         i = (i + 1) & ps->mask, probes++) {
+        uint64_t entry = atomic_load_explicit(&ps->index[i], memory_order_acquire);
+        if (entry == 0) return 0;
+        if ((uint32_t)(entry >> 32) != patient_id || (uint32_t)entry == 0) continue;
+
+        StoredPatient *stored = ps_slot(ps, (uint32_t)entry - 1);
+        if (!seqlock_write_begin_if(&stored->lock, version)) return -1;
+        PatientData copy;
+        memcpy(&copy, &stored->data, sizeof(copy));
+        int found = copy.patient_id == patient_id;
+        if (found) {
+            update(&copy, arg);
+            copy.patient_id = patient_id;
+            seqlock_store(&stored->data, &copy, sizeof(copy));
+        }
+        seqlock_write_end(&stored->lock);
+        return found;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * HPMS Ready Queue - Indexed Binary Min-Heap
+ *
+ * Shared by every scheduling algorithm in Scheduling_sim.c:
+ * - Priority:    key = (priority, arrival, pid)
+ * - SJF:         key = (burst, arrival, pid)
+ * - FCFS:        key = (arrival, pid, 0)
+ * - Round Robin: key = (enqueue sequence, 0, 0)
+ * - SRTF:        key = (remaining, arrival, pid)
+ * - Priority RR: key = (priority, enqueue sequence, 0)
+ *
+ * Entries are process-table indices. position[] maps an index to its heap
+ * slot so a queued process can be re-keyed (decrease-key on preemption or
+ * aging) or removed in O(log n) without searching the heap.
+ *
+ * Storage is supplied by the caller (stack, malloc or arena), the queue
+ * itself never allocates. Capacity is not checked on push: callers size
+ * the heap for the most entries it can hold, or test rq_full() first.
+ */
+
+#ifndef READY_QUEUE_H
+#define READY_QUEUE_H
+
+typedef struct {
+    int key[3];          // compared lexicographically, smallest first
+    int index;           // process-table index
+} ReadyEntry;
+
+typedef struct {
+    ReadyEntry *heap;
+    int *position;       // position[index] = heap slot, -1 if not queued
+    int size;
+    int capacity;
+} ReadyQueue;
+
+static inline void rq_init(ReadyQueue *rq, ReadyEntry *heap, int *position, int capacity) {
+    rq->heap = heap;
+    rq->position = position;
+    rq->size = 0;
+    rq->capacity = capacity;
+    for (int i = 0; i < capacity; i++) position[i] = -1;
+}
+
+/*
+ * Init a queue that shares its position map with other queues over one
+ * index space (e.g. per-core run queues); each index sits in at most one
+ * of them. The caller fills position[] with -1 once for all queues.
+ */
+static inline void rq_init_shared(ReadyQueue *rq, ReadyEntry *heap, int *position, int capacity) {
+    rq->heap = heap;
+    rq->position = position;
+    rq->size = 0;
+    rq->capacity = capacity;
+}
+
+static inline int rq_less(const ReadyEntry *a, const ReadyEntry *b) {
+    if (a->key[0] != b->key[0]) return a->key[0] < b->key[0];
+    if (a->key[1] != b->key[1]) return a->key[1] < b->key[1];
+    return a->key[2] < b->key[2];
+}
+
+static inline void rq_place(ReadyQueue *rq, int slot, ReadyEntry e) {
+    rq->heap[slot] = e;
+    rq->position[e.index] = slot;
+}
+
+static inline void rq_sift_up(ReadyQueue *rq, int slot) {
+    ReadyEntry e = rq->heap[slot];
+    while (slot > 0) {
+        int parent = (slot - 1) / 2;
+        if (!rq_less(&e, &rq->heap[parent])) break;
+        rq_place(rq, slot, rq->heap[parent]);
+        slot = parent;
+    }
+    rq_place(rq, slot, e);
+}
+
+static inline void rq_sift_down(ReadyQueue *rq, int slot) {
+    ReadyEntry e = rq->heap[slot];
+    for (;;) {
+        int child = 2 * slot + 1;
+        if (child >= rq->size) break;
+        if (child + 1 < rq->size && rq_less(&rq->heap[child + 1], &rq->heap[child]))
+            child++;
+        if (!rq_less(&rq->heap[child], &e)) break;
+        rq_place(rq, slot, rq->heap[child]);
+        slot = child;
+    }
+    rq_place(rq, slot, e);
+}
+
+static inline int rq_empty(const ReadyQueue *rq) {
+    return rq->size == 0;
+}
+
+static inline int rq_full(const ReadyQueue *rq) {
+    return rq->size == rq->capacity;
+}
+
+static inline int rq_contains(const ReadyQueue *rq, int index) {
+    return rq->position[index] != -1;
+}
+
+/* Insert process index with the given key (index must not be queued) */
+static inline void rq_push(ReadyQueue *rq, int index, int k0, int k1, int k2) {
+    ReadyEntry e = {{k0, k1, k2}, index};
+    rq->heap[rq->size] = e;
+    rq->position[index] = rq->size;
+    rq->size++;
+    rq_sift_up(rq, rq->size - 1);
+}
+
+/* Index with the smallest key, -1 if empty */
+static inline int rq_peek(const ReadyQueue *rq) {
+    return rq->size > 0 ? rq->heap[0].index : -1;
+}
+
+/* Remove a queued process wherever it sits in the heap */
+static inline void rq_remove(ReadyQueue *rq, int index) {
+    int slot = rq->position[index];
+    rq->position[index] = -1;
+    rq->size--;
+    if (slot == rq->size) return;
+
+    rq_place(rq, slot, rq->heap[rq->size]);
+    if (slot > 0 && rq_less(&rq->heap[slot], &rq->heap[(slot - 1) / 2]))
+        rq_sift_up(rq, slot);
+    else
+        rq_sift_down(rq, slot);
+}
+
+/* Remove and return the smallest key, -1 if empty */
+static inline int rq_pop(ReadyQueue *rq) {
+    int index = rq_peek(rq);
+    if (index != -1) rq_remove(rq, index);
+    return index;
+}
+
+/* Re-key a queued process; handles both decrease-key and increase-key */
+static inline void rq_update(ReadyQueue *rq, int index, int k0, int k1, int k2) {
+    int slot = rq->position[index];
+    ReadyEntry old = rq->heap[slot];
+    ReadyEntry e = {{k0, k1, k2}, index};
+    rq->heap[slot] = e;
+    if (rq_less(&e, &old))
+        rq_sift_up(rq, slot);
+    else
+        rq_sift_down(rq, slot);
+}
+
+#endif
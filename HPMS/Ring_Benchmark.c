@@ -0,0 +1,272 @@
+/*
+ * HPMS Ring Buffer Benchmark - Ops/sec by Thread Count
+ *
+ * Moves records from producer threads to consumer threads through each
+ * queue the HPMS IPC paths can use:
+ * - SPSC ring (Ring_Buffer.h SpscRing), one record or a batch at a time
+ * - MPMC ring (Ring_Buffer.h RingBuffer), one record or a batch at a time
+ * - mutex queue: the same array FIFO behind one pthread mutex, for scale
+ *
+ * The MPMC ring and the mutex queue run with 1, 2, 4, ... producers and as
+ * many consumers, up to --max-threads in total; threads are spread over
+ * the online CPUs. A full or empty queue makes the caller yield, so the
+ * run also means something on fewer CPUs than threads. Every run checks
+ * that each record arrived exactly once (sum of values) and, for SPSC, in
+ * order.
+ *
+ * Compile: gcc -O2 -pthread Ring_Benchmark.c -o ring_benchmark
+ * Run:     ./ring_benchmark [--records N] [--max-threads T] [--batch B]
+ */
+
+#define _GNU_SOURCE          // pthread_setaffinity_np
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Ring_Buffer.h"
+
+#define RING_CAPACITY 4096
+#define MAX_THREADS   64
+#define MAX_BATCH     256
+
+typedef enum { QUEUE_SPSC, QUEUE_MPMC, QUEUE_MUTEX } QueueKind;
+
+/* Baseline: a bounded array FIFO under one lock */
+typedef struct {
+    pthread_mutex_t lock;
+    uint64_t *slots;
+    uint64_t head, tail;
+    uint32_t mask;
+} MutexQueue;
+
+typedef struct {
+    QueueKind kind;
+    int batch;
+    SpscRing *spsc;
+    RingBuffer *mpmc;
+    MutexQueue mutex;
+    long per_producer;
+    long total;
+    _Atomic long consumed;
+    pthread_barrier_t start;
+} Bench;
+
+typedef struct {
+    Bench *bench;
+    int id;
+    int cpu;
+    uint64_t sum;                    // consumers: values received
+    int out_of_order;                // SPSC consumer: a value arrived before an earlier one
+} BenchThread;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint32_t mutex_push(MutexQueue *q, const uint64_t *values, uint32_t count) {
+    pthread_mutex_lock(&q->lock);
+    uint32_t room = (uint32_t)(q->mask + 1 - (q->tail - q->head));
+    if (count > room) count = room;
+    for (uint32_t i = 0; i < count; i++) q->slots[(q->tail + i) & q->mask] = values[i];
+    q->tail += count;
+    pthread_mutex_unlock(&q->lock);
+    return count;
+}
+
+static uint32_t mutex_pop(MutexQueue *q, uint64_t *values, uint32_t max) {
+    pthread_mutex_lock(&q->lock);
+    uint32_t ready = (uint32_t)(q->tail - q->head);
+    if (max > ready) max = ready;
+    for (uint32_t i = 0; i < max; i++) values[i] = q->slots[(q->head + i) & q->mask];
+    q->head += max;
+    pthread_mutex_unlock(&q->lock);
+    return max;
+}
+
+static uint32_t bench_push(Bench *b, const uint64_t *values, uint32_t count) {
+    switch (b->kind) {
+    case QUEUE_SPSC:
+        return count == 1 ? spsc_push(b->spsc, values) == 0 : spsc_push_batch(b->spsc, values, count);
+    case QUEUE_MPMC:
+        return count == 1 ? ring_push(b->mpmc, values) == 0 : ring_push_batch(b->mpmc, values, count);
+    default:
+        return mutex_push(&b->mutex, values, count);
+    }
+}
+
+static uint32_t bench_pop(Bench *b, uint64_t *values, uint32_t max) {
+    switch (b->kind) {
+    case QUEUE_SPSC:
+        return max == 1 ? spsc_pop(b->spsc, values) == 0 : spsc_pop_batch(b->spsc, values, max);
+    case QUEUE_MPMC:
+        return max == 1 ? ring_pop(b->mpmc, values) == 0 : ring_pop_batch(b->mpmc, values, max);
+    default:
+        return mutex_pop(&b->mutex, values, max);
+    }
+}
+
+static void pin_to(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* Producer id sends values id*per_producer+1 .. (id+1)*per_producer */
+static void *producer_main(void *arg) {
+    BenchThread *t = arg;
+    Bench *b = t->bench;
+    uint64_t values[MAX_BATCH];
+    uint64_t next = (uint64_t)t->id * b->per_producer + 1, end = next + b->per_producer;
+
+    pin_to(t->cpu);
+    pthread_barrier_wait(&b->start);
+    while (next < end) {
+        uint32_t count = end - next < (uint64_t)b->batch ? (uint32_t)(end - next) : (uint32_t)b->batch;
+        for (uint32_t i = 0; i < count; i++) values[i] = next + i;
+        uint32_t sent = bench_push(b, values, count);
+        if (sent == 0) sched_yield();  // full: let a consumer run
+        next += sent;
+    }
+    return NULL;
+}
+
+static void *consumer_main(void *arg) {
+    BenchThread *t = arg;
+    Bench *b = t->bench;
+    uint64_t values[MAX_BATCH], last = 0;
+
+    pin_to(t->cpu);
+    pthread_barrier_wait(&b->start);
+    while (atomic_load_explicit(&b->consumed, memory_order_relaxed) < b->total) {
+        uint32_t got = bench_pop(b, values, (uint32_t)b->batch);
+        if (got == 0) {
+            sched_yield();  // empty: let a producer run
+            continue;
+        }
+        for (uint32_t i = 0; i < got; i++) {
+            t->sum += values[i];
+            t->out_of_order += values[i] <= last;
+            last = values[i];
+        }
+        atomic_fetch_add_explicit(&b->consumed, got, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+/* Returns records per second, or -1 if a record was lost, duplicated or (SPSC) reordered */
+static double run_case(QueueKind kind, int producers, int consumers, long records, int batch, int cpus) {
+    static Bench bench;
+    BenchThread threads[MAX_THREADS];
+    pthread_t tids[MAX_THREADS];
+    int total_threads = producers + consumers;
+
+    memset(&bench, 0, sizeof(bench));
+    bench.kind = kind;
+    bench.batch = batch;
+    bench.per_producer = records / producers;
+    bench.total = bench.per_producer * producers;
+    if (kind == QUEUE_SPSC) {
+        bench.spsc = aligned_alloc(RING_CACHE_LINE, spsc_bytes(RING_CAPACITY, sizeof(uint64_t)));
+        spsc_init(bench.spsc, RING_CAPACITY, sizeof(uint64_t));
+    } else if (kind == QUEUE_MPMC) {
+        bench.mpmc = aligned_alloc(RING_CACHE_LINE, ring_bytes(RING_CAPACITY, sizeof(uint64_t)));
+        ring_init(bench.mpmc, RING_CAPACITY, sizeof(uint64_t));
+    } else {
+        pthread_mutex_init(&bench.mutex.lock, NULL);
+        bench.mutex.slots = malloc(RING_CAPACITY * sizeof(uint64_t));
+        bench.mutex.mask = RING_CAPACITY - 1;
+    }
+    pthread_barrier_init(&bench.start, NULL, total_threads + 1);
+
+    for (int i = 0; i < total_threads; i++) {
+        threads[i] = (BenchThread){&bench, i < producers ? i : i - producers, i % cpus, 0, 0};
+        pthread_create(&tids[i], NULL, i < producers ? producer_main : consumer_main, &threads[i]);
+    }
+    pthread_barrier_wait(&bench.start);
+    uint64_t start = now_ns();
+    for (int i = 0; i < total_threads; i++) pthread_join(tids[i], NULL);
+    double seconds = (now_ns() - start) / 1e9;
+
+    uint64_t sum = 0, expected = (uint64_t)bench.total * (bench.total + 1) / 2;
+    int reordered = 0;
+    for (int i = producers; i < total_threads; i++) {
+        sum += threads[i].sum;
+        reordered += threads[i].out_of_order;
+    }
+    pthread_barrier_destroy(&bench.start);
+    free(bench.spsc);
+    free(bench.mpmc);
+    if (kind == QUEUE_MUTEX) {
+        pthread_mutex_destroy(&bench.mutex.lock);
+        free(bench.mutex.slots);
+    }
+    if (sum != expected || (kind == QUEUE_SPSC && reordered)) return -1;
+    return bench.total / seconds;
+}
+
+static void print_row(const char *name, int producers, int consumers, int batch, double ops, double baseline) {
+    if (ops < 0) {
+        printf("%-14s %5d %5d %6d   ✗ records lost, duplicated or reordered\n", name, producers, consumers, batch);
+        return;
+    }
+    printf("%-14s %5d %5d %6d %10.2f", name, producers, consumers, batch, ops / 1e6);
+    if (baseline > 0) printf(" %9.1fx", ops / baseline);
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN), max_threads = 0, batch = 32;
+    long records = 2000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--records") == 0 && i + 1 < argc) records = atol(argv[++i]);
+        else if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) max_threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) batch = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--records N] [--max-threads T] [--batch B]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (cpus < 1) cpus = 1;
+    if (max_threads <= 0) max_threads = cpus < 4 ? 8 : 2 * cpus;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+    if (records < 1000 || batch < 2 || batch > MAX_BATCH || max_threads < 2) {
+        fprintf(stderr, "Need records >= 1000, batch 2..%d, max-threads >= 2\n", MAX_BATCH);
+        return 1;
+    }
+
+    printf("========================================\n");
+    printf("   HPMS RING BUFFER BENCHMARK\n");
+    printf("========================================\n");
+    printf("✓ %ld records of 8 bytes per run, %d-slot queues, %d online CPU(s)\n", records, RING_CAPACITY, cpus);
+    printf("✓ Threads pinned round-robin over the CPUs; full/empty queues yield\n\n");
+
+    printf("%-14s %5s %5s %6s %10s %10s\n", "Queue", "Prod", "Cons", "Batch", "M ops/s", "vs mutex");
+    double mutex_ops = run_case(QUEUE_MUTEX, 1, 1, records, 1, cpus);
+    print_row("Mutex queue", 1, 1, 1, mutex_ops, 0);
+    print_row("SPSC ring", 1, 1, 1, run_case(QUEUE_SPSC, 1, 1, records, 1, cpus), mutex_ops);
+    print_row("SPSC ring", 1, 1, batch, run_case(QUEUE_SPSC, 1, 1, records, batch, cpus), mutex_ops);
+
+    for (int side = 1; 2 * side <= max_threads; side *= 2) {
+        printf("\n--- %d thread(s): %d producer(s), %d consumer(s) ---\n", 2 * side, side, side);
+        double baseline = run_case(QUEUE_MUTEX, side, side, records, 1, cpus);
+        print_row("Mutex queue", side, side, 1, baseline, 0);
+        print_row("MPMC ring", side, side, 1, run_case(QUEUE_MPMC, side, side, records, 1, cpus), baseline);
+        print_row("MPMC ring", side, side, batch, run_case(QUEUE_MPMC, side, side, records, batch, cpus),
+                  baseline);
+    }
+
+    printf("\n========================================\n");
+    printf("SPSC: one owner per counter, no CAS - the pipeline hand-off\n");
+    printf("MPMC: one CAS per record, or per batch with ring_*_batch\n");
+    printf("Both: power-of-two cells, padded counters, no pointers (shm-safe)\n");
+    printf("========================================\n");
+    return 0;
+}
@@ -0,0 +1,276 @@
+/*
+ * HPMS Ring Buffer - Bounded Lock-Free Queue of Fixed-Size Records
+ *
+ * Many producers and many consumers share one ring of 2^k cells. Each cell
+ * carries a sequence number that says whose turn it is: a producer may
+ * fill the cell when seq == position, a consumer may empty it when
+ * seq == position + 1. Producers (and consumers) claim positions with a
+ * CAS on their own counter, so a full or empty ring is detected without
+ * locks and a slow thread never corrupts another's record.
+ *
+ * The ring holds no pointers: it lives in one contiguous block sized by
+ * ring_bytes(), which may be malloc'd or placed in a shared memory segment
+ * and used from several processes. Head and tail counters sit on their own
+ * cache lines so producers and consumers do not false-share.
+ *
+ * ring_push_batch / ring_pop_batch move up to count records with a single
+ * CAS, so a producer with a burst (or a consumer draining one) pays for
+ * the shared counter once per batch instead of once per record.
+ *
+ * SpscRing is the variant for exactly one producer and one consumer (a
+ * pipeline stage, a single-threaded FIFO): no CAS and no per-cell
+ * sequence. Each side owns one counter and keeps a cached copy of the
+ * other's on its own cache line, rereading the real one only when the
+ * cache says full (or empty). It has the same layout rules: 2^k cells, no
+ * pointers, sized by spsc_bytes() and placeable in shared memory.
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RING_CACHE_LINE 64
+
+typedef struct {
+    _Alignas(RING_CACHE_LINE) _Atomic uint64_t tail;  // next position to fill
+    _Alignas(RING_CACHE_LINE) _Atomic uint64_t head;  // next position to empty
+    _Alignas(RING_CACHE_LINE) uint32_t capacity;      // power of two
+    uint32_t mask;
+    uint32_t record_size;
+    uint32_t stride;                                  // bytes per cell: seq + record, 8-aligned
+    _Alignas(RING_CACHE_LINE) unsigned char cells[];
+} RingBuffer;
+
+static inline uint32_t ring_stride(uint32_t record_size) {
+    return (uint32_t)(sizeof(uint64_t) + ((record_size + 7) & ~7u));
+}
+
+/* Bytes needed for a ring of capacity (a power of two) records of record_size */
+static inline size_t ring_bytes(uint32_t capacity, uint32_t record_size) {
+    return sizeof(RingBuffer) + (size_t)capacity * ring_stride(record_size);
+}
+
+static inline _Atomic uint64_t *ring_cell_seq(RingBuffer *ring, uint64_t position) {
+    return (_Atomic uint64_t *)(ring->cells + (size_t)(position & ring->mask) * ring->stride);
+}
+
+/* Returns 0, or -1 if capacity is not a power of two */
+static inline int ring_init(RingBuffer *ring, uint32_t capacity, uint32_t record_size) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) return -1;
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    ring->record_size = record_size;
+    ring->stride = ring_stride(record_size);
+    for (uint32_t i = 0; i < capacity; i++)
+        atomic_init(ring_cell_seq(ring, i), i);
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 0;
+}
+
+/* Copy record in; returns 0, or -1 if the ring is full */
+static inline int ring_push(RingBuffer *ring, const void *record) {
+    uint64_t position = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    for (;;) {
+        _Atomic uint64_t *seq = ring_cell_seq(ring, position);
+        int64_t turn = (int64_t)(atomic_load_explicit(seq, memory_order_acquire) - position);
+        if (turn == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                memcpy((unsigned char *)seq + sizeof(uint64_t), record, ring->record_size);
+                atomic_store_explicit(seq, position + 1, memory_order_release);
+                return 0;
+            }
+        } else if (turn < 0) {
+            return -1;  // the cell still holds a record from one lap ago
+        } else {
+            position = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+}
+
+/* Copy the oldest record out; returns 0, or -1 if the ring is empty */
+static inline int ring_pop(RingBuffer *ring, void *record) {
+    uint64_t position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    for (;;) {
+        _Atomic uint64_t *seq = ring_cell_seq(ring, position);
+        int64_t turn = (int64_t)(atomic_load_explicit(seq, memory_order_acquire) - (position + 1));
+        if (turn == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->head, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                memcpy(record, (unsigned char *)seq + sizeof(uint64_t), ring->record_size);
+                atomic_store_explicit(seq, position + ring->capacity, memory_order_release);
+                return 0;
+            }
+        } else if (turn < 0) {
+            return -1;  // nothing published at this position yet
+        } else {
+            position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        }
+    }
+}
+
+/*
+ * Copy in up to count consecutive records; returns how many went in (0 if
+ * full). They occupy consecutive positions, so consumers see them in order.
+ */
+static inline uint32_t ring_push_batch(RingBuffer *ring, const void *records, uint32_t count) {
+    uint64_t position = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t free_cells;
+    for (;;) {
+        // Cells still free for this lap; only a producer that moves tail past them can take them
+        free_cells = 0;
+        while (free_cells < count &&
+               atomic_load_explicit(ring_cell_seq(ring, position + free_cells), memory_order_acquire) ==
+                   position + free_cells)
+            free_cells++;
+        if (free_cells == 0) {
+            uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            if (tail == position) return 0;  // the cell at tail holds last lap's record: full
+            position = tail;
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&ring->tail, &position, position + free_cells,
+                                                  memory_order_relaxed, memory_order_relaxed))
+            break;
+    }
+
+    for (uint32_t i = 0; i < free_cells; i++) {
+        _Atomic uint64_t *seq = ring_cell_seq(ring, position + i);
+        memcpy((unsigned char *)seq + sizeof(uint64_t),
+               (const unsigned char *)records + (size_t)i * ring->record_size, ring->record_size);
+        atomic_store_explicit(seq, position + i + 1, memory_order_release);
+    }
+    return free_cells;
+}
+
+/* Copy out up to max of the oldest records, in order; returns how many (0 if empty) */
+static inline uint32_t ring_pop_batch(RingBuffer *ring, void *records, uint32_t max) {
+    uint64_t position = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t ready;
+    for (;;) {
+        ready = 0;
+        while (ready < max &&
+               atomic_load_explicit(ring_cell_seq(ring, position + ready), memory_order_acquire) ==
+                   position + ready + 1)
+            ready++;
+        if (ready == 0) {
+            uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+            if (head == position) return 0;  // nothing published at head yet: empty
+            position = head;
+            continue;
+        }
+        if (atomic_compare_exchange_weak_explicit(&ring->head, &position, position + ready,
+                                                  memory_order_relaxed, memory_order_relaxed))
+            break;
+    }
+
+    for (uint32_t i = 0; i < ready; i++) {
+        _Atomic uint64_t *seq = ring_cell_seq(ring, position + i);
+        memcpy((unsigned char *)records + (size_t)i * ring->record_size,
+               (unsigned char *)seq + sizeof(uint64_t), ring->record_size);
+        atomic_store_explicit(seq, position + i + ring->capacity, memory_order_release);
+    }
+    return ready;
+}
+
+/* Approximate number of queued records (exact when no one is pushing or popping) */
+static inline uint64_t ring_size(RingBuffer *ring) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return tail > head ? tail - head : 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* Single producer, single consumer                                        */
+/* ---------------------------------------------------------------------- */
+
+typedef struct {
+    _Alignas(RING_CACHE_LINE) _Atomic uint64_t tail;  // producer: next position to fill
+    uint64_t head_cache;                              // producer: head as last read
+    _Alignas(RING_CACHE_LINE) _Atomic uint64_t head;  // consumer: next position to empty
+    uint64_t tail_cache;                              // consumer: tail as last read
+    _Alignas(RING_CACHE_LINE) uint32_t capacity;      // power of two
+    uint32_t mask;
+    uint32_t record_size;
+    uint32_t stride;                                  // bytes per cell, 8-aligned
+    _Alignas(RING_CACHE_LINE) unsigned char cells[];
+} SpscRing;
+
+/* Bytes needed for an SPSC ring of capacity (a power of two) records of record_size */
+static inline size_t spsc_bytes(uint32_t capacity, uint32_t record_size) {
+    return sizeof(SpscRing) + (size_t)capacity * ((record_size + 7) & ~7u);
+}
+
+/* Returns 0, or -1 if capacity is not a power of two */
+static inline int spsc_init(SpscRing *ring, uint32_t capacity, uint32_t record_size) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) return -1;
+    ring->capacity = capacity;
+    ring->mask = capacity - 1;
+    ring->record_size = record_size;
+    ring->stride = (record_size + 7) & ~7u;
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->head, 0);
+    ring->head_cache = 0;
+    ring->tail_cache = 0;
+    return 0;
+}
+
+static inline unsigned char *spsc_cell(SpscRing *ring, uint64_t position) {
+    return ring->cells + (size_t)(position & ring->mask) * ring->stride;
+}
+
+/* Producer only: copy in up to count records; returns how many went in (0 if full) */
+static inline uint32_t spsc_push_batch(SpscRing *ring, const void *records, uint32_t count) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t room = ring->capacity - (tail - ring->head_cache);
+    if (room < count) {
+        ring->head_cache = atomic_load_explicit(&ring->head, memory_order_acquire);
+        room = ring->capacity - (tail - ring->head_cache);
+        if (room < count) count = (uint32_t)room;
+    }
+    for (uint32_t i = 0; i < count; i++)
+        memcpy(spsc_cell(ring, tail + i), (const unsigned char *)records + (size_t)i * ring->record_size,
+               ring->record_size);
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
+
+/* Consumer only: copy out up to max of the oldest records; returns how many (0 if empty) */
+static inline uint32_t spsc_pop_batch(SpscRing *ring, void *records, uint32_t max) {
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t ready = ring->tail_cache - head;
+    if (ready < max) {
+        ring->tail_cache = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        ready = ring->tail_cache - head;
+        if (ready < max) max = (uint32_t)ready;
+    }
+    for (uint32_t i = 0; i < max; i++)
+        memcpy((unsigned char *)records + (size_t)i * ring->record_size, spsc_cell(ring, head + i),
+               ring->record_size);
+    atomic_store_explicit(&ring->head, head + max, memory_order_release);
+    return max;
+}
+
+/* Producer only: returns 0, or -1 if the ring is full */
+static inline int spsc_push(SpscRing *ring, const void *record) {
+    return spsc_push_batch(ring, record, 1) == 1 ? 0 : -1;
+}
+
+/* Consumer only: returns 0, or -1 if the ring is empty */
+static inline int spsc_pop(SpscRing *ring, void *record) {
+    return spsc_pop_batch(ring, record, 1) == 1 ? 0 : -1;
+}
+
+/* Queued records as seen from either side (exact from a side that is not running) */
+static inline uint64_t spsc_size(SpscRing *ring) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return tail > head ? tail - head : 0;
+}
+
+#endif
@@ -7,22 +7,68 @@
  * - Combined "Ready Queue & Execution" visualization (Gantt + Events)
  * - Clean, screenshot-ready output
  * - All 4 algorithms: Priority, FCFS, SJF, Round Robin
+ * - MLFQ with aging so background work cannot starve
+ * - Policy-descriptor engine with specialized kernels (SRTF, Priority RR in sweeps)
+ * - Round Robin on an O(1) ring (Ring_Buffer.h) instead of the heap
+ * - Trace-file workloads (CSV or binary) for real arrival logs
+ * - Columnar binary result files and a run-to-run diff of emergency response
+ * - Parallel parameter sweeps across all cores
+ * - SMP simulation: per-core run queues, work stealing, emergency affinity
+ * - Benchmark mode with scaling and baseline regression checks
+ * - p50/p95/p99/p99.9 latency per priority class from fixed-size histograms
+ * - Online dispatcher API (submit / advance / poll) with incremental metrics
+ * - Live validation: replay a workload on real threads under SCHED_FIFO,
+ *   SCHED_RR and SCHED_OTHER and compare against the model
  * 
- * Compile: gcc -o hpms_scheduler hpms_scheduler.c
+ * Compile: gcc -O2 -pthread -o hpms_scheduler hpms_scheduler.c -lm
  * Run:     ./hpms_scheduler
+ *          ./hpms_scheduler --trace ed_arrivals.csv [--details]
+ *          ./hpms_scheduler --trace ed_arrivals.csv --export timeline.json --policy MLFQ
+ *          ./hpms_scheduler --trace ed_arrivals.trace --export before.hpmsr
+ *          ./hpms_scheduler --diff before.hpmsr after.hpmsr
+ *          ./hpms_scheduler --convert ed_arrivals.csv ed_arrivals.trace
+ *          ./hpms_scheduler --sweep --quanta 1-32 ed_arrivals.trace
+ *          ./hpms_scheduler --smp 32 --affinity ed_arrivals.trace
+ *          ./hpms_scheduler --bench --out bench.csv [--baseline last_release.csv]
+ *          ./hpms_scheduler --online [--policy Priority] [ed_arrivals.trace]
+ *          sudo ./hpms_scheduler --live [--unit-ms 5] [--cpu 0] [ed_arrivals.csv]
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "Arena.h"
+#include "Latency_Histogram.h"
+#include "Ready_Queue.h"
+#include "Ring_Buffer.h"
 
-#define MAX_PROCESSES 20
 #define TIME_QUANTUM 4
+#define SIM_ARENA_DEFAULT (64 * 1024)   // fits the built-in scenarios in one block
+#define WORKLOAD_PRINT_LIMIT 50         // trace workloads print only their head
+#define SMP_MAX_CORES 64
+#define PRIORITY_CLASSES 5                // medical priorities 1..5
 
 typedef struct {
     int pid;
     char name[50];
-    char medical_class[40];
+    const char *medical_class;   // interned: one copy per distinct class
     int priority;        // 1 = Emergency (highest), 5 = Background (lowest)
     int arrival_time;
     int burst_time;
@@ -44,11 +90,344 @@ typedef struct {
     int context_switches;
     float throughput;
     int total_time;
+    int cores;                   // SMP runs only; uniprocessor runs report 1
+    int migrations;              // dispatches on a different core than last time
+    int steals;                  // dispatches taken from another core's queue
+    float core_utilization[SMP_MAX_CORES];
+    // Per priority class (index priority - 1), fixed size at any n, mergeable
+    LatencyHistogram response_hist[PRIORITY_CLASSES];
+    LatencyHistogram waiting_hist[PRIORITY_CLASSES];
 } Metrics;
 
+const char *priority_class_names[PRIORITY_CLASSES] = {
+    "Emergency", "Urgent", "Standard", "Non-critical", "Background"
+};
+
+/*
+ * Execution event log, grown in the run arena. Events can also be streamed
+ * to an export file as they happen (CSV, Chrome trace JSON viewable in
+ * chrome://tracing or Perfetto, or the columnar result format below); a
+ * stream-only log keeps no events in memory.
+ */
+#define EVENT_START    0
+#define EVENT_PREEMPT  1
+#define EVENT_COMPLETE 2
+
+#define EXPORT_CSV      0
+#define EXPORT_CHROME   1
+#define EXPORT_COLUMNAR 2
+
+#define EXPORT_BUFFER_BYTES (1 << 20)   // stdio buffer for every export format
+
+typedef struct {
+    int time;
+    int process;         // process-table index
+    int type;            // EVENT_START, EVENT_PREEMPT or EVENT_COMPLETE
+} SchedEvent;
+
+typedef struct {
+    SchedEvent *events;  // NULL when the log only streams
+    int count;
+    int capacity;
+    Arena *arena;
+    FILE *export;        // streaming export, NULL if none
+    int export_format;   // EXPORT_CSV, EXPORT_CHROME or EXPORT_COLUMNAR
+    const Process *proc; // names and priorities for the export, results at close
+    int process_count;
+    long exported;
+    struct ResultBlock *block;  // columnar export: events not yet written
+} EventLog;
+
+/*
+ * Columnar Result Files
+ *
+ * Binary, every column a packed little-endian array, so a run over millions
+ * of processes is a few bytes per process and loads without parsing:
+ *
+ *   ResultHeader                  "HPMSRES1", version, policy name
+ *   event blocks, repeated:       uint32 count, then int32 time[count],
+ *                                 int32 process[count], uint8 type[count],
+ *                                 zero padding to 4 bytes
+ *   uint32 0                      end of events
+ *   uint32 n, then six int32[n]   pid, priority, arrival, burst, start,
+ *                                 completion (start -1 = never ran)
+ *
+ * Events stream out a block at a time as the run produces them; the
+ * per-process columns are written when the run ends. --diff compares two
+ * result files.
+ */
+#define RESULT_MAGIC "HPMSRES1"
+#define RESULT_VERSION 1
+#define RESULT_BLOCK_EVENTS 65536
+#define RESULT_COLUMNS 6
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    char policy[32];
+} ResultHeader;
+
+typedef struct ResultBlock {
+    int count;
+    int32_t time[RESULT_BLOCK_EVENTS];
+    int32_t process[RESULT_BLOCK_EVENTS];
+    uint8_t type[RESULT_BLOCK_EVENTS];
+} ResultBlock;
+
+/*
+ * Hot scheduling state as structure-of-arrays columns. Process stays the
+ * cold record (name, class) and receives the results when a run ends, so
+ * the engine loops and metric reductions stream through dense int arrays
+ * instead of dragging ~130-byte structs through the cache.
+ */
+typedef struct {
+    int n;
+    int *pid;
+    int *priority;
+    int *arrival;
+    int *burst;
+    int *remaining;
+    int *start;          // -1 until first dispatch
+    int *completion;     // 0 until complete
+} SimTable;
+
+/* Arena allocation for the simulator; running out of memory is fatal */
+void *sim_alloc(Arena *arena, size_t bytes) {
+    void *ptr = arena_alloc(arena, bytes);
+    if (ptr == NULL) {
+        fprintf(stderr, "Simulator out of memory (%zu bytes)\n", bytes);
+        exit(1);
+    }
+    return ptr;
+}
+
+/* Arena size for a workload of n processes plus one algorithm run */
+size_t sim_arena_bytes(long n) {
+    size_t per_process = 2 * sizeof(Process)      // workload + run copy
+                       + 7 * sizeof(int)          // SimTable columns
+                       + 2 * sizeof(int)          // arrival order + heap position
+                       + 2 * sizeof(ReadyEntry)   // ready heap + MLFQ aging heap
+                       + 2 * sizeof(int)          // MLFQ levels + aging heap position
+                       + 4 * sizeof(SchedEvent);  // initial event log
+    size_t bytes = (size_t)n * per_process + 4096;
+    return bytes > SIM_ARENA_DEFAULT ? bytes : SIM_ARENA_DEFAULT;
+}
+
+/* Gather the hot columns of a workload into the run arena */
+SimTable sim_table_load(const Process proc[], int n, Arena *arena) {
+    SimTable t;
+    int *columns = sim_alloc(arena, 7 * (size_t)n * sizeof(int));
+    t.n = n;
+    t.pid = columns;
+    t.priority = columns + (size_t)n;
+    t.arrival = columns + 2 * (size_t)n;
+    t.burst = columns + 3 * (size_t)n;
+    t.remaining = columns + 4 * (size_t)n;
+    t.start = columns + 5 * (size_t)n;
+    t.completion = columns + 6 * (size_t)n;
+    for (int i = 0; i < n; i++) {
+        t.pid[i] = proc[i].pid;
+        t.priority[i] = proc[i].priority;
+        t.arrival[i] = proc[i].arrival_time;
+        t.burst[i] = proc[i].burst_time;
+        t.remaining[i] = proc[i].remaining_time;
+        t.start[i] = proc[i].start_time;
+        t.completion[i] = proc[i].completion_time;
+    }
+    return t;
+}
+
+/* Publish run results back to the Process records */
+void sim_table_store(const SimTable *t, Process proc[]) {
+    for (int i = 0; i < t->n; i++) {
+        proc[i].remaining_time = t->remaining[i];
+        proc[i].start_time = t->start[i];
+        proc[i].completion_time = t->completion[i];
+        if (t->completion[i] > 0) {
+            proc[i].response_time = t->start[i] - t->arrival[i];
+            proc[i].turnaround_time = t->completion[i] - t->arrival[i];
+            proc[i].waiting_time = proc[i].turnaround_time - t->burst[i];
+        }
+    }
+}
+
+/* Copy a workload into the arena for one algorithm run */
+Process *copy_workload(Arena *arena, const Process proc[], int n) {
+    Process *copy = sim_alloc(arena, (size_t)n * sizeof(Process));
+    memcpy(copy, proc, (size_t)n * sizeof(Process));
+    return copy;
+}
+
+void event_log_init(EventLog *log, Arena *arena, int capacity) {
+    memset(log, 0, sizeof(*log));
+    log->arena = arena;
+    log->capacity = capacity > 16 ? capacity : 16;
+    log->events = sim_alloc(arena, (size_t)log->capacity * sizeof(SchedEvent));
+}
+
+void export_write_string(FILE *out, int format, const char *text) {
+    fputc('"', out);
+    for (const char *c = text; *c != '\0'; c++) {
+        if (format == EXPORT_CSV) {
+            if (*c == '"') fputc('"', out);
+            fputc(*c, out);
+        } else if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if ((unsigned char)*c < 0x20) {
+            fprintf(out, "\\u%04x", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+/* Write the buffered events as one block */
+void result_flush_block(EventLog *log) {
+    ResultBlock *b = log->block;
+    uint32_t count = (uint32_t)b->count;
+    static const uint8_t pad[3] = {0};
+    if (count == 0) return;
+    fwrite(&count, sizeof(count), 1, log->export);
+    fwrite(b->time, sizeof(int32_t), count, log->export);
+    fwrite(b->process, sizeof(int32_t), count, log->export);
+    fwrite(b->type, 1, count, log->export);
+    fwrite(pad, 1, (4 - count % 4) % 4, log->export);
+    b->count = 0;
+}
+
+/* End of events, then the per-process result columns */
+void result_write_processes(EventLog *log) {
+    static int32_t chunk[4096];
+    uint32_t zero = 0, n = (uint32_t)log->process_count;
+    fwrite(&zero, sizeof(zero), 1, log->export);
+    fwrite(&n, sizeof(n), 1, log->export);
+    for (int c = 0; c < RESULT_COLUMNS; c++) {
+        for (int base = 0; base < log->process_count; base += 4096) {
+            int len = log->process_count - base < 4096 ? log->process_count - base : 4096;
+            for (int i = 0; i < len; i++) {
+                const Process *p = &log->proc[base + i];
+                int values[RESULT_COLUMNS] = {p->pid, p->priority, p->arrival_time, p->burst_time,
+                                              p->start_time, p->completion_time};
+                chunk[i] = values[c];
+            }
+            fwrite(chunk, sizeof(int32_t), len, log->export);
+        }
+    }
+}
+
+void export_write_event(EventLog *log, int time, int process, int type) {
+    static const char *csv_names[] = {"start", "preempt", "complete"};
+    const Process *p = &log->proc[process];
+    FILE *out = log->export;
+    
+    if (log->export_format == EXPORT_COLUMNAR) {
+        ResultBlock *b = log->block;
+        b->time[b->count] = time;
+        b->process[b->count] = process;
+        b->type[b->count] = (uint8_t)type;
+        if (++b->count == RESULT_BLOCK_EVENTS) result_flush_block(log);
+        return;
+    }
+    
+    if (log->export_format == EXPORT_CSV) {
+        fprintf(out, "%d,%s,%d,", time, csv_names[type], p->pid);
+        export_write_string(out, EXPORT_CSV, p->name);
+        fprintf(out, ",%d\n", p->priority);
+        return;
+    }
+    
+    // One CPU track: each run slice is a begin/end pair, times in microseconds
+    fprintf(out, "%s\n{\"name\":", log->exported > 0 ? "," : "");
+    export_write_string(out, EXPORT_CHROME, p->name);
+    fprintf(out, ",\"cat\":\"P%d\",\"ph\":\"%s\",\"ts\":%lld,\"pid\":1,\"tid\":0",
+            p->priority, type == EVENT_START ? "B" : "E", (long long)time * 1000000);
+    if (type == EVENT_COMPLETE) fprintf(out, ",\"args\":{\"pid\":%d,\"completed\":true}", p->pid);
+    fputc('}', out);
+}
+
+static int path_has_suffix(const char *path, const char *suffix) {
+    size_t len = strlen(path), suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(path + len - suffix_len, suffix) == 0;
+}
+
+/*
+ * Stream the events of a run of policy over proc[0..n) to path: ".json" =
+ * Chrome trace, ".hpmsr" = columnar result file (events plus per-process
+ * results), otherwise CSV. Returns -1 if it cannot be opened.
+ */
+int event_log_open_export(EventLog *log, const char *path, const Process *proc, int n,
+                          const char *policy) {
+    log->export = fopen(path, "wb");
+    if (log->export == NULL) {
+        perror("Cannot open export file");
+        return -1;
+    }
+    setvbuf(log->export, NULL, _IOFBF, EXPORT_BUFFER_BYTES);
+    log->export_format = path_has_suffix(path, ".json")  ? EXPORT_CHROME
+                       : path_has_suffix(path, ".hpmsr") ? EXPORT_COLUMNAR
+                                                         : EXPORT_CSV;
+    log->proc = proc;
+    log->process_count = n;
+    log->exported = 0;
+    if (log->export_format == EXPORT_COLUMNAR) {
+        log->block = malloc(sizeof(ResultBlock));
+        if (log->block == NULL) {
+            perror("malloc failed");
+            fclose(log->export);
+            return -1;
+        }
+        log->block->count = 0;
+        ResultHeader header = {{0}, RESULT_VERSION, 0, {0}};
+        memcpy(header.magic, RESULT_MAGIC, 8);
+        snprintf(header.policy, sizeof(header.policy), "%s", policy);
+        fwrite(&header, sizeof(header), 1, log->export);
+    } else if (log->export_format == EXPORT_CSV) {
+        fprintf(log->export, "time,event,pid,name,priority\n");
+    } else {
+        fprintf(log->export, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    }
+    return 0;
+}
+
+/* Finish and close the export (after the run: results are read from proc); -1 if any write failed */
+int event_log_close_export(EventLog *log) {
+    if (log->export_format == EXPORT_CHROME) {
+        fprintf(log->export, "\n]}\n");
+    } else if (log->export_format == EXPORT_COLUMNAR) {
+        result_flush_block(log);
+        result_write_processes(log);
+        free(log->block);
+        log->block = NULL;
+    }
+    int status = ferror(log->export) ? -1 : 0;
+    if (fclose(log->export) != 0) status = -1;
+    log->export = NULL;
+    return status;
+}
+
+void event_log_push(EventLog *log, int time, int process, int type) {
+    if (log->export != NULL) {
+        export_write_event(log, time, process, type);
+        log->exported++;
+    }
+    if (log->events == NULL) return;
+    
+    if (log->count == log->capacity) {
+        // Grow by doubling; the old array stays in the arena until the next rewind
+        SchedEvent *grown = sim_alloc(log->arena, 2 * (size_t)log->capacity * sizeof(SchedEvent));
+        memcpy(grown, log->events, (size_t)log->count * sizeof(SchedEvent));
+        log->events = grown;
+        log->capacity *= 2;
+    }
+    log->events[log->count++] = (SchedEvent){time, process, type};
+}
+
 /* Initialize Emergency Scenario - Mass Casualty */
-void init_emergency_scenario(Process proc[], int *n) {
+Process *init_emergency_scenario(Arena *arena, int *n) {
     *n = 12;
+    Process *proc = sim_alloc(arena, *n * sizeof(Process));
     
     // Background process
     proc[0] = (Process){0, "Background Report", "Routine Documentation", 5, 0, 30, 30, 0, 0, 0, -1, -1};
@@ -67,11 +446,14 @@ void init_emergency_scenario(Process proc[], int *n) {
     proc[9] = (Process){9, "Admin Task", "Non-critical Admin", 4, 15, 8, 8, 0, 0, 0, -1, -1};
     proc[10] = (Process){10, "Lab Processing #2", "Urgent - Lab Results", 2, 18, 9, 9, 0, 0, 0, -1, -1};
     proc[11] = (Process){11, "Database Backup", "Background Maintenance", 5, 20, 25, 25, 0, 0, 0, -1, -1};
+    
+    return proc;
 }
 
 /* Initialize Normal Scenario */
-void init_normal_scenario(Process proc[], int *n) {
+Process *init_normal_scenario(Arena *arena, int *n) {
     *n = 8;
+    Process *proc = sim_alloc(arena, *n * sizeof(Process));
     
     proc[0] = (Process){0, "Report Generation", "Routine", 5, 0, 20, 20, 0, 0, 0, -1, -1};
     proc[1] = (Process){1, "Check-in #1", "Standard", 3, 3, 4, 4, 0, 0, 0, -1, -1};
@@ -81,388 +463,1388 @@ void init_normal_scenario(Process proc[], int *n) {
     proc[5] = (Process){5, "Lab Processing #2", "Urgent", 2, 15, 7, 7, 0, 0, 0, -1, -1};
     proc[6] = (Process){6, "Admin Task", "Routine", 4, 18, 6, 6, 0, 0, 0, -1, -1};
     proc[7] = (Process){7, "Check-in #3", "Standard", 3, 22, 4, 4, 0, 0, 0, -1, -1};
+    
+    return proc;
 }
 
 /* Initialize Best Case Scenario */
-void init_best_scenario(Process proc[], int *n) {
+Process *init_best_scenario(Arena *arena, int *n) {
     *n = 5;
+    Process *proc = sim_alloc(arena, *n * sizeof(Process));
     
     proc[0] = (Process){0, "Routine Check-in", "Standard", 3, 0, 5, 5, 0, 0, 0, -1, -1};
     proc[1] = (Process){1, "Lab Result Processing", "Urgent", 2, 8, 10, 10, 0, 0, 0, -1, -1};
     proc[2] = (Process){2, "Admin Task", "Routine", 4, 15, 8, 8, 0, 0, 0, -1, -1};
     proc[3] = (Process){3, "Emergency Patient", "Critical", 1, 20, 3, 3, 0, 0, 0, -1, -1};
     proc[4] = (Process){4, "Report Generation", "Background", 5, 25, 12, 12, 0, 0, 0, -1, -1};
+    
+    return proc;
 }
 
-/* Calculate Metrics */
-Metrics calculate_metrics(Process proc[], int n, int total_time) {
-    Metrics m = {0, 0, 0, 999, 0, 0, 0, 0, total_time};
-    
-    float sum_response = 0, sum_turnaround = 0, sum_waiting = 0;
-    int completed = 0, total_burst = 0;
-    
-    for (int i = 0; i < n; i++) {
-        if (proc[i].completion_time > 0) {
-            sum_response += proc[i].response_time;
-            sum_turnaround += proc[i].turnaround_time;
-            sum_waiting += proc[i].waiting_time;
-            total_burst += proc[i].burst_time;
-            completed++;
-            
-            // Track emergency response times (Priority 1)
-            if (proc[i].priority == 1) {
-                if (proc[i].response_time < m.emergency_response_min)
-                    m.emergency_response_min = proc[i].response_time;
-                if (proc[i].response_time > m.emergency_response_max)
-                    m.emergency_response_max = proc[i].response_time;
-            }
+/*
+ * Trace-File Workloads
+ *
+ * CSV:    pid,priority,arrival,burst,medical_class[,name]
+ *         One process per line; '#' comments and a header line are skipped.
+ * Binary: "HPMSTRC1" header, class-name table, then fixed 20-byte records
+ *         (pid, priority, arrival, burst, class id) as little-endian int32.
+ *
+ * The file is mmap'd and parsed in place: fields are read straight from
+ * the mapping and medical classes are interned, so a million rows sharing
+ * a handful of classes store each class name once.
+ */
+#define TRACE_MAGIC "HPMSTRC1"
+#define TRACE_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t class_count;
+    uint64_t record_count;
+} TraceHeader;           // followed by class_count x {uint16 length, bytes}
+
+typedef struct {
+    int32_t pid;
+    int32_t priority;
+    int32_t arrival_time;
+    int32_t burst_time;
+    uint32_t class_id;
+} TraceRecord;
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    int binary;
+    long rows;           // process count (upper bound for CSV)
+} TraceFile;
+
+/* Interned medical-class strings (open addressing, arena backed) */
+typedef struct {
+    const char **slots;
+    int capacity;        // power of two
+    int count;
+    Arena *arena;
+} StringTable;
+
+uint32_t hash_bytes(const char *s, size_t len) {
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char)s[i]) * 16777619u;
+    return h;
+}
+
+void string_table_init(StringTable *t, Arena *arena, int capacity) {
+    t->arena = arena;
+    t->capacity = capacity;
+    t->count = 0;
+    t->slots = sim_alloc(arena, capacity * sizeof(char *));
+    memset(t->slots, 0, capacity * sizeof(char *));
+}
+
+const char *intern(StringTable *t, const char *s, size_t len) {
+    if (2 * (t->count + 1) > t->capacity) {
+        const char **old = t->slots;
+        int old_capacity = t->capacity;
+        string_table_init(t, t->arena, 2 * old_capacity);
+        for (int i = 0; i < old_capacity; i++) {
+            if (old[i] == NULL) continue;
+            uint32_t slot = hash_bytes(old[i], strlen(old[i])) & (t->capacity - 1);
+            while (t->slots[slot] != NULL) slot = (slot + 1) & (t->capacity - 1);
+            t->slots[slot] = old[i];
+            t->count++;
         }
     }
     
-    m.avg_response_time = completed > 0 ? sum_response / completed : 0;
-    m.avg_turnaround_time = completed > 0 ? sum_turnaround / completed : 0;
-    m.avg_waiting_time = completed > 0 ? sum_waiting / completed : 0;
-    m.cpu_utilization = total_time > 0 ? ((float)total_burst / total_time) * 100 : 0;
-    m.throughput = total_time > 0 ? (float)completed / total_time : 0;
-    
-    if (m.emergency_response_min == 999) m.emergency_response_min = 0;
+    uint32_t slot = hash_bytes(s, len) & (t->capacity - 1);
+    while (t->slots[slot] != NULL) {
+        if (strncmp(t->slots[slot], s, len) == 0 && t->slots[slot][len] == '\0')
+            return t->slots[slot];
+        slot = (slot + 1) & (t->capacity - 1);
+    }
     
-    return m;
+    char *copy = sim_alloc(t->arena, len + 1);
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    t->slots[slot] = copy;
+    t->count++;
+    return copy;
 }
 
-/* Priority Scheduling (Preemptive) */
-Metrics priority_scheduling(Process proc[], int n, int verbose) {
-    Process temp[MAX_PROCESSES];
-    for (int i = 0; i < n; i++) temp[i] = proc[i];
+/* Map a trace file and size its workload; returns 0 on success */
+int trace_open(const char *path, TraceFile *trace) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("Cannot open trace file");
+        return -1;
+    }
     
-    int current_time = 0, completed = 0, context_switches = 0;
-    int is_running = -1;
-    int events[200][3]; // time, pid, event_type (0=start, 1=preempt, 2=complete)
-    int event_count = 0;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        fprintf(stderr, "Trace file %s is empty or unreadable\n", path);
+        close(fd);
+        return -1;
+    }
     
-    while (completed < n) {
-        int next = -1, highest_priority = 999;
-        
-        for (int i = 0; i < n; i++) {
-            if (temp[i].arrival_time <= current_time && 
-                temp[i].remaining_time > 0 &&
-                temp[i].priority < highest_priority) {
-                highest_priority = temp[i].priority;
-                next = i;
-            }
-        }
-        
-        if (next == -1) {
-            current_time++;
-            continue;
-        }
-        
-        if (is_running != next) {
-            if (is_running != -1 && temp[is_running].remaining_time > 0) {
-                events[event_count][0] = current_time;
-                events[event_count][1] = is_running;
-                events[event_count][2] = 1; // Preempt
-                event_count++;
-            }
-            
-            if (temp[next].start_time == -1) {
-                temp[next].start_time = current_time;
-                temp[next].response_time = current_time - temp[next].arrival_time;
-            }
-            
-            events[event_count][0] = current_time;
-            events[event_count][1] = next;
-            events[event_count][2] = 0; // Start
-            event_count++;
-            
-            context_switches++;
-            is_running = next;
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap failed");
+        return -1;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    
+    trace->data = map;
+    trace->size = st.st_size;
+    trace->binary = trace->size >= sizeof(TraceHeader) &&
+                    memcmp(trace->data, TRACE_MAGIC, 8) == 0;
+    
+    if (trace->binary) {
+        // Every class takes at least its 2-byte length and every record its full size,
+        // so counts the file cannot hold are rejected before they size anything
+        TraceHeader header;
+        memcpy(&header, trace->data, sizeof(header));
+        size_t body = trace->size - sizeof(header);
+        if ((size_t)header.class_count > body / 2 || header.record_count > body / sizeof(TraceRecord)) {
+            fprintf(stderr, "Binary trace truncated: header claims %u classes and %llu records in %zu bytes\n",
+                    header.class_count, (unsigned long long)header.record_count, trace->size);
+            munmap(map, st.st_size);
+            return -1;
         }
-        
-        temp[next].remaining_time--;
-        current_time++;
-        
-        if (temp[next].remaining_time == 0) {
-            temp[next].completion_time = current_time;
-            temp[next].turnaround_time = current_time - temp[next].arrival_time;
-            temp[next].waiting_time = temp[next].turnaround_time - temp[next].burst_time;
-            
-            events[event_count][0] = current_time;
-            events[event_count][1] = next;
-            events[event_count][2] = 2; // Complete
-            event_count++;
-            
-            completed++;
-            is_running = -1;
+        trace->rows = (long)header.record_count;
+    } else {
+        // Newline count sizes the table so the workload is one allocation
+        trace->rows = 1;
+        const unsigned char *p = trace->data, *end = p + trace->size;
+        while ((p = memchr(p, '\n', end - p)) != NULL) {
+            trace->rows++;
+            p++;
         }
     }
-    
-    if (verbose) {
-        printf("\nReady Queue & Execution (Gantt Chart with Key Events):\n");
-        printf("-------------------------------------------------------\n\n");
+    return 0;
+}
+
+void trace_close(TraceFile *trace) {
+    munmap((void *)trace->data, trace->size);
+}
+
+/* Parse a non-negative decimal field (leading spaces allowed) ending at ',' or end of line */
+int parse_field_int(const unsigned char **cursor, const unsigned char *end, int *value) {
+    const unsigned char *p = *cursor;
+    long v = 0;
+    while (p < end && *p == ' ') p++;
+    if (p == end || *p < '0' || *p > '9') return -1;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p++ - '0');
+        if (v > 0x7fffffff) return -1;
+    }
+    if (p < end && *p != ',') return -1;   // "12 ," or "12x": not a clean number
+    if (p < end) p++;
+    *cursor = p;
+    *value = (int)v;
+    return 0;
+}
+
+int validate_process(const Process *p, long where) {
+    if (p->priority < 1 || p->priority > 5 || p->burst_time <= 0 || p->arrival_time < 0) {
+        fprintf(stderr, "Trace record %ld: need priority 1-5, burst > 0, arrival >= 0\n", where);
+        return -1;
+    }
+    if (p->burst_time > INT_MAX - p->arrival_time) {
+        fprintf(stderr, "Trace record %ld: arrival + burst overflows the clock\n", where);
+        return -1;
+    }
+    return 0;
+}
+
+Process *parse_csv_trace(const TraceFile *trace, Arena *arena, int *n) {
+    Process *proc = sim_alloc(arena, trace->rows * sizeof(Process));
+    StringTable classes;
+    string_table_init(&classes, arena, 64);
+    
+    const unsigned char *p = trace->data, *end = p + trace->size;
+    long line = 0;
+    int count = 0;
+    
+    while (p < end) {
+        const unsigned char *eol = memchr(p, '\n', end - p);
+        if (eol == NULL) eol = end;
+        const unsigned char *next_line = eol + 1;
+        line++;
+        if (eol > p && eol[-1] == '\r') eol--;
         
-        // Gantt Chart
-        printf("Complete Timeline (0-%ds):\n", current_time);
-        printf("Time:  ");
-        for (int t = 0; t <= current_time; t += 10) {
-            printf("%-5d", t);
-        }
-        printf("\n       ");
-        for (int t = 0; t <= current_time; t += 10) {
-            printf("|----");
+        int header = line == 1 && (*p < '0' || *p > '9');
+        if (eol == p || *p == '#' || header) {
+            p = next_line;
+            continue;
         }
-        printf("|\n");
         
-        // Draw each process
-        for (int i = 0; i < n; i++) {
-            printf("%-6s ", temp[i].name);
-            int printed = 0;
-            for (int t = 0; t < current_time; t++) {
-                int executing = 0;
-                // Check if this process was executing at time t
-                for (int e = 0; e < event_count - 1; e++) {
-                    if (events[e][1] == i && events[e][2] == 0) { // Start event
-                        int start = events[e][0];
-                        int end = current_time;
-                        // Find corresponding complete or preempt
-                        for (int e2 = e + 1; e2 < event_count; e2++) {
-                            if (events[e2][1] == i && (events[e2][2] == 1 || events[e2][2] == 2)) {
-                                end = events[e2][0];
-                                break;
-                            }
-                        }
-                        if (t >= start && t < end) {
-                            executing = 1;
-                            break;
-                        }
-                    }
-                }
-                
-                if (t % 5 == 0) {
-                    if (executing) {
-                        printf("■");
-                        printed++;
-                    } else {
-                        printf(" ");
-                    }
-                }
-            }
-            
-            // Add indicator for emergencies
-            if (temp[i].priority == 1) {
-                printf(" ⭐ %ds response", temp[i].response_time);
-            } else if (i == 0 && temp[i].remaining_time == 0) {
-                printf(" PREEMPT → Resume later");
-            }
-            printf("\n");
+        Process *proc_i = &proc[count];
+        if (parse_field_int(&p, eol, &proc_i->pid) != 0 ||
+            parse_field_int(&p, eol, &proc_i->priority) != 0 ||
+            parse_field_int(&p, eol, &proc_i->arrival_time) != 0 ||
+            parse_field_int(&p, eol, &proc_i->burst_time) != 0) {
+            fprintf(stderr, "Trace line %ld: expected pid,priority,arrival,burst,class\n", line);
+            return NULL;
         }
         
-        printf("\nLegend: ■ = Executing, ⭐ = Emergency patient\n");
-        
-        // Key Events
-        printf("\nKey Execution Events:\n");
-        printf("---------------------\n");
-        
-        int emergency_start = -1, emergency_end = -1;
+        const unsigned char *field = p, *comma = memchr(p, ',', eol - p);
+        const unsigned char *field_end = comma != NULL ? comma : eol;
+        proc_i->medical_class = intern(&classes, (const char *)field, field_end - field);
         
-        for (int e = 0; e < event_count; e++) {
-            int pid = events[e][1];
-            int time = events[e][0];
-            int type = events[e][2];
-            
-            // Only print important events
-            if (temp[pid].priority == 1) { // Emergency events
-                if (type == 0) {
-                    printf("%ds    %s starts → Response: %ds ", 
-                           time, temp[pid].name, temp[pid].response_time);
-                    if (temp[pid].response_time == 0) {
-                        printf("✓ IMMEDIATE\n");
-                    } else {
-                        printf("✓\n");
-                    }
-                    if (emergency_start == -1) emergency_start = time;
-                } else if (type == 2) {
-                    printf("%ds    %s completes\n", time, temp[pid].name);
-                    emergency_end = time;
-                }
-            } else if (e < 3 || type == 0) { // First few events or starts
-                if (type == 0) {
-                    printf("%ds    %s starts (P%d)\n", time, temp[pid].name, temp[pid].priority);
-                } else if (type == 1 && temp[pid].priority == 5) {
-                    printf("%ds    %s preempted by emergency\n", time, temp[pid].name);
-                }
-            }
+        if (comma != NULL) {
+            size_t len = eol - (comma + 1);
+            if (len >= sizeof(proc_i->name)) len = sizeof(proc_i->name) - 1;
+            memcpy(proc_i->name, comma + 1, len);
+            proc_i->name[len] = '\0';
+        } else {
+            snprintf(proc_i->name, sizeof(proc_i->name), "Trace #%d", proc_i->pid);
         }
         
-        if (emergency_start != -1 && emergency_end != -1) {
-            printf("%ds    All emergencies handled (%d seconds total)\n", 
-                   emergency_end, emergency_end - emergency_start);
+        proc_i->remaining_time = proc_i->burst_time;
+        proc_i->completion_time = proc_i->turnaround_time = proc_i->waiting_time = 0;
+        proc_i->response_time = proc_i->start_time = -1;
+        if (validate_process(proc_i, line) != 0) return NULL;
+        
+        count++;
+        p = next_line;
+    }
+    
+    *n = count;
+    return proc;
+}
+
+Process *parse_binary_trace(const TraceFile *trace, Arena *arena, int *n) {
+    TraceHeader header;
+    memcpy(&header, trace->data, sizeof(header));
+    if (header.version != TRACE_VERSION || header.record_count > 0x7fffffff) {
+        fprintf(stderr, "Unsupported binary trace (version %u)\n", header.version);
+        return NULL;
+    }
+    
+    // Class table: ids map straight to interned names
+    const unsigned char *p = trace->data + sizeof(header), *end = trace->data + trace->size;
+    const char **class_names = sim_alloc(arena, ((size_t)header.class_count + 1) * sizeof(char *));
+    StringTable classes;
+    string_table_init(&classes, arena, 64);
+    for (uint32_t c = 0; c < header.class_count; c++) {
+        uint16_t len = 0;
+        if (end - p >= 2) memcpy(&len, p, 2);
+        if (end - p < 2 || (size_t)(end - p - 2) < len) {
+            fprintf(stderr, "Binary trace truncated in class table\n");
+            return NULL;
         }
-        printf("%ds    All processes complete\n\n", current_time);
+        class_names[c] = intern(&classes, (const char *)p + 2, len);
+        p += 2 + len;
     }
+    p = trace->data + ((p - trace->data + 3) & ~(size_t)3);   // records are 4-byte aligned
     
-    Metrics m = calculate_metrics(temp, n, current_time);
-    m.context_switches = context_switches;
+    if ((size_t)(end - p) < header.record_count * sizeof(TraceRecord)) {
+        fprintf(stderr, "Binary trace truncated: expected %llu records\n",
+                (unsigned long long)header.record_count);
+        return NULL;
+    }
     
-    // Copy results back
-    for (int i = 0; i < n; i++) proc[i] = temp[i];
+    Process *proc = sim_alloc(arena, (size_t)header.record_count * sizeof(Process));
+    for (uint64_t i = 0; i < header.record_count; i++, p += sizeof(TraceRecord)) {
+        TraceRecord r;
+        memcpy(&r, p, sizeof(r));
+        if (r.class_id >= header.class_count) {
+            fprintf(stderr, "Trace record %llu: unknown class id %u\n", (unsigned long long)i, r.class_id);
+            return NULL;
+        }
+        proc[i] = (Process){r.pid, "", class_names[r.class_id], r.priority, r.arrival_time,
+                            r.burst_time, r.burst_time, 0, 0, 0, -1, -1};
+        snprintf(proc[i].name, sizeof(proc[i].name), "Trace #%d", r.pid);
+        if (validate_process(&proc[i], (long)i) != 0) return NULL;
+    }
     
-    return m;
+    *n = (int)header.record_count;
+    return proc;
 }
 
-/* FCFS Scheduling */
-Metrics fcfs_scheduling(Process proc[], int n) {
-    Process temp[MAX_PROCESSES];
-    for (int i = 0; i < n; i++) temp[i] = proc[i];
-    
-    int current_time = 0, context_switches = 0;
+/* Parse a mapped trace into the arena; NULL (with a message) on bad input */
+Process *load_trace(const TraceFile *trace, Arena *arena, int *n) {
+    return trace->binary ? parse_binary_trace(trace, arena, n)
+                         : parse_csv_trace(trace, arena, n);
+}
+
+/* Write a workload as a binary trace (used to convert CSV logs once) */
+int write_binary_trace(const char *path, const Process proc[], int n) {
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        perror("Cannot create trace file");
+        return -1;
+    }
     
+    // Class ids in first-seen order; class pointers are interned, so compare by address
+    const char **class_names = malloc(n * sizeof(char *));
+    uint32_t *class_ids = malloc(n * sizeof(uint32_t));
+    uint32_t class_count = 0;
     for (int i = 0; i < n; i++) {
-        if (current_time < temp[i].arrival_time)
-            current_time = temp[i].arrival_time;
-        
-        temp[i].start_time = current_time;
-        temp[i].response_time = current_time - temp[i].arrival_time;
-        current_time += temp[i].burst_time;
-        temp[i].completion_time = current_time;
-        temp[i].turnaround_time = current_time - temp[i].arrival_time;
-        temp[i].waiting_time = temp[i].turnaround_time - temp[i].burst_time;
-        temp[i].remaining_time = 0;
-        context_switches++;
+        uint32_t c = 0;
+        while (c < class_count && class_names[c] != proc[i].medical_class) c++;
+        if (c == class_count) class_names[class_count++] = proc[i].medical_class;
+        class_ids[i] = c;
+    }
+    
+    TraceHeader header = {{0}, TRACE_VERSION, class_count, (uint64_t)n};
+    memcpy(header.magic, TRACE_MAGIC, 8);
+    fwrite(&header, sizeof(header), 1, out);
+    long offset = sizeof(header);
+    for (uint32_t c = 0; c < class_count; c++) {
+        uint16_t len = (uint16_t)strlen(class_names[c]);
+        fwrite(&len, 2, 1, out);
+        fwrite(class_names[c], 1, len, out);
+        offset += 2 + len;
     }
+    static const char pad[3] = {0};
+    fwrite(pad, 1, (4 - offset % 4) % 4, out);
     
-    Metrics m = calculate_metrics(temp, n, current_time);
-    m.context_switches = context_switches;
+    for (int i = 0; i < n; i++) {
+        TraceRecord r = {proc[i].pid, proc[i].priority, proc[i].arrival_time,
+                         proc[i].burst_time, class_ids[i]};
+        fwrite(&r, sizeof(r), 1, out);
+    }
     
-    for (int i = 0; i < n; i++) proc[i] = temp[i];
-    return m;
+    free(class_names);
+    free(class_ids);
+    if (fclose(out) != 0) {
+        perror("Writing trace file failed");
+        return -1;
+    }
+    return 0;
 }
 
-/* SJF Scheduling */
-Metrics sjf_scheduling(Process proc[], int n) {
-    Process temp[MAX_PROCESSES];
-    for (int i = 0; i < n; i++) temp[i] = proc[i];
-    
-    int current_time = 0, completed = 0, context_switches = 0;
-    int is_completed[MAX_PROCESSES] = {0};
+/* Load a trace file into a freshly sized arena; returns NULL on failure */
+Process *open_trace_workload(const char *path, Arena *arena, int *n) {
+    TraceFile trace;
+    if (trace_open(path, &trace) != 0) return NULL;
+    
+    if (arena_init(arena, sim_arena_bytes(trace.rows)) != 0) {
+        perror("arena_init failed");
+        trace_close(&trace);
+        return NULL;
+    }
     
-    while (completed < n) {
-        int next = -1, shortest = 999999;
-        
-        for (int i = 0; i < n; i++) {
-            if (temp[i].arrival_time <= current_time && 
-                !is_completed[i] && 
-                temp[i].burst_time < shortest) {
-                shortest = temp[i].burst_time;
-                next = i;
-            }
-        }
+    Process *processes = load_trace(&trace, arena, n);
+    trace_close(&trace);
+    if (processes == NULL) arena_free(arena);
+    return processes;
+}
+
+/*
+ * Calculate Metrics into *m
+ * One branch-free pass over the hot columns: predicates become all-ones /
+ * all-zeros masks and sums use integer accumulators, so GCC vectorizes the
+ * loop with SSE2 by default and AVX2 under -O3 -march=native.
+ */
+void calculate_metrics(const SimTable *t, int total_time, Metrics *m) {
+    *m = (Metrics){.total_time = total_time};
+    const int *arrival = t->arrival, *burst = t->burst, *priority = t->priority;
+    const int *start = t->start, *completion = t->completion;
+    
+    long long sum_response = 0, sum_turnaround = 0, total_burst = 0;
+    int completed = 0, emergency_min = INT_MAX, emergency_max = INT_MIN;
+    
+    for (int i = 0; i < t->n; i++) {
+        int done = -(completion[i] > 0);
+        int response = start[i] - arrival[i];
+        int turnaround = completion[i] - arrival[i];
         
-        if (next == -1) {
-            current_time++;
-            continue;
-        }
+        sum_response += response & done;
+        sum_turnaround += turnaround & done;
+        total_burst += burst[i] & done;
+        completed -= done;
         
-        temp[next].start_time = current_time;
-        temp[next].response_time = current_time - temp[next].arrival_time;
-        current_time += temp[next].burst_time;
-        temp[next].completion_time = current_time;
-        temp[next].turnaround_time = current_time - temp[next].arrival_time;
-        temp[next].waiting_time = temp[next].turnaround_time - temp[next].burst_time;
-        temp[next].remaining_time = 0;
-        is_completed[next] = 1;
-        completed++;
-        context_switches++;
+        // Track emergency response times (Priority 1)
+        int emergency = done & -(priority[i] == 1);
+        int low = (response & emergency) | (INT_MAX & ~emergency);
+        int high = (response & emergency) | (INT_MIN & ~emergency);
+        emergency_min = low < emergency_min ? low : emergency_min;
+        emergency_max = high > emergency_max ? high : emergency_max;
     }
     
-    Metrics m = calculate_metrics(temp, n, current_time);
-    m.context_switches = context_switches;
+    // Latency histograms in their own pass so the loop above stays vectorized
+    for (int i = 0; i < t->n; i++) {
+        unsigned class = (unsigned)(priority[i] - 1);
+        if (completion[i] <= 0 || class >= PRIORITY_CLASSES) continue;
+        lh_record(&m->response_hist[class], (uint64_t)(start[i] - arrival[i]));
+        lh_record(&m->waiting_hist[class], (uint64_t)(completion[i] - arrival[i] - burst[i]));
+    }
     
-    for (int i = 0; i < n; i++) proc[i] = temp[i];
-    return m;
+    long long sum_waiting = sum_turnaround - total_burst;
+    m->avg_response_time = completed > 0 ? (float)sum_response / completed : 0;
+    m->avg_turnaround_time = completed > 0 ? (float)sum_turnaround / completed : 0;
+    m->avg_waiting_time = completed > 0 ? (float)sum_waiting / completed : 0;
+    m->cpu_utilization = total_time > 0 ? ((float)total_burst / total_time) * 100 : 0;
+    m->throughput = total_time > 0 ? (float)completed / total_time : 0;
+    m->cores = 1;
+    m->core_utilization[0] = m->cpu_utilization;
+    
+    if (emergency_max != INT_MIN) {
+        m->emergency_response_min = emergency_min;
+        m->emergency_response_max = emergency_max;
+    }
 }
 
-/* Round Robin Scheduling */
-Metrics round_robin_scheduling(Process proc[], int n) {
-    Process temp[MAX_PROCESSES];
-    for (int i = 0; i < n; i++) temp[i] = proc[i];
-    
-    int current_time = 0, completed = 0, context_switches = 0;
-    int queue[MAX_PROCESSES], front = 0, rear = 0;
-    int in_queue[MAX_PROCESSES] = {0};
+/*
+ * Key order: indices 0..n-1 sorted by (key[i], i), a stable sort on any
+ * int column. Sorted by arrival time it is the arrival order: the
+ * simulators walk it with a single cursor to find the next arrival, so
+ * simulated time jumps from event to event (arrival, quantum expiry,
+ * completion) instead of advancing one time unit at a time.
+ */
+typedef struct {
+    int key;
+    int index;
+} SortKey;
+
+int compare_sort_key(const void *a, const void *b) {
+    const SortKey *x = a, *y = b;
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+    return x->index - y->index;
+}
+
+int *sort_by_key(const int key[], int n, Arena *arena) {
+    int *order = sim_alloc(arena, (size_t)n * sizeof(int));
     
+    // Sort keys are scratch: released as soon as order[] is filled
+    ArenaMark scratch = arena_mark(arena);
+    SortKey *keys = sim_alloc(arena, (size_t)n * sizeof(SortKey));
     for (int i = 0; i < n; i++) {
-        if (temp[i].arrival_time == 0) {
-            queue[rear++] = i;
-            in_queue[i] = 1;
-        }
+        keys[i].key = key[i];
+        keys[i].index = i;
     }
+    qsort(keys, n, sizeof(SortKey), compare_sort_key);
+    for (int i = 0; i < n; i++) order[i] = keys[i].index;
+    arena_rewind(arena, scratch);
+    
+    return order;
+}
+
+/*
+ * Scheduling Engine
+ *
+ * One event-driven engine runs every algorithm. A policy descriptor says
+ * how the ready queue is keyed, whether a new arrival may preempt the
+ * running process, and the time quantum (0 = run to completion):
+ *
+ *   Priority (Preemptive)  key (priority, arrival, pid), preemptive
+ *   FCFS                   key (arrival, pid)
+ *   SJF                    key (burst, arrival, pid)
+ *   Round Robin            key (enqueue sequence), quantum
+ *
+ * schedule_engine() is always inlined, so DEFINE_SCHED_KERNEL stamps out a
+ * copy per built-in policy with the key function and preemption flag as
+ * compile-time constants: no indirect call in the inner loop. Policies
+ * built at runtime run through the same engine via schedule_generic().
+ */
+typedef void (*SchedKeyFn)(const SimTable *t, int i, int sequence, int key[3]);
+
+typedef struct SchedPolicy SchedPolicy;
+typedef void (*SchedKernel)(const SchedPolicy *policy, Process proc[], int n,
+                            Arena *arena, EventLog *log, Metrics *out);
+
+struct SchedPolicy {
+    const char *name;
+    int preemptive;      // an arrival with a smaller key preempts the running process
+    int quantum;         // time slice, 0 = run until completion or preemption
+    SchedKeyFn key;
+    SchedKernel kernel;  // specialized kernel, NULL = generic engine
+};
+
+static inline void key_priority(const SimTable *t, int i, int sequence, int key[3]) {
+    (void)sequence;
+    key[0] = t->priority[i]; key[1] = t->arrival[i]; key[2] = t->pid[i];
+}
+
+static inline void key_arrival(const SimTable *t, int i, int sequence, int key[3]) {
+    (void)sequence;
+    key[0] = t->arrival[i]; key[1] = t->pid[i]; key[2] = 0;
+}
+
+static inline void key_burst(const SimTable *t, int i, int sequence, int key[3]) {
+    (void)sequence;
+    key[0] = t->burst[i]; key[1] = t->arrival[i]; key[2] = t->pid[i];
+}
+
+static inline void key_remaining(const SimTable *t, int i, int sequence, int key[3]) {
+    (void)sequence;
+    key[0] = t->remaining[i]; key[1] = t->arrival[i]; key[2] = t->pid[i];
+}
+
+static inline void key_sequence(const SimTable *t, int i, int sequence, int key[3]) {
+    (void)t; (void)i;
+    key[0] = sequence; key[1] = 0; key[2] = 0;
+}
+
+static inline void key_priority_sequence(const SimTable *t, int i, int sequence, int key[3]) {
+    key[0] = t->priority[i]; key[1] = sequence; key[2] = 0;
+}
+
+static inline void engine_enqueue(ReadyQueue *ready, SchedKeyFn key_fn, const SimTable *t,
+                                  int i, int sequence) {
+    int key[3];
+    key_fn(t, i, sequence, key);
+    rq_push(ready, i, key[0], key[1], key[2]);
+}
+
+static inline __attribute__((always_inline))
+void schedule_engine(SchedKeyFn key_fn, int preemptive, int quantum,
+                     Process proc[], int n, Arena *arena, EventLog *log, Metrics *out) {
+    SimTable hot = sim_table_load(proc, n, arena);
+    int *order = sort_by_key(hot.arrival, n, arena), arrivals = 0;
+    
+    ReadyQueue ready;
+    rq_init(&ready, sim_alloc(arena, n * sizeof(ReadyEntry)),
+            sim_alloc(arena, n * sizeof(int)), n);
+    
+    int current_time = 0, completed = 0, context_switches = 0, sequence = 0;
+    int running = -1, running_seq = 0, slice_end = 0;
     
     while (completed < n) {
-        if (front == rear) {
-            current_time++;
-            for (int i = 0; i < n; i++) {
-                if (temp[i].arrival_time <= current_time && 
-                    temp[i].remaining_time > 0 && !in_queue[i]) {
-                    queue[rear++] = i;
-                    in_queue[i] = 1;
-                }
-            }
-            continue;
-        }
-        
-        int idx = queue[front++];
-        in_queue[idx] = 0;
+        while (arrivals < n && hot.arrival[order[arrivals]] <= current_time)
+            engine_enqueue(&ready, key_fn, &hot, order[arrivals++], sequence++);
+        int next_arrival = arrivals < n ? hot.arrival[order[arrivals]] : -1;
         
-        if (temp[idx].start_time == -1) {
-            temp[idx].start_time = current_time;
-            temp[idx].response_time = current_time - temp[idx].arrival_time;
-        }
-        
-        int exec_time = (temp[idx].remaining_time > TIME_QUANTUM) ? 
-                        TIME_QUANTUM : temp[idx].remaining_time;
-        
-        temp[idx].remaining_time -= exec_time;
-        current_time += exec_time;
-        context_switches++;
-        
-        for (int i = 0; i < n; i++) {
-            if (temp[i].arrival_time <= current_time && 
-                temp[i].remaining_time > 0 && !in_queue[i] && i != idx) {
-                queue[rear++] = i;
-                in_queue[i] = 1;
+        if (running == -1) {
+            running = rq_pop(&ready);
+            if (running == -1) {
+                current_time = next_arrival; // CPU idle: jump to next arrival
+                continue;
+            }
+            running_seq = sequence;
+            if (hot.start[running] == -1) hot.start[running] = current_time;
+            if (log) event_log_push(log, current_time, running, EVENT_START);
+            context_switches++;
+            
+            int slice = hot.remaining[running];
+            if (quantum > 0 && quantum < slice) slice = quantum;
+            slice_end = current_time + slice;
+        } else if (preemptive && !rq_empty(&ready)) {
+            // Arrival may preempt: compare against the running process's current key
+            ReadyEntry current = {{0, 0, 0}, running};
+            key_fn(&hot, running, running_seq, current.key);
+            if (rq_less(&ready.heap[0], &current)) {
+                if (log) event_log_push(log, current_time, running, EVENT_PREEMPT);
+                engine_enqueue(&ready, key_fn, &hot, running, sequence++);
+                running = -1;
+                continue;
             }
         }
         
-        if (temp[idx].remaining_time == 0) {
-            temp[idx].completion_time = current_time;
-            temp[idx].turnaround_time = current_time - temp[idx].arrival_time;
-            temp[idx].waiting_time = temp[idx].turnaround_time - temp[idx].burst_time;
+        // Run to the end of the slice, or to the next arrival if it may preempt
+        int stop = slice_end;
+        if (preemptive && next_arrival != -1 && next_arrival < stop) stop = next_arrival;
+        hot.remaining[running] -= stop - current_time;
+        current_time = stop;
+        
+        if (hot.remaining[running] == 0) {
+            hot.completion[running] = current_time;
+            if (log) event_log_push(log, current_time, running, EVENT_COMPLETE);
             completed++;
-        } else {
-            queue[rear++] = idx;
-            in_queue[idx] = 1;
+            running = -1;
+        } else if (current_time == slice_end) {
+            // Quantum expired: arrivals during the slice queue ahead of it
+            while (arrivals < n && hot.arrival[order[arrivals]] <= current_time)
+                engine_enqueue(&ready, key_fn, &hot, order[arrivals++], sequence++);
+            if (log) event_log_push(log, current_time, running, EVENT_PREEMPT);
+            engine_enqueue(&ready, key_fn, &hot, running, sequence++);
+            running = -1;
         }
     }
     
-    Metrics m = calculate_metrics(temp, n, current_time);
-    m.context_switches = context_switches;
-    
-    for (int i = 0; i < n; i++) proc[i] = temp[i];
-    return m;
+    sim_table_store(&hot, proc);
+    calculate_metrics(&hot, current_time, out);
+    out->context_switches = context_switches;
 }
 
-/* Print Process Workload */
-void print_workload(Process proc[], int n) {
-    printf("\nProcess Workload:\n");
-    printf("-----------------\n");
+#define DEFINE_SCHED_KERNEL(NAME, KEY_FN, PREEMPTIVE)                               \
+    void NAME(const SchedPolicy *policy, Process proc[], int n,                     \
+              Arena *arena, EventLog *log, Metrics *out) {                          \
+        schedule_engine(KEY_FN, PREEMPTIVE, policy->quantum, proc, n, arena, log, out); \
+    }
+
+DEFINE_SCHED_KERNEL(kernel_priority, key_priority, 1)
+DEFINE_SCHED_KERNEL(kernel_fcfs, key_arrival, 0)
+DEFINE_SCHED_KERNEL(kernel_sjf, key_burst, 0)
+DEFINE_SCHED_KERNEL(kernel_srtf, key_remaining, 1)
+DEFINE_SCHED_KERNEL(kernel_priority_rr, key_priority_sequence, 1)
+
+/* Push every arrival due by time onto the ring in one batch; returns how many */
+static inline int rr_admit(SpscRing *ready, const int order[], int arrivals, int n,
+                           const int arrival[], int time) {
+    int due = arrivals;
+    while (due < n && arrival[order[due]] <= time) due++;
+    spsc_push_batch(ready, order + arrivals, (uint32_t)(due - arrivals));
+    return due - arrivals;
+}
+
+/*
+ * Round Robin orders its ready queue by enqueue sequence alone, so it is a
+ * FIFO: this kernel keeps it in an SPSC ring (Ring_Buffer.h) instead of
+ * the heap, O(1) per dispatch, and arrivals due together go in with one
+ * batch push straight from the arrival order. A process is queued at most
+ * once, so a ring of the next power of two >= n wraps but never fills.
+ * It makes the same decisions as schedule_engine with key_sequence.
+ */
+void kernel_round_robin(const SchedPolicy *policy, Process proc[], int n, Arena *arena, EventLog *log,
+                        Metrics *out) {
+    SimTable hot = sim_table_load(proc, n, arena);
+    int *order = sort_by_key(hot.arrival, n, arena), arrivals = 0;
+
+    uint32_t capacity = 1;
+    while (capacity < (uint32_t)n) capacity *= 2;
+    uintptr_t raw = (uintptr_t)sim_alloc(arena, spsc_bytes(capacity, sizeof(int)) + RING_CACHE_LINE);
+    SpscRing *ready = (SpscRing *)((raw + RING_CACHE_LINE - 1) & ~(uintptr_t)(RING_CACHE_LINE - 1));
+    spsc_init(ready, capacity, sizeof(int));
+
+    int current_time = 0, completed = 0, context_switches = 0, running;
+    while (completed < n) {
+        arrivals += rr_admit(ready, order, arrivals, n, hot.arrival, current_time);
+        if (spsc_pop(ready, &running) != 0) {
+            current_time = hot.arrival[order[arrivals]]; // CPU idle: jump to next arrival
+            continue;
+        }
+        if (hot.start[running] == -1) hot.start[running] = current_time;
+        if (log) event_log_push(log, current_time, running, EVENT_START);
+        context_switches++;
+
+        int slice = hot.remaining[running];
+        if (policy->quantum > 0 && policy->quantum < slice) slice = policy->quantum;
+        hot.remaining[running] -= slice;
+        current_time += slice;
+
+        if (hot.remaining[running] == 0) {
+            hot.completion[running] = current_time;
+            if (log) event_log_push(log, current_time, running, EVENT_COMPLETE);
+            completed++;
+        } else {
+            // Quantum expired: arrivals during the slice queue ahead of it
+            arrivals += rr_admit(ready, order, arrivals, n, hot.arrival, current_time);
+            if (log) event_log_push(log, current_time, running, EVENT_PREEMPT);
+            spsc_push(ready, &running);
+        }
+    }
+
+    sim_table_store(&hot, proc);
+    calculate_metrics(&hot, current_time, out);
+    out->context_switches = context_switches;
+}
+
+void schedule_generic(const SchedPolicy *policy, Process proc[], int n,
+                      Arena *arena, EventLog *log, Metrics *out) {
+    schedule_engine(policy->key, policy->preemptive, policy->quantum,
+                    proc, n, arena, log, out);
+}
+
+/* Run a policy over proc[] in place, metrics into *out; log may be NULL */
+void schedule(const SchedPolicy *policy, Process proc[], int n, Arena *arena, EventLog *log,
+              Metrics *out) {
+    if (policy->kernel != NULL) policy->kernel(policy, proc, n, arena, log, out);
+    else schedule_generic(policy, proc, n, arena, log, out);
+}
+
+const SchedPolicy POLICY_PRIORITY    = {"Priority", 1, 0, key_priority, kernel_priority};
+const SchedPolicy POLICY_FCFS        = {"FCFS", 0, 0, key_arrival, kernel_fcfs};
+const SchedPolicy POLICY_SJF         = {"SJF", 0, 0, key_burst, kernel_sjf};
+const SchedPolicy POLICY_SRTF        = {"SRTF", 1, 0, key_remaining, kernel_srtf};
+const SchedPolicy POLICY_ROUND_ROBIN = {"Round Robin", 0, TIME_QUANTUM, key_sequence, kernel_round_robin};
+const SchedPolicy POLICY_PRIORITY_RR = {"Priority RR", 1, TIME_QUANTUM, key_priority_sequence, kernel_priority_rr};
+
+/*
+ * Multilevel Feedback Queue
+ *
+ * A process enters at the level of its medical priority (emergency = level 0)
+ * and level L gets quantum * (L + 1) of CPU per dispatch. Using up the slice
+ * demotes the process one level, so long CPU-bound work sinks; a process
+ * arriving or promoted above the running one preempts it.
+ *
+ * Aging: every MLFQ_AGING_INTERVAL seconds spent waiting promotes a process
+ * one level (decrease-key in the ready queue), so waiting work reaches level 0
+ * within (MLFQ_LEVELS - 1) * MLFQ_AGING_INTERVAL seconds and background jobs
+ * cannot starve behind a stream of emergencies.
+ *
+ * The ready queue is keyed (level, enqueue sequence), FIFO within a level;
+ * a second heap keyed by promotion deadline yields the next process to age.
+ */
+#define MLFQ_LEVELS 5
+#define MLFQ_AGING_INTERVAL 20
+
+static inline void mlfq_enqueue(ReadyQueue *ready, ReadyQueue *aging, const int level[],
+                                int i, int now, int sequence) {
+    rq_push(ready, i, level[i], sequence, 0);
+    if (level[i] > 0) rq_push(aging, i, now + MLFQ_AGING_INTERVAL, sequence, 0);
+}
+
+void kernel_mlfq(const SchedPolicy *policy, Process proc[], int n, Arena *arena, EventLog *log,
+                 Metrics *out) {
+    SimTable hot = sim_table_load(proc, n, arena);
+    int *order = sort_by_key(hot.arrival, n, arena), arrivals = 0;
+    int *level = sim_alloc(arena, n * sizeof(int));
+    int quantum = policy->quantum > 0 ? policy->quantum : TIME_QUANTUM;
+    
+    ReadyQueue ready, aging;
+    rq_init(&ready, sim_alloc(arena, n * sizeof(ReadyEntry)),
+            sim_alloc(arena, n * sizeof(int)), n);
+    rq_init(&aging, sim_alloc(arena, n * sizeof(ReadyEntry)),
+            sim_alloc(arena, n * sizeof(int)), n);
+    
+    int current_time = 0, completed = 0, context_switches = 0, sequence = 0;
+    int running = -1, slice_end = 0;
+    
+    while (completed < n) {
+        while (arrivals < n && hot.arrival[order[arrivals]] <= current_time) {
+            int i = order[arrivals++];
+            level[i] = hot.priority[i] - 1;
+            if (level[i] < 0) level[i] = 0;
+            if (level[i] >= MLFQ_LEVELS) level[i] = MLFQ_LEVELS - 1;
+            mlfq_enqueue(&ready, &aging, level, i, current_time, sequence++);
+        }
+        while (!rq_empty(&aging) && aging.heap[0].key[0] <= current_time) {
+            int i = aging.heap[0].index;
+            int queued_at = ready.heap[ready.position[i]].key[1];
+            level[i]--;
+            rq_update(&ready, i, level[i], queued_at, 0);
+            if (level[i] > 0)
+                rq_update(&aging, i, current_time + MLFQ_AGING_INTERVAL, queued_at, 0);
+            else
+                rq_remove(&aging, i);
+        }
+        int next_arrival = arrivals < n ? hot.arrival[order[arrivals]] : -1;
+        
+        if (running != -1 && current_time == slice_end) {
+            // Slice used up: demote behind anything that arrived meanwhile
+            if (level[running] < MLFQ_LEVELS - 1) level[running]++;
+            if (log) event_log_push(log, current_time, running, EVENT_PREEMPT);
+            mlfq_enqueue(&ready, &aging, level, running, current_time, sequence++);
+            running = -1;
+        }
+        
+        if (running == -1) {
+            running = rq_pop(&ready);
+            if (running == -1) {
+                current_time = next_arrival; // CPU idle: jump to next arrival
+                continue;
+            }
+            if (rq_contains(&aging, running)) rq_remove(&aging, running);
+            if (hot.start[running] == -1) hot.start[running] = current_time;
+            if (log) event_log_push(log, current_time, running, EVENT_START);
+            context_switches++;
+            
+            int slice = quantum * (level[running] + 1);
+            if (hot.remaining[running] < slice) slice = hot.remaining[running];
+            slice_end = current_time + slice;
+        } else if (!rq_empty(&ready) && ready.heap[0].key[0] < level[running]) {
+            // Preempted by a higher level: keeps its level, back of the line
+            if (log) event_log_push(log, current_time, running, EVENT_PREEMPT);
+            mlfq_enqueue(&ready, &aging, level, running, current_time, sequence++);
+            running = -1;
+            continue;
+        }
+        
+        // Run until the slice ends or an arrival or promotion may preempt
+        int stop = slice_end;
+        if (next_arrival != -1 && next_arrival < stop) stop = next_arrival;
+        if (!rq_empty(&aging) && aging.heap[0].key[0] < stop) stop = aging.heap[0].key[0];
+        hot.remaining[running] -= stop - current_time;
+        current_time = stop;
+        
+        if (hot.remaining[running] == 0) {
+            hot.completion[running] = current_time;
+            if (log) event_log_push(log, current_time, running, EVENT_COMPLETE);
+            completed++;
+            running = -1;
+        }
+    }
+    
+    sim_table_store(&hot, proc);
+    calculate_metrics(&hot, current_time, out);
+    out->context_switches = context_switches;
+}
+
+// MLFQ keeps its own (level, sequence) keys, so it has no key function
+const SchedPolicy POLICY_MLFQ = {"MLFQ", 1, TIME_QUANTUM, NULL, kernel_mlfq};
+
+/*
+ * Gantt chart and key events of a verbose run. The log is first folded into
+ * per-process run intervals (START to the next PREEMPT or COMPLETE) in one
+ * pass, then each row walks its own intervals alongside the time axis.
+ */
+void print_execution_chart(Process proc[], int n, const EventLog *log, int total_time, Arena *arena) {
+    printf("\nReady Queue & Execution (Gantt Chart with Key Events):\n");
+    printf("-------------------------------------------------------\n\n");
+    
+    // Run intervals grouped by process: rows [offset[i], offset[i + 1])
+    ArenaMark scratch = arena_mark(arena);
+    int *offset = sim_alloc(arena, (size_t)(n + 1) * sizeof(int));
+    int *open = sim_alloc(arena, (size_t)n * sizeof(int));
+    int *run_start = sim_alloc(arena, (size_t)log->count * sizeof(int));
+    int *run_end = sim_alloc(arena, (size_t)log->count * sizeof(int));
+    memset(offset, 0, (size_t)(n + 1) * sizeof(int));
+    for (int e = 0; e < log->count; e++)
+        if (log->events[e].type == EVENT_START) offset[log->events[e].process + 1]++;
+    for (int i = 0; i < n; i++) {
+        offset[i + 1] += offset[i];
+        open[i] = offset[i];
+    }
+    for (int e = 0; e < log->count; e++) {
+        const SchedEvent *ev = &log->events[e];
+        if (ev->type == EVENT_START) {
+            run_start[open[ev->process]] = ev->time;
+            run_end[open[ev->process]] = total_time; // until closed below
+        } else {
+            run_end[open[ev->process]++] = ev->time;
+        }
+    }
+    
+    // Gantt Chart
+    printf("Complete Timeline (0-%ds):\n", total_time);
+    printf("Time:  ");
+    for (int t = 0; t <= total_time; t += 10) {
+        printf("%-5d", t);
+    }
+    printf("\n       ");
+    for (int t = 0; t <= total_time; t += 10) {
+        printf("|----");
+    }
+    printf("|\n");
+    
+    // Draw each process, one column per 5 seconds
+    int rows = n < WORKLOAD_PRINT_LIMIT ? n : WORKLOAD_PRINT_LIMIT;
+    for (int i = 0; i < rows; i++) {
+        printf("%-6s ", proc[i].name);
+        int k = offset[i], last = offset[i + 1];
+        for (int t = 0; t < total_time; t += 5) {
+            while (k < last && run_end[k] <= t) k++;
+            printf(k < last && run_start[k] <= t ? "■" : " ");
+        }
+        
+        // Add indicator for emergencies
+        if (proc[i].priority == 1) {
+            printf(" ⭐ %ds response", proc[i].response_time);
+        } else if (i == 0 && proc[i].remaining_time == 0) {
+            printf(" PREEMPT → Resume later");
+        }
+        printf("\n");
+    }
+    if (rows < n)
+        printf("... %d more processes (--export writes the full timeline)\n", n - rows);
+    arena_rewind(arena, scratch);
+    
+    printf("\nLegend: ■ = Executing, ⭐ = Emergency patient\n");
+    
+    // Key Events
+    printf("\nKey Execution Events:\n");
+    printf("---------------------\n");
+    
+    int emergency_start = -1, emergency_end = -1;
+    
+    for (int e = 0; e < log->count; e++) {
+        int pid = log->events[e].process;
+        int time = log->events[e].time;
+        int type = log->events[e].type;
+        
+        // Only print important events
+        if (proc[pid].priority == 1) { // Emergency events
+            if (type == EVENT_START) {
+                printf("%ds    %s starts → Response: %ds ", 
+                       time, proc[pid].name, proc[pid].response_time);
+                if (proc[pid].response_time == 0) {
+                    printf("✓ IMMEDIATE\n");
+                } else {
+                    printf("✓\n");
+                }
+                if (emergency_start == -1) emergency_start = time;
+            } else if (type == EVENT_COMPLETE) {
+                printf("%ds    %s completes\n", time, proc[pid].name);
+                emergency_end = time;
+            }
+        } else if (e < 3 || type == EVENT_START) { // First few events or starts
+            if (type == EVENT_START) {
+                printf("%ds    %s starts (P%d)\n", time, proc[pid].name, proc[pid].priority);
+            } else if (type == EVENT_PREEMPT && proc[pid].priority == 5) {
+                printf("%ds    %s preempted by emergency\n", time, proc[pid].name);
+            }
+        }
+    }
+    
+    if (emergency_start != -1 && emergency_end != -1) {
+        printf("%ds    All emergencies handled (%d seconds total)\n", 
+               emergency_end, emergency_end - emergency_start);
+    }
+    printf("%ds    All processes complete\n\n", total_time);
+}
+
+/* Priority Scheduling (Preemptive) */
+void priority_scheduling(Process proc[], int n, Arena *arena, int verbose, Metrics *out) {
+    if (!verbose) {
+        schedule(&POLICY_PRIORITY, proc, n, arena, NULL, out);
+        return;
+    }
+    
+    EventLog log;
+    event_log_init(&log, arena, 4 * n);
+    schedule(&POLICY_PRIORITY, proc, n, arena, &log, out);
+    print_execution_chart(proc, n, &log, out->total_time, arena);
+}
+
+/* FCFS Scheduling */
+void fcfs_scheduling(Process proc[], int n, Arena *arena, Metrics *out) {
+    schedule(&POLICY_FCFS, proc, n, arena, NULL, out);
+}
+
+/* SJF Scheduling */
+void sjf_scheduling(Process proc[], int n, Arena *arena, Metrics *out) {
+    schedule(&POLICY_SJF, proc, n, arena, NULL, out);
+}
+
+/* Round Robin Scheduling */
+void round_robin_scheduling(Process proc[], int n, Arena *arena, int quantum, Metrics *out) {
+    SchedPolicy policy = POLICY_ROUND_ROBIN;
+    policy.quantum = quantum;
+    schedule(&policy, proc, n, arena, NULL, out);
+}
+
+/* Multilevel Feedback Queue with aging; quantum is the level-0 slice */
+void mlfq_scheduling(Process proc[], int n, Arena *arena, int quantum, Metrics *out) {
+    SchedPolicy policy = POLICY_MLFQ;
+    policy.quantum = quantum;
+    schedule(&policy, proc, n, arena, NULL, out);
+}
+
+/*
+ * SMP Simulation
+ *
+ * k cores, each with its own ready queue keyed by the policy's key function
+ * (MLFQ keeps private per-level state and stays uniprocessor). An arrival
+ * goes to the least-loaded core. With priority-aware affinity an emergency
+ * goes to an idle core, or else to the core running the least urgent work,
+ * so it preempts there instead of queueing behind a peer. A preempted
+ * process returns to its own core's queue. A core that runs dry steals the
+ * most urgent process from the longest queue; running on a different core
+ * than last time counts as a migration.
+ *
+ * The per-core queues share one position map and are bounded at about
+ * twice their fair share; an entry for a full queue spills to the
+ * least-loaded core.
+ */
+typedef struct {
+    ReadyQueue ready;
+    int running;
+    int running_seq;
+    int slice_end;
+    long long busy;
+} SmpCore;
+
+static int smp_least_loaded(const SmpCore core[], int cores) {
+    int best = 0, best_load = INT_MAX;
+    for (int c = 0; c < cores; c++) {
+        int load = core[c].ready.size + (core[c].running != -1);
+        if (load < best_load && !rq_full(&core[c].ready)) {
+            best = c;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+static int smp_urgent_core(const SmpCore core[], int cores, SchedKeyFn key_fn, const SimTable *t) {
+    int best = -1;
+    ReadyEntry least_urgent = {{0, 0, 0}, -1};
+    for (int c = 0; c < cores; c++) {
+        if (rq_full(&core[c].ready)) continue;
+        if (core[c].running == -1) return c;
+        ReadyEntry e = {{0, 0, 0}, core[c].running};
+        key_fn(t, core[c].running, core[c].running_seq, e.key);
+        if (best == -1 || rq_less(&least_urgent, &e)) {
+            best = c;
+            least_urgent = e;
+        }
+    }
+    return best != -1 ? best : smp_least_loaded(core, cores);
+}
+
+static void smp_enqueue(SmpCore core[], int cores, int c, SchedKeyFn key_fn,
+                        const SimTable *t, int i, int sequence) {
+    if (rq_full(&core[c].ready)) c = smp_least_loaded(core, cores);
+    int key[3];
+    key_fn(t, i, sequence, key);
+    rq_push(&core[c].ready, i, key[0], key[1], key[2]);
+}
+
+/* Run a keyed policy on 1..SMP_MAX_CORES cores; affinity routes emergencies */
+void smp_scheduling(const SchedPolicy *policy, Process proc[], int n, Arena *arena,
+                    int cores, int affinity, Metrics *out) {
+    SimTable hot = sim_table_load(proc, n, arena);
+    int *order = sort_by_key(hot.arrival, n, arena), arrivals = 0;
+    int *last_core = sim_alloc(arena, n * sizeof(int));
+    int *position = sim_alloc(arena, n * sizeof(int));
+    for (int i = 0; i < n; i++) last_core[i] = position[i] = -1;
+    
+    SchedKeyFn key_fn = policy->key;
+    int capacity = 2 * ((n + cores - 1) / cores) + 16;
+    if (capacity > n) capacity = n;
+    
+    SmpCore core[SMP_MAX_CORES];
+    for (int c = 0; c < cores; c++) {
+        rq_init_shared(&core[c].ready, sim_alloc(arena, capacity * sizeof(ReadyEntry)),
+                       position, capacity);
+        core[c].running = -1;
+        core[c].busy = 0;
+    }
+    
+    int current_time = 0, completed = 0, context_switches = 0, sequence = 0;
+    int migrations = 0, steals = 0;
+    
+    while (completed < n) {
+        while (arrivals < n && hot.arrival[order[arrivals]] <= current_time) {
+            int i = order[arrivals++];
+            int c = affinity && hot.priority[i] == 1 ? smp_urgent_core(core, cores, key_fn, &hot)
+                                                     : smp_least_loaded(core, cores);
+            smp_enqueue(core, cores, c, key_fn, &hot, i, sequence++);
+        }
+        int next_arrival = arrivals < n ? hot.arrival[order[arrivals]] : -1;
+        int stop = next_arrival;
+        
+        for (int c = 0; c < cores; c++) {
+            SmpCore *k = &core[c];
+            if (k->running != -1 && current_time == k->slice_end) {
+                // Quantum expired: back of this core's queue
+                smp_enqueue(core, cores, c, key_fn, &hot, k->running, sequence++);
+                k->running = -1;
+            } else if (k->running != -1 && policy->preemptive && !rq_empty(&k->ready)) {
+                ReadyEntry current = {{0, 0, 0}, k->running};
+                key_fn(&hot, k->running, k->running_seq, current.key);
+                if (rq_less(&k->ready.heap[0], &current)) {
+                    smp_enqueue(core, cores, c, key_fn, &hot, k->running, sequence++);
+                    k->running = -1;
+                }
+            }
+            
+            if (k->running == -1) {
+                int victim = c;
+                if (rq_empty(&k->ready)) {
+                    for (int v = 0; v < cores; v++)
+                        if (core[v].ready.size > core[victim].ready.size) victim = v;
+                    if (victim != c) steals++;
+                }
+                int i = rq_pop(&core[victim].ready);
+                if (i == -1) continue; // nothing to run anywhere
+                
+                k->running = i;
+                k->running_seq = sequence;
+                if (hot.start[i] == -1) hot.start[i] = current_time;
+                if (last_core[i] != -1 && last_core[i] != c) migrations++;
+                last_core[i] = c;
+                context_switches++;
+                
+                int slice = hot.remaining[i];
+                if (policy->quantum > 0 && policy->quantum < slice) slice = policy->quantum;
+                k->slice_end = current_time + slice;
+            }
+            if (stop == -1 || k->slice_end < stop) stop = k->slice_end;
+        }
+        
+        // Advance every busy core to the next arrival, slice end or completion
+        int elapsed = stop - current_time;
+        current_time = stop;
+        for (int c = 0; c < cores; c++) {
+            SmpCore *k = &core[c];
+            if (k->running == -1) continue;
+            hot.remaining[k->running] -= elapsed;
+            k->busy += elapsed;
+            if (hot.remaining[k->running] == 0) {
+                hot.completion[k->running] = current_time;
+                completed++;
+                k->running = -1;
+            }
+        }
+    }
+    
+    sim_table_store(&hot, proc);
+    calculate_metrics(&hot, current_time, out);
+    out->context_switches = context_switches;
+    out->cores = cores;
+    out->migrations = migrations;
+    out->steals = steals;
+    
+    long long busy = 0;
+    for (int c = 0; c < cores; c++) {
+        busy += core[c].busy;
+        out->core_utilization[c] = current_time > 0 ? (float)core[c].busy / current_time * 100 : 0;
+    }
+    out->cpu_utilization = current_time > 0 ? (float)busy / ((long long)cores * current_time) * 100 : 0;
+}
+
+/*
+ * Online Scheduling
+ *
+ * The kernels above need the whole workload up front. An OnlineScheduler
+ * runs the same keyed policies as a live dispatcher: scheduler_submit()
+ * admits an arrival as it happens, scheduler_advance_to() moves the clock
+ * and makes every dispatch decision up to that time, and
+ * scheduler_poll_metrics() reads running totals, so a poll costs the same
+ * at any history length instead of a calculate_metrics() pass over every
+ * process seen so far. A finished process's slot is recycled: memory
+ * follows the number of live processes, not the arrivals so far.
+ *
+ * Decisions follow schedule_engine(), so submitting a workload in arrival
+ * order and draining gives the same metrics as the batch run. MLFQ keeps
+ * its own level state and is batch only.
+ */
+#define ONLINE_INITIAL_SLOTS 64
+
+typedef struct {
+    const SchedPolicy *policy;
+    Arena *arena;
+    SimTable slots;              // hot columns, one row per live process
+    ReadyQueue ready;
+    ReadyQueue pending;          // submitted ahead of its arrival time, keyed by arrival
+    int *free_slots;
+    int free_count;
+    int peak_backlog;            // most processes submitted and not yet completed at once
+    int now;
+    int sequence;
+    int running;                 // slot, -1 when idle
+    int running_seq;
+    int slice_end;
+    // Running totals over completed processes (what calculate_metrics sums)
+    int completed;
+    int context_switches;
+    long long sum_response;
+    long long sum_turnaround;
+    long long total_burst;
+    int emergency_min;
+    int emergency_max;
+    LatencyHistogram response_hist[PRIORITY_CLASSES];
+    LatencyHistogram waiting_hist[PRIORITY_CLASSES];
+} OnlineScheduler;
+
+/* Double the slot table; the old arrays stay in the arena until it is rewound */
+static void online_grow(OnlineScheduler *s) {
+    int old = s->slots.n, capacity = old > 0 ? 2 * old : ONLINE_INITIAL_SLOTS;
+    SimTable grown;
+    int *columns = sim_alloc(s->arena, 7 * (size_t)capacity * sizeof(int));
+    int **to[7] = {&grown.pid, &grown.priority, &grown.arrival, &grown.burst,
+                   &grown.remaining, &grown.start, &grown.completion};
+    int *from[7] = {s->slots.pid, s->slots.priority, s->slots.arrival, s->slots.burst,
+                    s->slots.remaining, s->slots.start, s->slots.completion};
+    grown.n = capacity;
+    for (int c = 0; c < 7; c++) {
+        *to[c] = columns + c * (size_t)capacity;
+        if (old > 0) memcpy(*to[c], from[c], (size_t)old * sizeof(int));
+    }
+    s->slots = grown;
+    
+    ReadyQueue *queues[2] = {&s->ready, &s->pending};
+    for (int q = 0; q < 2; q++) {
+        ReadyQueue copy = *queues[q];
+        rq_init(queues[q], sim_alloc(s->arena, (size_t)capacity * sizeof(ReadyEntry)),
+                sim_alloc(s->arena, (size_t)capacity * sizeof(int)), capacity);
+        if (old == 0) continue;
+        memcpy(queues[q]->heap, copy.heap, (size_t)copy.size * sizeof(ReadyEntry));
+        memcpy(queues[q]->position, copy.position, (size_t)old * sizeof(int));
+        queues[q]->size = copy.size;
+    }
+    
+    // Every slot is live when the table grows, so the free list holds just the new ones
+    s->free_slots = sim_alloc(s->arena, (size_t)capacity * sizeof(int));
+    s->free_count = 0;
+    for (int i = capacity - 1; i >= old; i--) s->free_slots[s->free_count++] = i;
+}
+
+/* Returns 0, or -1 if the policy has no ready-queue key (MLFQ) */
+int scheduler_init(OnlineScheduler *s, const SchedPolicy *policy, Arena *arena) {
+    if (policy->key == NULL) return -1;
+    memset(s, 0, sizeof(*s));
+    s->policy = policy;
+    s->arena = arena;
+    s->running = -1;
+    s->emergency_min = INT_MAX;
+    s->emergency_max = INT_MIN;
+    online_grow(s);
+    return 0;
+}
+
+static void online_enqueue(OnlineScheduler *s, int slot) {
+    engine_enqueue(&s->ready, s->policy->key, &s->slots, slot, s->sequence++);
+}
+
+/* Admit a process; -1 if it arrives before the current time or is invalid */
+int scheduler_submit(OnlineScheduler *s, const Process *p) {
+    if (p->arrival_time < s->now || p->burst_time <= 0 || p->priority < 1 ||
+        p->priority > PRIORITY_CLASSES)
+        return -1;
+    if (s->free_count == 0) online_grow(s);
+    
+    int slot = s->free_slots[--s->free_count];
+    if (s->slots.n - s->free_count > s->peak_backlog) s->peak_backlog = s->slots.n - s->free_count;
+    SimTable *t = &s->slots;
+    t->pid[slot] = p->pid;
+    t->priority[slot] = p->priority;
+    t->arrival[slot] = p->arrival_time;
+    t->burst[slot] = p->burst_time;
+    t->remaining[slot] = p->burst_time;
+    t->start[slot] = -1;
+    t->completion[slot] = 0;
+    rq_push(&s->pending, slot, p->arrival_time, s->sequence++, 0);
+    return 0;
+}
+
+static void online_admit(OnlineScheduler *s) {
+    while (!rq_empty(&s->pending) && s->pending.heap[0].key[0] <= s->now)
+        online_enqueue(s, rq_pop(&s->pending));
+}
+
+static void online_complete(OnlineScheduler *s, int slot) {
+    const SimTable *t = &s->slots;
+    int response = t->start[slot] - t->arrival[slot];
+    int turnaround = s->now - t->arrival[slot];
+    int class = t->priority[slot] - 1;
+    
+    s->completed++;
+    s->sum_response += response;
+    s->sum_turnaround += turnaround;
+    s->total_burst += t->burst[slot];
+    if (t->priority[slot] == 1) {
+        if (response < s->emergency_min) s->emergency_min = response;
+        if (response > s->emergency_max) s->emergency_max = response;
+    }
+    lh_record(&s->response_hist[class], (uint64_t)response);
+    lh_record(&s->waiting_hist[class], (uint64_t)(turnaround - t->burst[slot]));
+    s->free_slots[s->free_count++] = slot;
+}
+
+/* Dispatch up to time limit; with drain, stop as soon as no work is left instead */
+static void online_run(OnlineScheduler *s, int limit, int drain) {
+    SimTable *t = &s->slots;
+    int preemptive = s->policy->preemptive, quantum = s->policy->quantum;
+    
+    for (;;) {
+        online_admit(s);
+        if (!drain && s->now == limit) return;   // more arrivals may still come at limit
+        if (s->running != -1 && s->now == s->slice_end) {
+            // Quantum expired: arrivals during the slice (admitted above) queue ahead of it
+            online_enqueue(s, s->running);
+            s->running = -1;
+        }
+        int next_arrival = rq_empty(&s->pending) ? -1 : s->pending.heap[0].key[0];
+        
+        if (s->running == -1) {
+            s->running = rq_pop(&s->ready);
+            if (s->running == -1) {
+                if (next_arrival != -1 && next_arrival <= limit) {
+                    s->now = next_arrival;   // CPU idle: jump to next arrival
+                    continue;
+                }
+                if (!drain) s->now = limit;
+                return;
+            }
+            s->running_seq = s->sequence;
+            if (t->start[s->running] == -1) t->start[s->running] = s->now;
+            s->context_switches++;
+            
+            int slice = t->remaining[s->running];
+            if (quantum > 0 && quantum < slice) slice = quantum;
+            s->slice_end = s->now + slice;
+        } else if (preemptive && !rq_empty(&s->ready)) {
+            ReadyEntry current = {{0, 0, 0}, s->running};
+            s->policy->key(t, s->running, s->running_seq, current.key);
+            if (rq_less(&s->ready.heap[0], &current)) {
+                engine_enqueue(&s->ready, s->policy->key, t, s->running, s->sequence++);
+                s->running = -1;
+                continue;
+            }
+        }
+        
+        int stop = s->slice_end;
+        if (preemptive && next_arrival != -1 && next_arrival < stop) stop = next_arrival;
+        if (stop > limit) {
+            // Still running at the limit: the next call carries on with this dispatch
+            t->remaining[s->running] -= limit - s->now;
+            s->now = limit;
+            return;
+        }
+        t->remaining[s->running] -= stop - s->now;
+        s->now = stop;
+        
+        if (t->remaining[s->running] == 0) {
+            t->completion[s->running] = s->now;
+            online_complete(s, s->running);
+            s->running = -1;
+        }
+    }
+}
+
+/*
+ * Make every scheduling decision before time (no-op if time is not ahead).
+ * Decisions at time itself wait for the next call, after any arrivals at
+ * that time have been submitted.
+ */
+void scheduler_advance_to(OnlineScheduler *s, int time) {
+    if (time > s->now) online_run(s, time, 0);
+}
+
+/* Run until every submitted process has completed; returns the finish time */
+int scheduler_drain(OnlineScheduler *s) {
+    online_run(s, INT_MAX, 1);
+    return s->now;
+}
+
+/* pid of the running process, -1 if the CPU is idle */
+int scheduler_running(const OnlineScheduler *s) {
+    return s->running == -1 ? -1 : s->slots.pid[s->running];
+}
+
+/* Submitted processes not yet completed */
+int scheduler_backlog(const OnlineScheduler *s) {
+    return s->slots.n - s->free_count;
+}
+
+/* Largest the slot table may be: it only doubles when every slot is live */
+int scheduler_slot_bound(const OnlineScheduler *s) {
+    int bound = ONLINE_INITIAL_SLOTS;
+    while (bound < s->peak_backlog) bound *= 2;
+    return bound;
+}
+
+/* Metrics over the processes completed so far into *m, as calculate_metrics() reports them */
+void scheduler_poll_metrics(const OnlineScheduler *s, Metrics *m) {
+    memset(m, 0, sizeof(*m));
+    int completed = s->completed;
+    long long sum_waiting = s->sum_turnaround - s->total_burst;
+    
+    m->total_time = s->now;
+    m->avg_response_time = completed > 0 ? (float)s->sum_response / completed : 0;
+    m->avg_turnaround_time = completed > 0 ? (float)s->sum_turnaround / completed : 0;
+    m->avg_waiting_time = completed > 0 ? (float)sum_waiting / completed : 0;
+    m->cpu_utilization = s->now > 0 ? ((float)s->total_burst / s->now) * 100 : 0;
+    m->throughput = s->now > 0 ? (float)completed / s->now : 0;
+    m->context_switches = s->context_switches;
+    m->cores = 1;
+    m->core_utilization[0] = m->cpu_utilization;
+    if (s->emergency_max != INT_MIN) {
+        m->emergency_response_min = s->emergency_min;
+        m->emergency_response_max = s->emergency_max;
+    }
+    memcpy(m->response_hist, s->response_hist, sizeof(m->response_hist));
+    memcpy(m->waiting_hist, s->waiting_hist, sizeof(m->waiting_hist));
+}
+
+/* Print Process Workload */
+void print_workload(Process proc[], int n) {
+    printf("\nProcess Workload:\n");
+    printf("-----------------\n");
     printf("PID  %-22s Priority  Arrival(s)  Burst(s)  Medical Classification\n", "Process Name");
     printf("---  ---------------------- --------  ----------  --------  ---------------------\n");
-    for (int i = 0; i < n; i++) {
+    int shown = n > WORKLOAD_PRINT_LIMIT ? WORKLOAD_PRINT_LIMIT : n;
+    for (int i = 0; i < shown; i++) {
         printf("%-3d  %-22s %-8d  %-10d  %-8d  %s\n", 
                proc[i].pid, proc[i].name, proc[i].priority, 
                proc[i].arrival_time, proc[i].burst_time, proc[i].medical_class);
     }
+    if (shown < n) printf("...  (%d more)\n", n - shown);
     printf("\nTotal Processes: %d", n);
     
     int emergency_count = 0;
@@ -477,38 +1859,80 @@ void print_workload(Process proc[], int n) {
     }
 }
 
+/* "p50 / p95 / p99 / p99.9" */
+void format_percentiles(char *cell, size_t size, const LatencyHistogram *h) {
+    snprintf(cell, size, "%llu / %llu / %llu / %llu",
+             (unsigned long long)lh_percentile(h, 50), (unsigned long long)lh_percentile(h, 95),
+             (unsigned long long)lh_percentile(h, 99), (unsigned long long)lh_percentile(h, 99.9));
+}
+
+/* p50/p95/p99/p99.9 response and waiting time for each priority class present */
+void print_latency_percentiles(const LatencyHistogram response[], const LatencyHistogram waiting[]) {
+    printf("\nLatency Percentiles (seconds):\n");
+    printf("%-16s %-8s %-27s %s\n", "Class", "Count", "Response p50/p95/p99/p99.9",
+           "Waiting p50/p95/p99/p99.9");
+    printf("---------------- -------- --------------------------- ---------------------------\n");
+    for (int c = 0; c < PRIORITY_CLASSES; c++) {
+        if (response[c].total == 0) continue;
+        char label[32];
+        snprintf(label, sizeof(label), "P%d %s", c + 1, priority_class_names[c]);
+        printf("%-16s %-8llu", label, (unsigned long long)response[c].total);
+        const LatencyHistogram *h[2] = {&response[c], &waiting[c]};
+        for (int k = 0; k < 2; k++) {
+            char cell[64];
+            format_percentiles(cell, sizeof(cell), h[k]);
+            printf(k == 0 ? " %-27s" : " %s", cell);
+        }
+        printf("\n");
+    }
+}
+
 /* Print Performance Metrics */
-void print_metrics(Metrics m, char *algorithm) {
+void print_metrics(const Metrics *m, const char *algorithm) {
     printf("\nPerformance Metrics:\n");
     printf("--------------------\n");
     printf("%-30s %-12s Assessment\n", "Metric", "Value");
     printf("%-30s %-12s ---------------------------\n", "------------------------------", "---------");
     
-    printf("%-30s %-12.2fs ", "Average Response Time", m.avg_response_time);
-    if (m.avg_response_time < 5) printf("Excellent\n");
-    else if (m.avg_response_time < 15) printf("Good\n");
+    printf("%-30s %-12.2fs ", "Average Response Time", m->avg_response_time);
+    if (m->avg_response_time < 5) printf("Excellent\n");
+    else if (m->avg_response_time < 15) printf("Good\n");
     else printf("Poor\n");
     
-    printf("%-30s %-12.2fs\n", "Average Turnaround Time", m.avg_turnaround_time);
-    printf("%-30s %-12.2fs\n", "Average Waiting Time", m.avg_waiting_time);
+    printf("%-30s %-12.2fs\n", "Average Turnaround Time", m->avg_turnaround_time);
+    printf("%-30s %-12.2fs\n", "Average Waiting Time", m->avg_waiting_time);
     
-    if (m.emergency_response_min != 0 || m.emergency_response_max != 0) {
+    if (m->emergency_response_min != 0 || m->emergency_response_max != 0) {
         printf("%-30s ", "EMERGENCY Response Time");
-        if (m.emergency_response_min == m.emergency_response_max) {
-            printf("%-12.0fs ", m.emergency_response_min);
+        if (m->emergency_response_min == m->emergency_response_max) {
+            printf("%-12.0fs ", m->emergency_response_min);
         } else {
-            printf("%.0f-%.0fs     ", m.emergency_response_min, m.emergency_response_max);
+            printf("%.0f-%.0fs     ", m->emergency_response_min, m->emergency_response_max);
         }
         
-        if (m.emergency_response_max <= 5) printf("✓ EXCELLENT\n");
-        else if (m.emergency_response_max <= 10) printf("⚠ Acceptable\n");
+        if (m->emergency_response_max <= 5) printf("✓ EXCELLENT\n");
+        else if (m->emergency_response_max <= 10) printf("⚠ Acceptable\n");
         else printf("✗ CRITICAL DELAY\n");
     }
     
-    printf("%-30s %-12.2f%%\n", "CPU Utilization", m.cpu_utilization);
-    printf("%-30s %-12d\n", "Context Switches", m.context_switches);
-    printf("%-30s %-12.3f processes/second\n", "Throughput", m.throughput);
-    printf("%-30s %-12ds\n", "Total Execution Time", m.total_time);
+    printf("%-30s %-12.2f%%\n", "CPU Utilization", m->cpu_utilization);
+    printf("%-30s %-12d\n", "Context Switches", m->context_switches);
+    printf("%-30s %-12.3f processes/second\n", "Throughput", m->throughput);
+    printf("%-30s %-12ds\n", "Total Execution Time", m->total_time);
+    
+    print_latency_percentiles(m->response_hist, m->waiting_hist);
+    
+    if (m->cores > 1) {
+        printf("%-30s %-12d\n", "Cores", m->cores);
+        printf("%-30s %-12d\n", "Migrations", m->migrations);
+        printf("%-30s %-12d\n", "Work Steals", m->steals);
+        printf("%-30s", "Per-Core Utilization");
+        for (int c = 0; c < m->cores; c++) {
+            if (c > 0 && c % 8 == 0) printf("\n%-30s", "");
+            printf(" %5.1f%%", m->core_utilization[c]);
+        }
+        printf("\n");
+    }
 }
 
 /* Print Individual Process Performance */
@@ -539,18 +1963,23 @@ void print_process_performance(Process proc[], int n) {
     }
 }
 
+/* Longest response time among processes of one priority class, -1 if none */
+int worst_response(Process proc[], int n, int priority) {
+    int worst = -1;
+    for (int i = 0; i < n; i++)
+        if (proc[i].priority == priority && proc[i].response_time > worst)
+            worst = proc[i].response_time;
+    return worst;
+}
+
 /* Run scenario */
-void run_scenario(char *scenario_name, void (*init_func)(Process[], int*), int show_details) {
-    Process processes[MAX_PROCESSES];
-    int n;
-    
+/* Workload lives at the bottom of the arena; algorithm runs rewind above it */
+void run_scenario(char *scenario_name, Process processes[], int n, Arena *arena, int show_details) {
     printf("\n\n");
     printf("================================================================================\n");
     printf("                        %s\n", scenario_name);
     printf("================================================================================\n");
     
-    init_func(processes, &n);
-    
     if (show_details) {
         printf("\nScenario Description:\n");
         printf("---------------------\n");
@@ -577,25 +2006,25 @@ void run_scenario(char *scenario_name, void (*init_func)(Process[], int*), int s
     
     print_workload(processes, n);
     
-    // Run all algorithms
-    Process p1[MAX_PROCESSES], p2[MAX_PROCESSES], p3[MAX_PROCESSES], p4[MAX_PROCESSES];
-    for (int i = 0; i < n; i++) {
-        p1[i] = p2[i] = p3[i] = p4[i] = processes[i];
-    }
+    // Run all algorithms, each on a fresh copy; the arena is rewound between runs
+    ArenaMark run_start = arena_mark(arena);
+    Process *run = copy_workload(arena, processes, n);
     
     printf("\n\n");
     printf("================================================================================\n");
     printf("                    ALGORITHM 1: PRIORITY SCHEDULING (Preemptive)\n");
     printf("================================================================================\n");
-    Metrics m_priority = priority_scheduling(p1, n, show_details);
-    print_metrics(m_priority, "Priority");
+    Metrics m_priority;
+    priority_scheduling(run, n, arena, show_details, &m_priority);
+    int priority_tail = worst_response(run, n, 5);
+    print_metrics(&m_priority, "Priority");
     if (show_details) {
-        print_process_performance(p1, n);
+        print_process_performance(run, n);
         
         // Print emergency analysis
         int has_emergency = 0;
         for (int i = 0; i < n; i++) {
-            if (p1[i].priority == 1) {
+            if (run[i].priority == 1) {
                 has_emergency = 1;
                 break;
             }
@@ -606,12 +2035,12 @@ void run_scenario(char *scenario_name, void (*init_func)(Process[], int*), int s
             printf("---------------------------\n");
             int first_emergency_rt = -1;
             for (int i = 0; i < n; i++) {
-                if (p1[i].priority == 1) {
+                if (run[i].priority == 1) {
                     if (first_emergency_rt == -1) {
-                        printf("✓ First emergency: %d-second response ", p1[i].response_time);
-                        if (p1[i].response_time == 0) printf("(immediate preemption)\n");
+                        printf("✓ First emergency: %d-second response ", run[i].response_time);
+                        if (run[i].response_time == 0) printf("(immediate preemption)\n");
                         else printf("\n");
-                        first_emergency_rt = p1[i].response_time;
+                        first_emergency_rt = run[i].response_time;
                     }
                 }
             }
@@ -638,8 +2067,10 @@ void run_scenario(char *scenario_name, void (*init_func)(Process[], int*), int s
     printf("================================================================================\n");
     printf("                    ALGORITHM 2: FCFS (First Come First Served)\n");
     printf("================================================================================\n");
-    Metrics m_fcfs = fcfs_scheduling(p2, n);
-    print_metrics(m_fcfs, "FCFS");
+    arena_rewind(arena, run_start);
+    Metrics m_fcfs;
+    fcfs_scheduling(copy_workload(arena, processes, n), n, arena, &m_fcfs);
+    print_metrics(&m_fcfs, "FCFS");
     
     if (show_details && m_fcfs.emergency_response_max > 10) {
         printf("\n\nCRITICAL IMPACT:\n");
@@ -659,8 +2090,10 @@ void run_scenario(char *scenario_name, void (*init_func)(Process[], int*), int s
     printf("================================================================================\n");
     printf("                    ALGORITHM 3: SJF (Shortest Job First)\n");
     printf("================================================================================\n");
-    Metrics m_sjf = sjf_scheduling(p3, n);
-    print_metrics(m_sjf, "SJF");
+    arena_rewind(arena, run_start);
+    Metrics m_sjf;
+    sjf_scheduling(copy_workload(arena, processes, n), n, arena, &m_sjf);
+    print_metrics(&m_sjf, "SJF");
     
     if (show_details && m_sjf.emergency_response_max > 5) {
         printf("\n\nPROBLEM ANALYSIS:\n");
@@ -679,8 +2112,10 @@ void run_scenario(char *scenario_name, void (*init_func)(Process[], int*), int s
     printf("================================================================================\n");
     printf("                    ALGORITHM 4: ROUND ROBIN (Quantum = %ds)\n", TIME_QUANTUM);
     printf("================================================================================\n");
-    Metrics m_rr = round_robin_scheduling(p4, n);
-    print_metrics(m_rr, "Round Robin");
+    arena_rewind(arena, run_start);
+    Metrics m_rr;
+    round_robin_scheduling(copy_workload(arena, processes, n), n, arena, TIME_QUANTUM, &m_rr);
+    print_metrics(&m_rr, "Round Robin");
     
     if (show_details) {
         printf("\n\nOVERHEAD ANALYSIS:\n");
@@ -696,23 +2131,45 @@ void run_scenario(char *scenario_name, void (*init_func)(Process[], int*), int s
         printf("        Excessive context switching overhead\n");
     }
     
+    // MLFQ
+    printf("\n\n");
+    printf("================================================================================\n");
+    printf("                    ALGORITHM 5: MLFQ WITH AGING (Base Quantum = %ds)\n", TIME_QUANTUM);
+    printf("================================================================================\n");
+    arena_rewind(arena, run_start);
+    run = copy_workload(arena, processes, n);
+    Metrics m_mlfq;
+    mlfq_scheduling(run, n, arena, TIME_QUANTUM, &m_mlfq);
+    print_metrics(&m_mlfq, "MLFQ");
+    
+    int mlfq_tail = worst_response(run, n, 5);
+    if (show_details && mlfq_tail >= 0) {
+        printf("\n\nSTARVATION ANALYSIS:\n");
+        printf("- Levels follow triage priority; emergencies enter at the top level\n");
+        printf("- Waiting work is promoted one level every %ds (aging)\n", MLFQ_AGING_INTERVAL);
+        printf("- Worst priority-5 response: %ds (vs %ds with Priority)\n",
+               mlfq_tail, priority_tail);
+        printf("- Bounded wait: any process reaches the top level within %ds of waiting\n",
+               (MLFQ_LEVELS - 1) * MLFQ_AGING_INTERVAL);
+    }
+    
     // Comparison table
     printf("\n\n");
     printf("================================================================================\n");
     printf("                        ALGORITHM COMPARISON SUMMARY\n");
     printf("================================================================================\n\n");
     
-    printf("Metric                    Priority    FCFS        SJF         Round Robin\n");
-    printf("------------------------  ----------  ----------  ----------  -----------\n");
-    printf("Avg Response Time         %-10.2fs  %-10.2fs  %-10.2fs  %-10.2fs\n",
+    printf("Metric                    Priority    FCFS        SJF         Round Robin  MLFQ\n");
+    printf("------------------------  ----------  ----------  ----------  -----------  ----------\n");
+    printf("Avg Response Time         %-10.2fs  %-10.2fs  %-10.2fs  %-10.2fs   %-10.2fs\n",
            m_priority.avg_response_time, m_fcfs.avg_response_time,
-           m_sjf.avg_response_time, m_rr.avg_response_time);
-    printf("Avg Turnaround Time       %-10.2fs  %-10.2fs  %-10.2fs  %-10.2fs\n",
+           m_sjf.avg_response_time, m_rr.avg_response_time, m_mlfq.avg_response_time);
+    printf("Avg Turnaround Time       %-10.2fs  %-10.2fs  %-10.2fs  %-10.2fs   %-10.2fs\n",
            m_priority.avg_turnaround_time, m_fcfs.avg_turnaround_time,
-           m_sjf.avg_turnaround_time, m_rr.avg_turnaround_time);
-    printf("Avg Waiting Time          %-10.2fs  %-10.2fs  %-10.2fs  %-10.2fs\n",
+           m_sjf.avg_turnaround_time, m_rr.avg_turnaround_time, m_mlfq.avg_turnaround_time);
+    printf("Avg Waiting Time          %-10.2fs  %-10.2fs  %-10.2fs  %-10.2fs   %-10.2fs\n",
            m_priority.avg_waiting_time, m_fcfs.avg_waiting_time,
-           m_sjf.avg_waiting_time, m_rr.avg_waiting_time);
+           m_sjf.avg_waiting_time, m_rr.avg_waiting_time, m_mlfq.avg_waiting_time);
     
     if (m_priority.emergency_response_max > 0) {
         printf("Emergency Response        ");
@@ -732,17 +2189,22 @@ void run_scenario(char *scenario_name, void (*init_func)(Process[], int*), int s
             printf("%.0f-%.0fs    ", m_sjf.emergency_response_min, m_sjf.emergency_response_max);
         
         if (m_rr.emergency_response_min == m_rr.emergency_response_max)
-            printf("%-10.0fs\n", m_rr.emergency_response_min);
+            printf("%-10.0fs   ", m_rr.emergency_response_min);
+        else
+            printf("%.0f-%.0fs     ", m_rr.emergency_response_min, m_rr.emergency_response_max);
+        
+        if (m_mlfq.emergency_response_min == m_mlfq.emergency_response_max)
+            printf("%-10.0fs\n", m_mlfq.emergency_response_min);
         else
-            printf("%.0f-%.0fs\n", m_rr.emergency_response_min, m_rr.emergency_response_max);
+            printf("%.0f-%.0fs\n", m_mlfq.emergency_response_min, m_mlfq.emergency_response_max);
     }
     
-    printf("Context Switches          %-10d  %-10d  %-10d  %-10d\n",
+    printf("Context Switches          %-10d  %-10d  %-10d  %-10d   %-10d\n",
            m_priority.context_switches, m_fcfs.context_switches,
-           m_sjf.context_switches, m_rr.context_switches);
-    printf("CPU Utilization           %-10.2f%%  %-10.2f%%  %-10.2f%%  %-10.2f%%\n",
+           m_sjf.context_switches, m_rr.context_switches, m_mlfq.context_switches);
+    printf("CPU Utilization           %-10.2f%%  %-10.2f%%  %-10.2f%%  %-10.2f%%  %-10.2f%%\n",
            m_priority.cpu_utilization, m_fcfs.cpu_utilization,
-           m_sjf.cpu_utilization, m_rr.cpu_utilization);
+           m_sjf.cpu_utilization, m_rr.cpu_utilization, m_mlfq.cpu_utilization);
     
     printf("\n");
     printf("WINNER: Priority Scheduling\n");
@@ -753,56 +2215,1501 @@ void run_scenario(char *scenario_name, void (*init_func)(Process[], int*), int s
     printf("- Maintains performance under all load conditions\n");
 }
 
-int main() {
-    printf("================================================================================\n");
-    printf("           HPMS PROCESS SCHEDULING ANALYSIS\n");
-    printf("           Hospital Patient Management System - Emergency Scenarios\n");
-    printf("================================================================================\n\n");
-    
-    printf("Test Scenarios:\n");
-    printf("1. EMERGENCY SCENARIO (Primary Focus) - Mass casualty with multiple critical patients\n");
-    printf("2. Normal Case - Standard evening rush (150 patients/hour)\n");
-    printf("3. Best Case - Light load validation (50 patients/hour)\n\n");
-    
-    printf("Testing 4 Algorithms: Priority (Preemptive), FCFS, SJF, Round Robin\n");
-    printf("================================================================================\n");
-    
-    // Emergency scenario with full details
-    run_scenario("EMERGENCY SCENARIO (MASS CASUALTY)\n           6 Critical Patients + Mixed Priority Operations", 
-                 init_emergency_scenario, 1);
-    
-    // Normal case with moderate details
-    printf("\n\n");
-    printf("================================================================================\n");
-    printf("                        NORMAL CASE VALIDATION\n");
-    printf("           Standard Evening Rush (150 patients/hour)\n");
-    printf("================================================================================\n");
-    
-    Process processes_normal[MAX_PROCESSES];
-    int n_normal;
-    init_normal_scenario(processes_normal, &n_normal);
-    print_workload(processes_normal, n_normal);
-    
-    Process p1[MAX_PROCESSES], p2[MAX_PROCESSES], p3[MAX_PROCESSES], p4[MAX_PROCESSES];
-    for (int i = 0; i < n_normal; i++) {
-        p1[i] = p2[i] = p3[i] = p4[i] = processes_normal[i];
+/*
+ * Parameter Sweep
+ * Every (scenario, algorithm, quantum) configuration is one job. A pthread
+ * worker pool claims jobs from an atomic counter; each worker owns its
+ * arena and makes its own copy of the (shared, read-only) workload, so the
+ * runs share nothing but the result table, where every job owns one slot.
+ * Policies with a quantum run once per quantum in the range, the others
+ * once per scenario.
+ */
+const SchedPolicy *sweep_policies[] = {
+    &POLICY_PRIORITY, &POLICY_FCFS, &POLICY_SJF, &POLICY_SRTF,
+    &POLICY_ROUND_ROBIN, &POLICY_PRIORITY_RR, &POLICY_MLFQ,
+};
+#define SWEEP_POLICY_COUNT ((int)(sizeof(sweep_policies) / sizeof(sweep_policies[0])))
+#define SWEEP_MAX_QUANTUM 1000   // bounds the job count (and its result table)
+#define SWEEP_MAX_THREADS 1024
+
+typedef struct {
+    const char *name;
+    Process *processes;
+    int n;
+} SweepScenario;
+
+typedef struct {
+    int scenario;
+    const SchedPolicy *policy;
+    int quantum;         // 0 when the policy has no quantum
+    Metrics metrics;
+} SweepJob;
+
+typedef struct {
+    SweepScenario *scenarios;
+    SweepJob *jobs;
+    int job_count;
+    atomic_int next_job;
+    size_t arena_bytes;
+} SweepContext;
+
+void *sweep_worker(void *arg) {
+    SweepContext *ctx = arg;
+    Arena arena;
+    if (arena_init(&arena, ctx->arena_bytes) != 0) {
+        perror("arena_init failed");
+        exit(1);
     }
     
-    Metrics m1 = priority_scheduling(p1, n_normal, 0);
-    Metrics m2 = fcfs_scheduling(p2, n_normal);
-    Metrics m3 = sjf_scheduling(p3, n_normal);
-    Metrics m4 = round_robin_scheduling(p4, n_normal);
-    
-    printf("\n\nAlgorithm Comparison (Normal Case):\n");
-    printf("Metric                    Priority    FCFS        SJF         Round Robin\n");
-    printf("------------------------  ----------  ----------  ----------  -----------\n");
-    printf("Avg Response Time         %-10.2fs  %-10.2fs  %-10.2fs  %-10.2fs\n",
-           m1.avg_response_time, m2.avg_response_time, m3.avg_response_time, m4.avg_response_time);
-    printf("Emergency Response        %-10.0fs  %-10.0fs  %-10.0fs  %-10.0fs\n",
-           m1.emergency_response_max, m2.emergency_response_max, 
-           m3.emergency_response_max, m4.emergency_response_max);
-    printf("Context Switches          %-10d  %-10d  %-10d  %-10d\n",
-           m1.context_switches, m2.context_switches, m3.context_switches, m4.context_switches);
+    int j;
+    while ((j = atomic_fetch_add(&ctx->next_job, 1)) < ctx->job_count) {
+        SweepJob *job = &ctx->jobs[j];
+        SweepScenario *sc = &ctx->scenarios[job->scenario];
+        arena_reset(&arena);
+        Process *run = copy_workload(&arena, sc->processes, sc->n);
+        SchedPolicy policy = *job->policy;
+        policy.quantum = job->quantum;
+        schedule(&policy, run, sc->n, &arena, NULL, &job->metrics);
+    }
+    
+    arena_free(&arena);
+    return NULL;
+}
+
+int parse_range(const char *text, int *lo, int *hi) {
+    char *end;
+    long low = strtol(text, &end, 10), high = low;
+    if (end == text) return -1;
+    if (*end == '-') {
+        const char *second = end + 1;
+        high = strtol(second, &end, 10);
+        if (end == second) return -1;
+    }
+    if (*end != '\0' || low < 1 || high < low || high > SWEEP_MAX_QUANTUM) return -1;
+    *lo = (int)low;
+    *hi = (int)high;
+    return 0;
+}
+
+int run_sweep(int argc, char *argv[]) {
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN), q_lo = 1, q_hi = 16;
+    if (threads < 1) threads = 1;
+    
+    // Scenario workloads live in one arena shared read-only by all workers
+    Arena workloads;
+    if (arena_init(&workloads, SIM_ARENA_DEFAULT) != 0) {
+        perror("arena_init failed");
+        return 1;
+    }
+    SweepScenario *scenarios = sim_alloc(&workloads, (3 + argc) * sizeof(SweepScenario));
+    int scenario_count = 0, largest = 0;
+    scenarios[scenario_count].name = "Emergency";
+    scenarios[scenario_count].processes = init_emergency_scenario(&workloads, &scenarios[scenario_count].n);
+    scenario_count++;
+    scenarios[scenario_count].name = "Normal";
+    scenarios[scenario_count].processes = init_normal_scenario(&workloads, &scenarios[scenario_count].n);
+    scenario_count++;
+    scenarios[scenario_count].name = "Best";
+    scenarios[scenario_count].processes = init_best_scenario(&workloads, &scenarios[scenario_count].n);
+    scenario_count++;
+    
+    Arena *trace_arenas = calloc(argc, sizeof(Arena));
+    int trace_count = 0, status = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            char *end;
+            long value = strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '\0' || value < 1 || value > SWEEP_MAX_THREADS) {
+                fprintf(stderr, "Bad thread count '%s' (want 1-%d)\n", argv[i], SWEEP_MAX_THREADS);
+                status = 1;
+                break;
+            }
+            threads = (int)value;
+        } else if (strcmp(argv[i], "--quanta") == 0 && i + 1 < argc) {
+            if (parse_range(argv[++i], &q_lo, &q_hi) != 0) {
+                fprintf(stderr, "Bad quantum range '%s' (want N or LO-HI, 1-%d)\n", argv[i],
+                        SWEEP_MAX_QUANTUM);
+                status = 1;
+            }
+        } else {
+            SweepScenario *sc = &scenarios[scenario_count];
+            sc->processes = open_trace_workload(argv[i], &trace_arenas[trace_count], &sc->n);
+            if (sc->processes == NULL) {
+                status = 1;
+                break;
+            }
+            sc->name = argv[i];
+            trace_count++;
+            scenario_count++;
+        }
+    }
+    if (threads > SWEEP_MAX_THREADS) threads = SWEEP_MAX_THREADS;
+    
+    if (status == 0) {
+        for (int s = 0; s < scenario_count; s++)
+            if (scenarios[s].n > largest) largest = scenarios[s].n;
+        
+        int per_scenario = 0;
+        for (int p = 0; p < SWEEP_POLICY_COUNT; p++)
+            per_scenario += sweep_policies[p]->quantum > 0 ? q_hi - q_lo + 1 : 1;
+        SweepContext ctx;
+        ctx.scenarios = scenarios;
+        ctx.job_count = scenario_count * per_scenario;
+        ctx.jobs = malloc((size_t)ctx.job_count * sizeof(SweepJob));
+        if (ctx.jobs == NULL) {
+            perror("malloc failed");
+            exit(1);
+        }
+        ctx.arena_bytes = sim_arena_bytes(largest);
+        atomic_init(&ctx.next_job, 0);
+        
+        int j = 0;
+        for (int s = 0; s < scenario_count; s++) {
+            for (int p = 0; p < SWEEP_POLICY_COUNT; p++) {
+                const SchedPolicy *policy = sweep_policies[p];
+                if (policy->quantum == 0) {
+                    ctx.jobs[j++] = (SweepJob){.scenario = s, .policy = policy};
+                    continue;
+                }
+                for (int q = q_lo; q <= q_hi; q++)
+                    ctx.jobs[j++] = (SweepJob){.scenario = s, .policy = policy, .quantum = q};
+            }
+        }
+        
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        pthread_t *workers = malloc(threads * sizeof(pthread_t));
+        for (int t = 0; t < threads; t++) {
+            if (pthread_create(&workers[t], NULL, sweep_worker, &ctx) != 0) {
+                perror("pthread_create failed");
+                exit(1);
+            }
+        }
+        for (int t = 0; t < threads; t++) pthread_join(workers[t], NULL);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double seconds = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        
+        printf("================================================================================\n");
+        printf("           HPMS SCHEDULING PARAMETER SWEEP\n");
+        printf("================================================================================\n");
+        printf("%d scenarios x %d configurations = %d runs on %d threads (%.3fs)\n\n",
+               scenario_count, per_scenario, ctx.job_count, threads, seconds);
+        
+        printf("%-24s %-12s %-7s %-10s %-10s %-10s %-10s %-8s %-8s\n", "Scenario", "Algorithm",
+               "Quantum", "AvgResp", "AvgTAT", "AvgWait", "EmergMax", "Switches", "CPU%");
+        printf("------------------------ ------------ ------- ---------- ---------- ---------- ---------- -------- --------\n");
+        for (j = 0; j < ctx.job_count; j++) {
+            SweepJob *job = &ctx.jobs[j];
+            Metrics *m = &job->metrics;
+            char quantum[16] = "-";
+            if (job->quantum > 0) snprintf(quantum, sizeof(quantum), "%d", job->quantum);
+            printf("%-24.24s %-12s %-7s %-10.2f %-10.2f %-10.2f %-10.0f %-8d %-8.2f\n",
+                   scenarios[job->scenario].name, job->policy->name, quantum,
+                   m->avg_response_time, m->avg_turnaround_time, m->avg_waiting_time,
+                   m->emergency_response_max, m->context_switches, m->cpu_utilization);
+        }
+        
+        // Best Round Robin quantum per scenario by average response time
+        printf("\nBest Round Robin quantum (lowest average response):\n");
+        for (int s = 0; s < scenario_count; s++) {
+            SweepJob *best = NULL;
+            for (j = 0; j < ctx.job_count; j++) {
+                SweepJob *job = &ctx.jobs[j];
+                if (job->scenario != s || job->policy != &POLICY_ROUND_ROBIN) continue;
+                if (best == NULL || job->metrics.avg_response_time < best->metrics.avg_response_time)
+                    best = job;
+            }
+            printf("  %-24.24s quantum %-3d avg response %.2fs, emergency max %.0fs\n",
+                   scenarios[s].name, best->quantum, best->metrics.avg_response_time,
+                   best->metrics.emergency_response_max);
+        }
+        
+        // Histograms merge by addition: one fleet-wide view per configuration
+        printf("\nMerged across all %d scenarios, response percentiles (seconds):\n", scenario_count);
+        printf("%-12s %-7s %-27s %s\n", "Algorithm", "Quantum", "Emergency p50/p95/p99/p99.9",
+               "All classes p50/p95/p99/p99.9");
+        printf("------------ ------- --------------------------- ---------------------------\n");
+        for (int c = 0; c < per_scenario; c++) {
+            LatencyHistogram emergency, all;
+            lh_init(&emergency);
+            lh_init(&all);
+            for (int s = 0; s < scenario_count; s++) {
+                const Metrics *m = &ctx.jobs[s * per_scenario + c].metrics;
+                lh_merge(&emergency, &m->response_hist[0]);
+                for (int k = 0; k < PRIORITY_CLASSES; k++) lh_merge(&all, &m->response_hist[k]);
+            }
+            
+            SweepJob *job = &ctx.jobs[c];
+            char quantum[16] = "-";
+            if (job->quantum > 0) snprintf(quantum, sizeof(quantum), "%d", job->quantum);
+            printf("%-12s %-7s", job->policy->name, quantum);
+            const LatencyHistogram *h[2] = {&emergency, &all};
+            for (int k = 0; k < 2; k++) {
+                char cell[64];
+                format_percentiles(cell, sizeof(cell), h[k]);
+                printf(k == 0 ? " %-27s" : " %s", cell);
+            }
+            printf("\n");
+        }
+        
+        free(workers);
+        free(ctx.jobs);
+    }
+    
+    for (int i = 0; i < trace_count; i++) arena_free(&trace_arenas[i]);
+    free(trace_arenas);
+    arena_free(&workloads);
+    return status;
+}
+
+void print_usage(const char *prog) {
+    printf("Usage: %s                        Run the built-in scenarios\n", prog);
+    printf("       %s --trace FILE [--details]  Run a CSV or binary trace\n", prog);
+    printf("       %s --trace FILE --export OUT[.json|.csv|.hpmsr] [--policy NAME]\n", prog);
+    printf("                                    Stream one policy's events (Chrome trace, CSV or\n");
+    printf("                                    columnar results with per-process columns)\n");
+    printf("       %s --diff BASE.hpmsr NEW.hpmsr  Compare two runs, flag emergency regressions\n", prog);
+    printf("       %s --convert IN.csv OUT      Convert a CSV trace to binary\n", prog);
+    printf("       %s --sweep [--threads N] [--quanta LO-HI] [TRACE...]\n", prog);
+    printf("                                    Parallel scenario x algorithm x quantum sweep\n");
+    printf("       %s --smp K [--affinity] [TRACE]\n", prog);
+    printf("                                    Simulate K cores with per-core queues\n");
+    printf("       %s --bench [--max N] [--dist poisson|burst|both] [--seed S]\n", prog);
+    printf("                  [--out FILE] [--baseline FILE]\n");
+    printf("                                    Time every engine, check scaling and regressions\n");
+    printf("       %s --online [--policy NAME] [TRACE]\n", prog);
+    printf("                                    Dispatch arrivals as they happen, poll metrics\n");
+    printf("       %s --live [--unit-ms U] [--cpu C] [TRACE]\n", prog);
+    printf("                                    Replay on real threads under the kernel scheduler\n");
+}
+
+/* Policy by case-insensitive name, NULL if unknown */
+const SchedPolicy *find_policy(const char *name) {
+    for (int p = 0; p < SWEEP_POLICY_COUNT; p++)
+        if (strcasecmp(sweep_policies[p]->name, name) == 0) return sweep_policies[p];
+    return NULL;
+}
+
+/* Re-run one policy, streaming its events to path as they happen */
+int export_schedule(const char *path, const SchedPolicy *policy, Process processes[], int n,
+                    Arena *arena) {
+    ArenaMark mark = arena_mark(arena);
+    Process *run = copy_workload(arena, processes, n);
+    EventLog log = {0};
+    if (event_log_open_export(&log, path, run, n, policy->name) != 0) return 1;
+    
+    Metrics m;
+    schedule(policy, run, n, arena, &log, &m);
+    long events = log.exported;
+    int status = event_log_close_export(&log);
+    arena_rewind(arena, mark);
+    
+    if (status != 0) {
+        fprintf(stderr, "Error writing %s\n", path);
+        return 1;
+    }
+    printf("Exported %ld %s events to %s\n", events, policy->name, path);
+    return 0;
+}
+
+int run_trace(int argc, char *argv[]) {
+    const char *path = argv[0], *export_path = NULL;
+    const SchedPolicy *export_policy = &POLICY_PRIORITY;
+    int show_details = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--details") == 0) {
+            show_details = 1;
+        } else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            export_path = argv[++i];
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            export_policy = find_policy(argv[++i]);
+            if (export_policy == NULL) {
+                fprintf(stderr, "Unknown policy '%s'\n", argv[i]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Unknown trace option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    
+    Arena arena;
+    int n;
+    Process *processes = open_trace_workload(path, &arena, &n);
+    if (processes == NULL) return 1;
+    
+    int status = 0;
+    if (export_path != NULL) {
+        status = export_schedule(export_path, export_policy, processes, n, &arena);
+    } else {
+        char title[256];
+        snprintf(title, sizeof(title), "TRACE WORKLOAD: %s (%d processes)", path, n);
+        run_scenario(title, processes, n, &arena, show_details);
+    }
+    
+    arena_free(&arena);
+    return status;
+}
+
+/* SMP report: every keyed policy on K cores, then Priority core scaling */
+int run_smp(int argc, char *argv[]) {
+    int cores = 4, affinity = 0, have_cores = 0;
+    const char *path = NULL;
+    for (int i = 0; i < argc; i++) {
+        char *end;
+        long value = strtol(argv[i], &end, 10);
+        if (strcmp(argv[i], "--affinity") == 0) {
+            affinity = 1;
+        } else if (!have_cores && path == NULL && end != argv[i] && *end == '\0') {
+            // Only a bare number that comes before the trace is K: "2024.trace" is a file
+            cores = value < 1 || value > SMP_MAX_CORES ? 0 : (int)value;
+            have_cores = 1;
+        } else if (path == NULL) {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Unexpected argument '%s' (usage: --smp K [--affinity] [TRACE])\n", argv[i]);
+            return 1;
+        }
+    }
+    if (cores < 1 || cores > SMP_MAX_CORES) {
+        fprintf(stderr, "Core count must be 1-%d\n", SMP_MAX_CORES);
+        return 1;
+    }
+    
+    Arena arena;
+    int n;
+    Process *processes;
+    if (path != NULL) {
+        processes = open_trace_workload(path, &arena, &n);
+        if (processes == NULL) return 1;
+    } else {
+        if (arena_init(&arena, SIM_ARENA_DEFAULT) != 0) {
+            perror("arena_init failed");
+            return 1;
+        }
+        path = "Emergency scenario";
+        processes = init_emergency_scenario(&arena, &n);
+    }
+    
+    printf("================================================================================\n");
+    printf("           HPMS SMP SIMULATION: %d cores, affinity %s\n", cores, affinity ? "on" : "off");
+    printf("           Workload: %s (%d processes)\n", path, n);
+    printf("================================================================================\n");
+    
+    ArenaMark run_start = arena_mark(&arena);
+    for (int p = 0; p < SWEEP_POLICY_COUNT; p++) {
+        const SchedPolicy *policy = sweep_policies[p];
+        if (policy->key == NULL) continue;
+        
+        printf("\n\n%s", policy->name);
+        if (policy->quantum > 0) printf(" (Quantum = %ds)", policy->quantum);
+        printf(" on %d cores\n", cores);
+        arena_rewind(&arena, run_start);
+        Metrics m;
+        smp_scheduling(policy, copy_workload(&arena, processes, n), n, &arena,
+                       cores, affinity, &m);
+        print_metrics(&m, policy->name);
+    }
+    
+    printf("\n\nCore Scaling (Priority, affinity %s):\n", affinity ? "on" : "off");
+    printf("%-6s %-10s %-10s %-10s %-8s %-10s %-8s\n", "Cores", "AvgResp", "AvgTAT", "EmergMax",
+           "CPU%", "Migrations", "Steals");
+    printf("------ ---------- ---------- ---------- -------- ---------- --------\n");
+    for (int k = 1; k <= cores; k = k < cores && k * 2 > cores ? cores : k * 2) {
+        arena_rewind(&arena, run_start);
+        Metrics m;
+        smp_scheduling(&POLICY_PRIORITY, copy_workload(&arena, processes, n), n,
+                       &arena, k, affinity, &m);
+        printf("%-6d %-10.2f %-10.2f %-10.0f %-8.2f %-10d %-8d\n", k, m.avg_response_time,
+               m.avg_turnaround_time, m.emergency_response_max, m.cpu_utilization,
+               m.migrations, m.steals);
+        if (k == cores) break;
+    }
+    
+    arena_free(&arena);
+    return 0;
+}
+
+/*
+ * Live Validation
+ *
+ * Replays a workload on real threads to measure how far the model is from
+ * the kernel's scheduler. One thread per process sleeps until its arrival
+ * (one simulated second = --unit-ms of wall time), then spins until its own
+ * CPU time (CLOCK_THREAD_CPUTIME_ID) reaches its burst, so preemption
+ * stretches wall time but not work. Response is arrival to the first
+ * instruction after the wake-up, turnaround is arrival to completion, both
+ * on CLOCK_MONOTONIC. The model is a uniprocessor, so every worker is
+ * pinned to one CPU.
+ *
+ * Each kernel policy is paired with the model it should reproduce:
+ *   SCHED_FIFO, RT priority by triage level   Priority (Preemptive)
+ *   SCHED_FIFO, one RT priority               FCFS
+ *   SCHED_RR, one RT priority                 Round Robin, quantum = kernel slice
+ *   SCHED_OTHER, nice by triage level         Priority (Preemptive)
+ * The real-time modes need root or CAP_SYS_NICE and are skipped without it.
+ */
+#define LIVE_MAX_PROCESSES  512
+#define LIVE_DEFAULT_UNIT_MS 5
+#define LIVE_RT_PRIORITY    40          // triage level p runs at LIVE_RT_PRIORITY - p
+#define LIVE_NICE_STEP      4           // triage level p runs at nice (p - 1) * LIVE_NICE_STEP
+#define LIVE_STACK_BYTES    (64 * 1024)
+#define LIVE_LEAD_NS        20000000    // all threads are parked before time 0
+
+typedef struct {
+    const char *name;
+    int policy;              // SCHED_FIFO, SCHED_RR or SCHED_OTHER
+    int by_priority;         // RT priority or nice follows the triage level
+    const SchedPolicy *model;
+} LiveMode;
+
+typedef struct {
+    const Process *proc;
+    const LiveMode *mode;
+    int64_t unit_ns;
+    const int64_t *epoch_ns;     // time 0, published before the barrier opens
+    pthread_barrier_t *barrier;
+    int64_t response_ns;
+    int64_t turnaround_ns;
+    int64_t finish_ns;           // completion, relative to time 0
+    long involuntary;            // preemptions seen by the kernel (getrusage)
+} LiveWorker;
+
+const LiveMode live_modes[] = {
+    {"SCHED_FIFO, RT priority by triage level", SCHED_FIFO, 1, &POLICY_PRIORITY},
+    {"SCHED_FIFO, one RT priority", SCHED_FIFO, 0, &POLICY_FCFS},
+    {"SCHED_RR, one RT priority", SCHED_RR, 0, &POLICY_ROUND_ROBIN},
+    {"SCHED_OTHER, nice by triage level", SCHED_OTHER, 1, &POLICY_PRIORITY},
+};
+#define LIVE_MODE_COUNT ((int)(sizeof(live_modes) / sizeof(live_modes[0])))
+
+static int64_t live_now_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void *live_worker(void *arg) {
+    LiveWorker *w = arg;
+    
+    if (w->mode->policy == SCHED_OTHER && w->mode->by_priority)
+        setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), (w->proc->priority - 1) * LIVE_NICE_STEP);
+    pthread_barrier_wait(w->barrier);
+    
+    int64_t arrival = *w->epoch_ns + w->proc->arrival_time * w->unit_ns;
+    struct timespec at = {arrival / 1000000000, arrival % 1000000000};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &at, NULL) == EINTR) {}
+    int64_t start = live_now_ns(CLOCK_MONOTONIC);   // first ran since arriving
+    
+    int64_t cpu_end = live_now_ns(CLOCK_THREAD_CPUTIME_ID) + w->proc->burst_time * w->unit_ns;
+    while (live_now_ns(CLOCK_THREAD_CPUTIME_ID) < cpu_end) {}
+    int64_t completion = live_now_ns(CLOCK_MONOTONIC);
+    
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    w->response_ns = start - arrival;
+    w->turnaround_ns = completion - arrival;
+    w->finish_ns = completion - *w->epoch_ns;
+    w->involuntary = usage.ru_nivcsw;
+    return NULL;
+}
+
+/* Runs under the mode's policy: reports the time slice the kernel gives it */
+void *live_probe(void *arg) {
+    struct timespec slice = {0, 0};
+    sched_rr_get_interval(0, &slice);
+    *(int64_t *)arg = (int64_t)slice.tv_sec * 1000000000 + slice.tv_nsec;
+    return NULL;
+}
+
+/*
+ * Replay proc[] under one kernel policy pinned to cpu; slice_ns receives the
+ * policy's time slice (0 if none). Returns 0, or the error the probe thread
+ * was refused with: EPERM if the policy is not permitted, EINVAL if cpu is
+ * not one this process may run on.
+ */
+int live_run(const LiveMode *mode, const Process proc[], int n, int64_t unit_ns, int cpu,
+             LiveWorker workers[], int64_t *slice_ns) {
+    pthread_t *threads = malloc((size_t)n * sizeof(pthread_t));
+    pthread_barrier_t barrier;
+    pthread_attr_t attr;
+    struct sched_param param = {0};
+    cpu_set_t cpus;
+    int64_t epoch = 0;
+    
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, LIVE_STACK_BYTES);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, mode->policy);
+    
+    // Probe the policy once, so a refusal cannot strand threads at the barrier
+    if (mode->policy != SCHED_OTHER) param.sched_priority = LIVE_RT_PRIORITY;
+    pthread_attr_setschedparam(&attr, &param);
+    int err = pthread_create(&threads[0], &attr, live_probe, slice_ns);
+    if (err != 0) {
+        pthread_attr_destroy(&attr);
+        free(threads);
+        return err;
+    }
+    pthread_join(threads[0], NULL);
+    
+    pthread_barrier_init(&barrier, NULL, (unsigned)n + 1);
+    for (int i = 0; i < n; i++) {
+        if (mode->policy != SCHED_OTHER)
+            param.sched_priority = mode->by_priority ? LIVE_RT_PRIORITY - proc[i].priority : LIVE_RT_PRIORITY;
+        pthread_attr_setschedparam(&attr, &param);
+        workers[i] = (LiveWorker){&proc[i], mode, unit_ns, &epoch, &barrier, 0, 0, 0, 0};
+        err = pthread_create(&threads[i], &attr, live_worker, &workers[i]);
+        if (err != 0) {
+            fprintf(stderr, "pthread_create failed for process %d: %s\n", proc[i].pid, strerror(err));
+            exit(1);
+        }
+    }
+    
+    epoch = live_now_ns(CLOCK_MONOTONIC) + LIVE_LEAD_NS;
+    pthread_barrier_wait(&barrier);
+    for (int i = 0; i < n; i++) pthread_join(threads[i], NULL);
+    
+    pthread_barrier_destroy(&barrier);
+    pthread_attr_destroy(&attr);
+    free(threads);
+    return 0;
+}
+
+typedef struct {
+    double mean_response_error;  // mean |live - model| response, time units
+    double max_response_error;
+    double mean_turnaround_error;
+    double emergency_model;      // worst emergency response, -1 if none
+    double emergency_live;
+} LiveSummary;
+
+/* Live results next to the model run (Process results in run[]) */
+LiveSummary print_live_comparison(const Process run[], const LiveWorker workers[], int n,
+                                  const Metrics *model, int64_t unit_ns) {
+    LiveSummary s = {0, 0, 0, -1, -1};
+    double response = 0, turnaround = 0, waiting = 0, total = 0;
+    long preemptions = 0;
+    
+    for (int i = 0; i < n; i++) {
+        double r = (double)workers[i].response_ns / unit_ns;
+        double tat = (double)workers[i].turnaround_ns / unit_ns;
+        double finish = (double)workers[i].finish_ns / unit_ns;
+        double response_error = fabs(r - run[i].response_time);
+        response += r;
+        turnaround += tat;
+        waiting += tat - run[i].burst_time;
+        if (finish > total) total = finish;
+        preemptions += workers[i].involuntary;
+        s.mean_response_error += response_error / n;
+        s.mean_turnaround_error += fabs(tat - run[i].turnaround_time) / n;
+        if (response_error > s.max_response_error) s.max_response_error = response_error;
+        if (run[i].priority == 1) {
+            if (run[i].response_time > s.emergency_model) s.emergency_model = run[i].response_time;
+            if (r > s.emergency_live) s.emergency_live = r;
+        }
+    }
+    
+    printf("\nLive vs Model (time units, 1 unit = %.1f ms):\n", unit_ns / 1e6);
+    printf("%-30s %-12s %-12s %s\n", "Metric", "Model", "Live", "Difference");
+    printf("%-30s %-12s %-12s %s\n", "------------------------------", "-----", "----", "----------");
+    const char *names[] = {"Average Response Time", "Average Turnaround Time", "Average Waiting Time",
+                           "EMERGENCY Response (worst)", "Total Execution Time"};
+    double modeled[] = {model->avg_response_time, model->avg_turnaround_time, model->avg_waiting_time,
+                        s.emergency_model, model->total_time};
+    double live[] = {response / n, turnaround / n, waiting / n, s.emergency_live, total};
+    for (int k = 0; k < 5; k++) {
+        if (modeled[k] < 0) continue;
+        printf("%-30s %-12.2f %-12.2f %+.2f\n", names[k], modeled[k], live[k], live[k] - modeled[k]);
+    }
+    printf("%-30s %-12d %-12ld (live: one per process + kernel preemptions)\n", "Dispatches",
+           model->context_switches, n + preemptions);
+    
+    printf("\n%-22s %-8s %-7s %-5s %-19s %s\n", "Process", "Priority", "Arrival", "Burst",
+           "Response model/live", "TAT model/live");
+    printf("---------------------- -------- ------- ----- ------------------- ---------------\n");
+    int rows = n < WORKLOAD_PRINT_LIMIT ? n : WORKLOAD_PRINT_LIMIT;
+    for (int i = 0; i < rows; i++) {
+        printf("%-22s %-8d %-7d %-5d %6d / %-10.2f %5d / %.2f\n", run[i].name, run[i].priority,
+               run[i].arrival_time, run[i].burst_time, run[i].response_time,
+               (double)workers[i].response_ns / unit_ns, run[i].turnaround_time,
+               (double)workers[i].turnaround_ns / unit_ns);
+    }
+    if (rows < n) printf("... %d more processes\n", n - rows);
+    return s;
+}
+
+/* --live: every kernel policy on real threads against its model */
+int run_live(int argc, char *argv[]) {
+    int unit_ms = LIVE_DEFAULT_UNIT_MS, cpu = sched_getcpu();
+    const char *path = NULL;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--unit-ms") == 0 && i + 1 < argc) unit_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+            char *end;
+            long value = strtol(argv[++i], &end, 10);
+            cpu = end == argv[i] || *end != '\0' || value < 0 || value >= CPU_SETSIZE ? -1 : (int)value;
+        }
+        else if (path == NULL && argv[i][0] != '-') path = argv[i];
+        else {
+            fprintf(stderr, "Unknown live option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    if (unit_ms < 1 || cpu < 0 || cpu >= CPU_SETSIZE) {
+        fprintf(stderr, "Need --unit-ms >= 1 and a valid --cpu\n");
+        return 1;
+    }
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && !CPU_ISSET(cpu, &allowed)) {
+        fprintf(stderr, "CPU %d is offline or outside this process's affinity (--cpu)\n", cpu);
+        return 1;
+    }
+    
+    Arena arena;
+    int n;
+    Process *processes;
+    if (path != NULL) {
+        processes = open_trace_workload(path, &arena, &n);
+        if (processes == NULL) return 1;
+    } else {
+        if (arena_init(&arena, SIM_ARENA_DEFAULT) != 0) {
+            perror("arena_init failed");
+            return 1;
+        }
+        path = "Emergency scenario";
+        processes = init_emergency_scenario(&arena, &n);
+    }
+    if (n > LIVE_MAX_PROCESSES) {
+        fprintf(stderr, "Live mode replays at most %d processes (workload has %d)\n", LIVE_MAX_PROCESSES, n);
+        arena_free(&arena);
+        return 1;
+    }
+    
+    int64_t unit_ns = (int64_t)unit_ms * 1000000;
+    long long burst = 0;
+    for (int i = 0; i < n; i++) burst += processes[i].burst_time;
+    
+    printf("================================================================================\n");
+    printf("           HPMS LIVE VALIDATION: model vs kernel scheduler\n");
+    printf("           Workload: %s (%d processes, %lld units of CPU)\n", path, n, burst);
+    printf("           1 time unit = %d ms, all workers pinned to CPU %d\n", unit_ms, cpu);
+    printf("================================================================================\n");
+    
+    LiveWorker *workers = malloc((size_t)n * sizeof(LiveWorker));
+    LiveSummary summary[LIVE_MODE_COUNT];
+    int ran[LIVE_MODE_COUNT] = {0};
+    ArenaMark run_start = arena_mark(&arena);
+    for (int k = 0; k < LIVE_MODE_COUNT; k++) {
+        const LiveMode *mode = &live_modes[k];
+        SchedPolicy model = *mode->model;
+        int64_t slice_ns = 0;
+        
+        printf("\n\n--- %s  vs  model: %s ---\n", mode->name, model.name);
+        fflush(stdout);
+        int err = live_run(mode, processes, n, unit_ns, cpu, workers, &slice_ns);
+        if (err == EPERM) {
+            printf("✗ Skipped: %s not permitted (needs root or CAP_SYS_NICE)\n", mode->name);
+            continue;
+        }
+        if (err == EINVAL) {
+            printf("✗ Skipped: CPU %d is offline or outside this process's affinity (--cpu)\n", cpu);
+            continue;
+        }
+        if (err != 0) {
+            printf("✗ Skipped: %s refused: %s\n", mode->name, strerror(err));
+            continue;
+        }
+        if (mode->policy == SCHED_RR && slice_ns > 0) {
+            // Model the kernel's own slice, rounded to whole time units
+            model.quantum = (int)((slice_ns + unit_ns / 2) / unit_ns);
+            if (model.quantum < 1) model.quantum = 1;
+            printf("Kernel RR slice: %.0f ms = model quantum of %d units\n", slice_ns / 1e6, model.quantum);
+        }
+        arena_rewind(&arena, run_start);
+        Process *run = copy_workload(&arena, processes, n);
+        Metrics m;
+        schedule(&model, run, n, &arena, NULL, &m);
+        print_metrics(&m, model.name);
+        summary[k] = print_live_comparison(run, workers, n, &m, unit_ns);
+        ran[k] = 1;
+    }
+    free(workers);
+    
+    printf("\n\nModel Error Summary (time units):\n");
+    printf("%-40s %-12s %-12s %-12s %s\n", "Kernel policy", "Resp |err|", "Resp max err",
+           "TAT |err|", "Emergency model/live");
+    printf("---------------------------------------- ------------ ------------ ------------ --------------------\n");
+    for (int k = 0; k < LIVE_MODE_COUNT; k++) {
+        if (!ran[k]) {
+            printf("%-40s skipped\n", live_modes[k].name);
+            continue;
+        }
+        printf("%-40s %-12.2f %-12.2f %-12.2f ", live_modes[k].name, summary[k].mean_response_error,
+               summary[k].max_response_error, summary[k].mean_turnaround_error);
+        if (summary[k].emergency_model >= 0)
+            printf("%.0f / %.2f\n", summary[k].emergency_model, summary[k].emergency_live);
+        else
+            printf("-\n");
+    }
+    printf("\nErrors under 1 unit mean the model predicts the kernel to within a time unit;\n");
+    printf("larger ones show where the model should not be trusted for capacity planning.\n");
+    
+    arena_free(&arena);
+    return 0;
+}
+
+/*
+ * Benchmark
+ *
+ * Times every engine on synthetic workloads of 10 .. --max processes (in
+ * decades) and prints one result line per (distribution, engine, n). With
+ * --out the same results are written as CSV and a later run can compare
+ * against that file with --baseline. Two checks flag regressions:
+ * - scaling: the log-log slope between neighbouring sizes (n >= 1000) must
+ *   stay below BENCH_MAX_EXPONENT, which catches O(n^2) creeping in
+ * - baseline: a size must not be more than BENCH_TOLERANCE slower
+ * Either failure makes --bench exit 1.
+ *
+ * Arrivals are a Bernoulli process (geometric gaps, the discrete-time
+ * Poisson process); "burst" adds mass-casualty surges of 20-100 critical
+ * arrivals within about 10 seconds. Generation is seeded and repeatable.
+ */
+#define BENCH_MEAN_GAP      7       // mean inter-arrival; bursts 1-10 give ~80% load
+#define BENCH_SURGE_GAP     2000    // mean time between mass-casualty surges
+#define BENCH_MIN_SECONDS   0.2     // repeat small runs until this much is timed
+#define BENCH_MAX_RUNS      1000
+#define BENCH_MAX_EXPONENT  1.5
+#define BENCH_TOLERANCE     0.25
+#define BENCH_MAX_RESULTS   256
+
+typedef struct {
+    const char *name;
+    const SchedPolicy *policy;
+    int cores;           // 1 = uniprocessor kernel, otherwise smp_scheduling()
+} BenchEngine;
+
+typedef struct {
+    const char *distribution;
+    const char *engine;
+    int n;
+    double seconds;      // fastest run
+    int runs;
+} BenchResult;
+
+static inline uint64_t bench_random(uint64_t *state) {
+    // splitmix64
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline int bench_uniform(uint64_t *state, int lo, int hi) {
+    return lo + (int)(bench_random(state) % (uint64_t)(hi - lo + 1));
+}
+
+/* Geometric gap with the given mean (at least 1) */
+static int bench_gap(uint64_t *state, int mean) {
+    int gap = 0;
+    do gap++; while (bench_random(state) % (uint64_t)mean != 0);
+    return gap;
+}
+
+Process *generate_workload(Arena *arena, int n, int bursty, uint64_t seed) {
+    static const char *classes[5] = {"Critical - Synthetic", "Urgent - Synthetic",
+                                     "Standard - Synthetic", "Non-critical - Synthetic",
+                                     "Background - Synthetic"};
+    Process *proc = sim_alloc(arena, (size_t)n * sizeof(Process));
+    uint64_t state = seed;
+    int t = 0, surge_left = 0, next_surge = bench_gap(&state, BENCH_SURGE_GAP);
+    
+    for (int i = 0; i < n; i++) {
+        int priority, burst;
+        if (bursty && surge_left == 0 && t >= next_surge) surge_left = bench_uniform(&state, 20, 100);
+        if (surge_left > 0) {
+            t += bench_random(&state) % 4 == 0;  // ~4 arrivals per second
+            priority = bench_random(&state) % 5 == 0 ? 2 : 1;
+            burst = bench_uniform(&state, 1, 6);
+            if (--surge_left == 0) next_surge = t + bench_gap(&state, BENCH_SURGE_GAP);
+        } else {
+            t += bench_gap(&state, BENCH_MEAN_GAP);
+            int r = bench_uniform(&state, 1, 100);
+            priority = r <= 10 ? 1 : r <= 30 ? 2 : r <= 60 ? 3 : r <= 85 ? 4 : 5;
+            burst = bench_uniform(&state, 1, 10);
+        }
+        proc[i] = (Process){i, "", classes[priority - 1], priority, t, burst, burst, 0, 0, 0, -1, -1};
+        snprintf(proc[i].name, sizeof(proc[i].name), "Synthetic #%d", i);
+    }
+    return proc;
+}
+
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Fastest of repeated runs; the workload copy is not timed */
+double bench_engine(const BenchEngine *engine, Process workload[], int n, Arena *arena, int *runs) {
+    ArenaMark mark = arena_mark(arena);
+    Metrics m;
+    double best = 0, total = 0;
+    for (*runs = 0; *runs < BENCH_MAX_RUNS; ) {
+        arena_rewind(arena, mark);
+        Process *run = copy_workload(arena, workload, n);
+        double t0 = bench_now();
+        if (engine->cores > 1) smp_scheduling(engine->policy, run, n, arena, engine->cores, 0, &m);
+        else schedule(engine->policy, run, n, arena, NULL, &m);
+        double elapsed = bench_now() - t0;
+        
+        if (*runs == 0 || elapsed < best) best = elapsed;
+        total += elapsed;
+        (*runs)++;
+        if (total >= BENCH_MIN_SECONDS && (*runs >= 3 || total >= 5 * BENCH_MIN_SECONDS)) break;
+    }
+    arena_rewind(arena, mark);
+    return best;
+}
+
+/* Read results written by --out; returns the count, -1 if unreadable */
+int read_bench_baseline(const char *path, BenchResult results[], char names[][2][64], int max) {
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        perror("Cannot open baseline");
+        return -1;
+    }
+    char line[256];
+    int count = 0;
+    while (count < max && fgets(line, sizeof(line), in) != NULL) {
+        BenchResult *r = &results[count];
+        if (sscanf(line, "%63[^,],%63[^,],%d,%lf", names[count][0], names[count][1],
+                   &r->n, &r->seconds) != 4)
+            continue;  // header or malformed line
+        r->distribution = names[count][0];
+        r->engine = names[count][1];
+        count++;
+    }
+    fclose(in);
+    return count;
+}
+
+int run_bench(int argc, char *argv[]) {
+    int max_n = 1000000, distributions = 3;  // bit 0 = poisson, bit 1 = burst
+    uint64_t seed = 42;
+    const char *out_path = NULL, *baseline_path = NULL;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--max") == 0 && i + 1 < argc) {
+            max_n = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dist") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "poisson") == 0) distributions = 1;
+            else if (strcmp(argv[i], "burst") == 0) distributions = 2;
+            else if (strcmp(argv[i], "both") == 0) distributions = 3;
+            else {
+                fprintf(stderr, "Unknown distribution '%s' (usage: --dist poisson|burst|both)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown bench option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    if (max_n < 10) max_n = 10;
+    
+    BenchEngine engines[SWEEP_POLICY_COUNT + 1];
+    int engine_count = 0;
+    for (int p = 0; p < SWEEP_POLICY_COUNT; p++)
+        engines[engine_count++] = (BenchEngine){sweep_policies[p]->name, sweep_policies[p], 1};
+    engines[engine_count++] = (BenchEngine){"Priority SMP-4", &POLICY_PRIORITY, 4};
+    
+    BenchResult results[BENCH_MAX_RESULTS], baseline[BENCH_MAX_RESULTS];
+    static char baseline_names[BENCH_MAX_RESULTS][2][64];
+    int result_count = 0, baseline_count = 0, failures = 0;
+    if (baseline_path != NULL) {
+        baseline_count = read_bench_baseline(baseline_path, baseline, baseline_names, BENCH_MAX_RESULTS);
+        if (baseline_count < 0) return 1;
+    }
+    
+    printf("================================================================================\n");
+    printf("           HPMS SCHEDULER BENCHMARK (n = 10..%d, seed %llu)\n", max_n, (unsigned long long)seed);
+    printf("================================================================================\n");
+    printf("%-8s %-16s %-8s %-12s %-10s %-6s %-8s %s\n", "Dist", "Engine", "n", "Seconds",
+           "ns/proc", "Runs", "Exponent", "Check");
+    printf("-------- ---------------- -------- ------------ ---------- ------ -------- -----\n");
+    
+    for (int d = 0; d < 2; d++) {
+        if (!(distributions & (1 << d))) continue;
+        const char *dist = d == 0 ? "poisson" : "burst";
+        int dist_start = result_count;
+        
+        for (long n = 10; n <= max_n; n *= 10) {
+            Arena arena;
+            if (arena_init(&arena, sim_arena_bytes(n)) != 0) {
+                perror("arena_init failed");
+                return 1;
+            }
+            Process *workload = generate_workload(&arena, (int)n, d == 1, seed);
+            
+            for (int e = 0; e < engine_count && result_count < BENCH_MAX_RESULTS; e++) {
+                BenchResult *r = &results[result_count++];
+                *r = (BenchResult){dist, engines[e].name, (int)n, 0, 0};
+                r->seconds = bench_engine(&engines[e], workload, (int)n, &arena, &r->runs);
+                
+                // Scaling exponent against the previous decade of this engine
+                char exponent[16] = "-", check[64] = "";
+                BenchResult *prev = result_count - 1 - engine_count >= dist_start
+                                  ? &results[result_count - 1 - engine_count] : NULL;
+                if (prev != NULL && prev->n >= 1000 && prev->seconds > 0 && r->seconds > 0) {
+                    double slope = log(r->seconds / prev->seconds) / log((double)r->n / prev->n);
+                    snprintf(exponent, sizeof(exponent), "%.2f", slope);
+                    if (slope > BENCH_MAX_EXPONENT) {
+                        snprintf(check, sizeof(check), "SUPERLINEAR");
+                        failures++;
+                    }
+                }
+                
+                for (int b = 0; b < baseline_count; b++) {
+                    BenchResult *base = &baseline[b];
+                    if (base->n != r->n || r->n < 1000 || strcmp(base->distribution, dist) != 0 ||
+                        strcmp(base->engine, r->engine) != 0)
+                        continue;
+                    double change = base->seconds > 0 ? r->seconds / base->seconds - 1 : 0;
+                    if (change > BENCH_TOLERANCE) {
+                        snprintf(check + strlen(check), sizeof(check) - strlen(check),
+                                 "%sREGRESSION +%.0f%%", check[0] ? " " : "", change * 100);
+                        failures++;
+                    }
+                }
+                
+                printf("%-8s %-16s %-8d %-12.6f %-10.1f %-6d %-8s %s\n", dist, r->engine, r->n,
+                       r->seconds, r->seconds * 1e9 / r->n, r->runs, exponent, check[0] ? check : "ok");
+                fflush(stdout);
+            }
+            arena_free(&arena);
+        }
+    }
+    
+    if (out_path != NULL) {
+        FILE *out = fopen(out_path, "w");
+        if (out == NULL) {
+            perror("Cannot open results file");
+            return 1;
+        }
+        fprintf(out, "distribution,engine,n,seconds,ns_per_process,runs\n");
+        for (int i = 0; i < result_count; i++)
+            fprintf(out, "%s,%s,%d,%.9f,%.2f,%d\n", results[i].distribution, results[i].engine,
+                    results[i].n, results[i].seconds, results[i].seconds * 1e9 / results[i].n,
+                    results[i].runs);
+        if (fclose(out) != 0) {
+            perror("Error writing results");
+            return 1;
+        }
+        printf("\nResults written to %s\n", out_path);
+    }
+    
+    printf("\n%s: %d check(s) failed\n", failures ? "FAIL" : "PASS", failures);
+    return failures ? 1 : 0;
+}
+
+/*
+ * --online: a policy as a live dispatcher. Arrivals are submitted as they
+ * happen (the clock is advanced to each one first), metrics are polled as
+ * the run goes, and the drained result is checked against the batch
+ * kernel. A synthetic surge then times the online path against
+ * recomputing batch metrics at every poll.
+ */
+#define ONLINE_POLLS    12
+#define ONLINE_BENCH_N  1000000
+#define ONLINE_BENCH_POLL_EVERY 1000
+
+int metrics_equal(const Metrics *a, const Metrics *b) {
+    return a->avg_response_time == b->avg_response_time &&
+           a->avg_turnaround_time == b->avg_turnaround_time &&
+           a->avg_waiting_time == b->avg_waiting_time &&
+           a->emergency_response_min == b->emergency_response_min &&
+           a->emergency_response_max == b->emergency_response_max &&
+           a->context_switches == b->context_switches && a->total_time == b->total_time &&
+           memcmp(a->response_hist, b->response_hist, sizeof(a->response_hist)) == 0 &&
+           memcmp(a->waiting_hist, b->waiting_hist, sizeof(a->waiting_hist)) == 0;
+}
+
+/* Submit proc[] in arrival order, polling every poll_every arrivals (0 = never); final metrics into *out */
+void online_replay(OnlineScheduler *s, const Process proc[], int n, Arena *arena,
+                   int poll_every, int print, Metrics *out) {
+    int *arrival = sim_alloc(arena, (size_t)n * sizeof(int));
+    for (int i = 0; i < n; i++) arrival[i] = proc[i].arrival_time;
+    int *order = sort_by_key(arrival, n, arena);
+    
+    for (int k = 0; k < n; k++) {
+        const Process *p = &proc[order[k]];
+        scheduler_advance_to(s, p->arrival_time);
+        scheduler_submit(s, p);
+        if (poll_every == 0 || (k + 1) % poll_every != 0) continue;
+        scheduler_poll_metrics(s, out);
+        if (!print) continue;
+        printf("%-6d %-22s %-8d %-6d %-10.2f %-10.0f ", s->now, p->name, scheduler_backlog(s),
+               s->completed, out->avg_response_time, out->emergency_response_max);
+        if (scheduler_running(s) == -1) printf("idle\n");
+        else printf("%d\n", scheduler_running(s));
+    }
+    scheduler_drain(s);
+    scheduler_poll_metrics(s, out);
+}
+
+int run_online(int argc, char *argv[]) {
+    const SchedPolicy *policy = &POLICY_PRIORITY;
+    const char *path = NULL;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            policy = find_policy(argv[++i]);
+            if (policy == NULL || policy->key == NULL) {
+                fprintf(stderr, "Policy '%s' has no online dispatcher\n", argv[i]);
+                return 1;
+            }
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Unknown online option '%s'\n", argv[i]);
+            return 1;
+        }
+    }
+    
+    Arena arena;
+    int n;
+    Process *processes;
+    if (path != NULL) {
+        processes = open_trace_workload(path, &arena, &n);
+        if (processes == NULL) return 1;
+    } else {
+        if (arena_init(&arena, SIM_ARENA_DEFAULT) != 0) {
+            perror("arena_init failed");
+            return 1;
+        }
+        path = "Emergency scenario";
+        processes = init_emergency_scenario(&arena, &n);
+    }
+    
+    printf("================================================================================\n");
+    printf("           HPMS ONLINE DISPATCHER: %s\n", policy->name);
+    printf("           Workload: %s (%d processes, submitted as they arrive)\n", path, n);
+    printf("================================================================================\n\n");
+    
+    ArenaMark run_start = arena_mark(&arena);
+    OnlineScheduler online;
+    scheduler_init(&online, policy, &arena);
+    int poll_every = n > ONLINE_POLLS ? n / ONLINE_POLLS : 1;
+    printf("%-6s %-22s %-8s %-6s %-10s %-10s %s\n", "Time", "Just arrived", "Backlog", "Done",
+           "Avg resp", "Emerg max", "On CPU (pid)");
+    printf("------ ---------------------- -------- ------ ---------- ---------- -----------\n");
+    Metrics live;
+    online_replay(&online, processes, n, &arena, poll_every, 1, &live);
+    int peak_slots = online.slots.n, slot_bound = scheduler_slot_bound(&online);
+    print_metrics(&live, policy->name);
+    
+    Metrics batch;
+    schedule(policy, copy_workload(&arena, processes, n), n, &arena, NULL, &batch);
+    printf("\n%s Drained online metrics %s the batch %s run\n", metrics_equal(&live, &batch) ? "✓" : "✗",
+           metrics_equal(&live, &batch) ? "match" : "DIFFER FROM", policy->name);
+    printf("%s Slot table peaked at %d slots for %d processes (peak backlog %d, bound %d)\n",
+           peak_slots <= slot_bound ? "✓" : "✗", peak_slots, n, online.peak_backlog, slot_bound);
+    int status = metrics_equal(&live, &batch) && peak_slots <= slot_bound ? 0 : 1;
+    
+    // Surge: a million synthetic arrivals, polled every ONLINE_BENCH_POLL_EVERY
+    arena_free(&arena);
+    if (arena_init(&arena, sim_arena_bytes(ONLINE_BENCH_N)) != 0) {
+        perror("arena_init failed");
+        return 1;
+    }
+    Process *surge = generate_workload(&arena, ONLINE_BENCH_N, 1, 42);
+    run_start = arena_mark(&arena);
+    scheduler_init(&online, policy, &arena);
+    double t0 = bench_now();
+    online_replay(&online, surge, ONLINE_BENCH_N, &arena, ONLINE_BENCH_POLL_EVERY, 0, &live);
+    double online_seconds = bench_now() - t0;
+    peak_slots = online.slots.n;
+    slot_bound = scheduler_slot_bound(&online);
+    
+    // One batch recompute over everything seen, what each poll would cost without running totals
+    arena_rewind(&arena, run_start);
+    Process *run = copy_workload(&arena, surge, ONLINE_BENCH_N);
+    schedule(policy, run, ONLINE_BENCH_N, &arena, NULL, &batch);
+    SimTable table = sim_table_load(run, ONLINE_BENCH_N, &arena);
+    volatile float sink = 0;
+    t0 = bench_now();
+    Metrics recomputed;
+    calculate_metrics(&table, batch.total_time, &recomputed);
+    sink += recomputed.avg_response_time;
+    double recompute_seconds = bench_now() - t0;
+    t0 = bench_now();
+    for (int i = 0; i < 1000; i++) {
+        scheduler_poll_metrics(&online, &recomputed);
+        sink += recomputed.avg_response_time;
+    }
+    double poll_seconds = (bench_now() - t0) / 1000;
+    
+    int polls = ONLINE_BENCH_N / ONLINE_BENCH_POLL_EVERY;
+    printf("\nSurge: %d synthetic arrivals (mass-casualty bursts), polled %d times\n", ONLINE_BENCH_N, polls);
+    printf("%-36s %.1f ns per arrival (%.2fs total)\n", "Online submit + advance + polls",
+           online_seconds * 1e9 / ONLINE_BENCH_N, online_seconds);
+    printf("%-36s %.2f µs\n", "One poll (running totals)", poll_seconds * 1e6);
+    printf("%-36s %.2f ms (x%d polls = %.1fs)\n", "One calculate_metrics() recompute",
+           recompute_seconds * 1e3, polls, recompute_seconds * polls);
+    printf("%-36s %d slots for %d processes\n", "Peak slot table", peak_slots, ONLINE_BENCH_N);
+    printf("%s Slot table %s the bound for a peak backlog of %d (%d slots)\n",
+           peak_slots <= slot_bound ? "✓" : "✗", peak_slots <= slot_bound ? "within" : "OVER",
+           online.peak_backlog, slot_bound);
+    if (peak_slots > slot_bound) status = 1;
+    printf("%s Surge metrics %s the batch run\n", metrics_equal(&live, &batch) ? "✓" : "✗",
+           metrics_equal(&live, &batch) ? "match" : "DIFFER FROM");
+    if (!metrics_equal(&live, &batch)) status = 1;
+    
+    arena_free(&arena);
+    return status;
+}
+
+/*
+ * Run Diff
+ *
+ * --diff BASE NEW compares two columnar result files of the same workload:
+ * both runs' metrics (recomputed from the result columns), per-class
+ * response percentiles, and every emergency whose response got worse,
+ * worst first. Processes are matched by pid. Exits 1 when NEW's emergency
+ * response regresses (p99 or worst case), so it can gate a change.
+ */
+#define DIFF_SHOW_REGRESSIONS 10
+
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    char policy[33];
+    long events;
+    SimTable table;      // column pointers into the mapping (remaining is unused)
+    int total_time;
+} ResultFile;
+
+/* Map and index a result file; returns 0, or -1 with a message */
+int result_open(const char *path, ResultFile *r) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("Cannot open result file");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(ResultHeader) + 8) {
+        fprintf(stderr, "%s is too short to be a result file\n", path);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("mmap failed");
+        return -1;
+    }
+    r->data = map;
+    r->size = st.st_size;
+    
+    ResultHeader header;
+    memcpy(&header, r->data, sizeof(header));
+    if (memcmp(header.magic, RESULT_MAGIC, 8) != 0 || header.version != RESULT_VERSION) {
+        fprintf(stderr, "%s is not a version %d result file (write one with --export OUT.hpmsr)\n",
+                path, RESULT_VERSION);
+        munmap(map, r->size);
+        return -1;
+    }
+    memcpy(r->policy, header.policy, sizeof(header.policy));
+    r->policy[sizeof(header.policy)] = '\0';
+    
+    // Skip the event blocks to reach the process columns
+    size_t offset = sizeof(header);
+    uint32_t count;
+    r->events = 0;
+    for (;;) {
+        if (r->size - offset < 4) goto truncated;
+        memcpy(&count, r->data + offset, 4);
+        offset += 4;
+        if (count == 0) break;
+        size_t block = 9 * (size_t)count + (4 - count % 4) % 4;
+        if (r->size - offset < block) goto truncated;
+        offset += block;
+        r->events += count;
+    }
+    if (r->size - offset < 4) goto truncated;
+    memcpy(&count, r->data + offset, 4);
+    offset += 4;
+    if (count > 0x7fffffff || (r->size - offset) / (RESULT_COLUMNS * sizeof(int32_t)) < count) goto truncated;
+    
+    int *columns = (int *)(r->data + offset);
+    SimTable *t = &r->table;
+    t->n = (int)count;
+    t->pid = columns;
+    t->priority = columns + count;
+    t->arrival = columns + 2 * (size_t)count;
+    t->burst = columns + 3 * (size_t)count;
+    t->start = columns + 4 * (size_t)count;
+    t->completion = columns + 5 * (size_t)count;
+    t->remaining = NULL;
+    r->total_time = 0;
+    for (int i = 0; i < t->n; i++)
+        if (t->completion[i] > r->total_time) r->total_time = t->completion[i];
+    return 0;
+    
+truncated:
+    fprintf(stderr, "%s is truncated\n", path);
+    munmap(map, r->size);
+    return -1;
+}
+
+void result_close(ResultFile *r) {
+    munmap((void *)r->data, r->size);
+}
+
+typedef struct {
+    int pid;
+    int arrival;
+    int base_response;
+    int new_response;
+} EmergencyRegression;
+
+int compare_regression(const void *a, const void *b) {
+    const EmergencyRegression *x = a, *y = b;
+    int dx = x->new_response - x->base_response, dy = y->new_response - y->base_response;
+    if (dx != dy) return dx > dy ? -1 : 1;
+    return x->pid - y->pid;
+}
+
+static void print_diff_row(const char *name, double base, double new_value, int lower_is_better) {
+    double delta = new_value - base;
+    const char *mark = delta == 0 ? "" : (delta > 0) == lower_is_better ? "  ✗ worse" : "  ✓ better";
+    printf("%-30s %-12.2f %-12.2f %+-12.2f%s\n", name, base, new_value, delta, mark);
+}
+
+int run_diff(const char *base_path, const char *new_path) {
+    ResultFile base, next;
+    if (result_open(base_path, &base) != 0) return 1;
+    if (result_open(new_path, &next) != 0) {
+        result_close(&base);
+        return 1;
+    }
+    
+    Arena arena;
+    if (arena_init(&arena, sim_arena_bytes(base.table.n > next.table.n ? base.table.n : next.table.n)) != 0) {
+        perror("arena_init failed");
+        result_close(&base);
+        result_close(&next);
+        return 1;
+    }
+    
+    Metrics mb;
+    calculate_metrics(&base.table, base.total_time, &mb);
+    Metrics mn;
+    calculate_metrics(&next.table, next.total_time, &mn);
+    
+    printf("================================================================================\n");
+    printf("           HPMS RUN DIFF\n");
+    printf("           Base: %s (%s, %d processes, %ld events)\n", base_path, base.policy,
+           base.table.n, base.events);
+    printf("           New:  %s (%s, %d processes, %ld events)\n", new_path, next.policy,
+           next.table.n, next.events);
+    printf("================================================================================\n\n");
+    
+    printf("%-30s %-12s %-12s %-12s\n", "Metric", "Base", "New", "Difference");
+    printf("------------------------------ ------------ ------------ ------------\n");
+    print_diff_row("Average Response Time", mb.avg_response_time, mn.avg_response_time, 1);
+    print_diff_row("Average Turnaround Time", mb.avg_turnaround_time, mn.avg_turnaround_time, 1);
+    print_diff_row("Average Waiting Time", mb.avg_waiting_time, mn.avg_waiting_time, 1);
+    print_diff_row("EMERGENCY Response (worst)", mb.emergency_response_max, mn.emergency_response_max, 1);
+    print_diff_row("CPU Utilization (%)", mb.cpu_utilization, mn.cpu_utilization, 0);
+    print_diff_row("Total Execution Time", mb.total_time, mn.total_time, 1);
+    
+    printf("\nResponse by class (seconds), base -> new:\n");
+    printf("%-16s %-10s %-18s %-18s %s\n", "Class", "Count", "p50", "p99", "max");
+    printf("---------------- ---------- ------------------ ------------------ ------------------\n");
+    for (int c = 0; c < PRIORITY_CLASSES; c++) {
+        const LatencyHistogram *hb = &mb.response_hist[c], *hn = &mn.response_hist[c];
+        if (hb->total == 0 && hn->total == 0) continue;
+        char label[32], cells[3][32];
+        snprintf(label, sizeof(label), "P%d %s", c + 1, priority_class_names[c]);
+        snprintf(cells[0], sizeof(cells[0]), "%llu -> %llu", (unsigned long long)lh_percentile(hb, 50),
+                 (unsigned long long)lh_percentile(hn, 50));
+        snprintf(cells[1], sizeof(cells[1]), "%llu -> %llu", (unsigned long long)lh_percentile(hb, 99),
+                 (unsigned long long)lh_percentile(hn, 99));
+        snprintf(cells[2], sizeof(cells[2]), "%llu -> %llu", (unsigned long long)hb->max,
+                 (unsigned long long)hn->max);
+        printf("%-16s %-10llu %-18s %-18s %s\n", label, (unsigned long long)hn->total, cells[0], cells[1],
+               cells[2]);
+    }
+    
+    // Match processes by pid: both runs' indices sorted by pid, then one merge pass
+    int *base_order = sort_by_key(base.table.pid, base.table.n, &arena);
+    int *new_order = sort_by_key(next.table.pid, next.table.n, &arena);
+    EmergencyRegression *regressions = sim_alloc(&arena, (size_t)base.table.n * sizeof(EmergencyRegression));
+    int regressed = 0, matched = 0, emergencies = 0, improved = 0;
+    for (int a = 0, b = 0; a < base.table.n && b < next.table.n; ) {
+        int i = base_order[a], j = new_order[b];
+        int pid_a = base.table.pid[i], pid_b = next.table.pid[j];
+        if (pid_a != pid_b) {
+            if (pid_a < pid_b) a++;
+            else b++;
+            continue;
+        }
+        a++, b++, matched++;
+        if (base.table.priority[i] != 1 || base.table.completion[i] <= 0 || next.table.completion[j] <= 0)
+            continue;
+        emergencies++;
+        int rb = base.table.start[i] - base.table.arrival[i];
+        int rn = next.table.start[j] - next.table.arrival[j];
+        if (rn < rb) improved++;
+        if (rn > rb) regressions[regressed++] = (EmergencyRegression){pid_a, base.table.arrival[i], rb, rn};
+    }
+    
+    printf("\nMatched %d of %d / %d processes by pid; %d emergencies compared\n", matched, base.table.n,
+           next.table.n, emergencies);
+    printf("Emergencies: %d slower, %d faster, %d unchanged\n", regressed, improved,
+           emergencies - regressed - improved);
+    if (regressed > 0) {
+        qsort(regressions, regressed, sizeof(EmergencyRegression), compare_regression);
+        int shown = regressed < DIFF_SHOW_REGRESSIONS ? regressed : DIFF_SHOW_REGRESSIONS;
+        printf("\nWorst emergency regressions:\n");
+        printf("%-10s %-10s %-10s %-10s %s\n", "PID", "Arrival", "Base resp", "New resp", "Change");
+        printf("---------- ---------- ---------- ---------- ------\n");
+        for (int k = 0; k < shown; k++)
+            printf("%-10d %-10d %-10d %-10d +%ds\n", regressions[k].pid, regressions[k].arrival,
+                   regressions[k].base_response, regressions[k].new_response,
+                   regressions[k].new_response - regressions[k].base_response);
+        if (shown < regressed) printf("... %d more\n", regressed - shown);
+    }
+    
+    const LatencyHistogram *eb = &mb.response_hist[0], *en = &mn.response_hist[0];
+    int regression = en->total > 0 && (lh_percentile(en, 99) > lh_percentile(eb, 99) || en->max > eb->max);
+    printf("\n%s\n", regression ? "✗ EMERGENCY RESPONSE REGRESSED (p99 or worst case)"
+                                : "✓ No emergency response regression");
+    
+    arena_free(&arena);
+    result_close(&base);
+    result_close(&next);
+    return regression ? 1 : 0;
+}
+
+int convert_trace(const char *in_path, const char *out_path) {
+    Arena arena;
+    int n;
+    Process *processes = open_trace_workload(in_path, &arena, &n);
+    if (processes == NULL) return 1;
+    
+    int status = write_binary_trace(out_path, processes, n);
+    if (status == 0) printf("Wrote %d processes to %s\n", n, out_path);
+    
+    arena_free(&arena);
+    return status == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        if (strcmp(argv[1], "--trace") == 0 && argc >= 3) {
+            return run_trace(argc - 2, argv + 2);
+        }
+        if (strcmp(argv[1], "--convert") == 0 && argc == 4) {
+            return convert_trace(argv[2], argv[3]);
+        }
+        if (strcmp(argv[1], "--diff") == 0 && argc == 4) {
+            return run_diff(argv[2], argv[3]);
+        }
+        if (strcmp(argv[1], "--sweep") == 0) {
+            return run_sweep(argc - 2, argv + 2);
+        }
+        if (strcmp(argv[1], "--smp") == 0) {
+            return run_smp(argc - 2, argv + 2);
+        }
+        if (strcmp(argv[1], "--bench") == 0) {
+            return run_bench(argc - 2, argv + 2);
+        }
+        if (strcmp(argv[1], "--online") == 0) {
+            return run_online(argc - 2, argv + 2);
+        }
+        if (strcmp(argv[1], "--live") == 0) {
+            return run_live(argc - 2, argv + 2);
+        }
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    printf("================================================================================\n");
+    printf("           HPMS PROCESS SCHEDULING ANALYSIS\n");
+    printf("           Hospital Patient Management System - Emergency Scenarios\n");
+    printf("================================================================================\n\n");
+    
+    printf("Test Scenarios:\n");
+    printf("1. EMERGENCY SCENARIO (Primary Focus) - Mass casualty with multiple critical patients\n");
+    printf("2. Normal Case - Standard evening rush (150 patients/hour)\n");
+    printf("3. Best Case - Light load validation (50 patients/hour)\n\n");
+    
+    printf("Testing 5 Algorithms: Priority (Preemptive), FCFS, SJF, Round Robin, MLFQ\n");
+    printf("================================================================================\n");
+    
+    // One arena serves every built-in scenario; reset, not freed, in between
+    Arena arena;
+    if (arena_init(&arena, SIM_ARENA_DEFAULT) != 0) {
+        perror("arena_init failed");
+        return 1;
+    }
+    
+    // Emergency scenario with full details
+    int n_emergency;
+    Process *processes_emergency = init_emergency_scenario(&arena, &n_emergency);
+    run_scenario("EMERGENCY SCENARIO (MASS CASUALTY)\n           6 Critical Patients + Mixed Priority Operations", 
+                 processes_emergency, n_emergency, &arena, 1);
+    
+    // Normal case with moderate details
+    printf("\n\n");
+    printf("================================================================================\n");
+    printf("                        NORMAL CASE VALIDATION\n");
+    printf("           Standard Evening Rush (150 patients/hour)\n");
+    printf("================================================================================\n");
+    
+    arena_reset(&arena);
+    int n_normal;
+    Process *processes_normal = init_normal_scenario(&arena, &n_normal);
+    print_workload(processes_normal, n_normal);
+    
+    ArenaMark run_start = arena_mark(&arena);
+    Metrics m1;
+    priority_scheduling(copy_workload(&arena, processes_normal, n_normal), n_normal, &arena, 0, &m1);
+    arena_rewind(&arena, run_start);
+    Metrics m2;
+    fcfs_scheduling(copy_workload(&arena, processes_normal, n_normal), n_normal, &arena, &m2);
+    arena_rewind(&arena, run_start);
+    Metrics m3;
+    sjf_scheduling(copy_workload(&arena, processes_normal, n_normal), n_normal, &arena, &m3);
+    arena_rewind(&arena, run_start);
+    Metrics m4;
+    round_robin_scheduling(copy_workload(&arena, processes_normal, n_normal), n_normal, &arena, TIME_QUANTUM, &m4);
+    arena_rewind(&arena, run_start);
+    Metrics m5;
+    mlfq_scheduling(copy_workload(&arena, processes_normal, n_normal), n_normal, &arena, TIME_QUANTUM, &m5);
+    
+    printf("\n\nAlgorithm Comparison (Normal Case):\n");
+    printf("Metric                    Priority    FCFS        SJF         Round Robin  MLFQ\n");
+    printf("------------------------  ----------  ----------  ----------  -----------  ----------\n");
+    printf("Avg Response Time         %-10.2fs  %-10.2fs  %-10.2fs  %-10.2fs   %-10.2fs\n",
+           m1.avg_response_time, m2.avg_response_time, m3.avg_response_time,
+           m4.avg_response_time, m5.avg_response_time);
+    printf("Emergency Response        %-10.0fs  %-10.0fs  %-10.0fs  %-10.0fs   %-10.0fs\n",
+           m1.emergency_response_max, m2.emergency_response_max, 
+           m3.emergency_response_max, m4.emergency_response_max, m5.emergency_response_max);
+    printf("Context Switches          %-10d  %-10d  %-10d  %-10d   %-10d\n",
+           m1.context_switches, m2.context_switches, m3.context_switches,
+           m4.context_switches, m5.context_switches);
     
     // Best case brief
     printf("\n\n");
@@ -811,28 +3718,32 @@ int main() {
     printf("           Light Load (50 patients/hour)\n");
     printf("================================================================================\n");
     
-    Process processes_best[MAX_PROCESSES];
+    arena_reset(&arena);
     int n_best;
-    init_best_scenario(processes_best, &n_best);
+    Process *processes_best = init_best_scenario(&arena, &n_best);
     print_workload(processes_best, n_best);
     
-    for (int i = 0; i < n_best; i++) {
-        p1[i] = p2[i] = p3[i] = p4[i] = processes_best[i];
-    }
-    
-    m1 = priority_scheduling(p1, n_best, 0);
-    m2 = fcfs_scheduling(p2, n_best);
-    m3 = sjf_scheduling(p3, n_best);
-    m4 = round_robin_scheduling(p4, n_best);
+    run_start = arena_mark(&arena);
+    priority_scheduling(copy_workload(&arena, processes_best, n_best), n_best, &arena, 0, &m1);
+    arena_rewind(&arena, run_start);
+    fcfs_scheduling(copy_workload(&arena, processes_best, n_best), n_best, &arena, &m2);
+    arena_rewind(&arena, run_start);
+    sjf_scheduling(copy_workload(&arena, processes_best, n_best), n_best, &arena, &m3);
+    arena_rewind(&arena, run_start);
+    round_robin_scheduling(copy_workload(&arena, processes_best, n_best), n_best, &arena, TIME_QUANTUM, &m4);
+    arena_rewind(&arena, run_start);
+    mlfq_scheduling(copy_workload(&arena, processes_best, n_best), n_best, &arena, TIME_QUANTUM, &m5);
+    arena_free(&arena);
     
     printf("\n\nAlgorithm Comparison (Best Case):\n");
-    printf("Metric                    Priority    FCFS        SJF         Round Robin\n");
-    printf("------------------------  ----------  ----------  ----------  -----------\n");
-    printf("Avg Response Time         %-10.2fs  %-10.2fs  %-10.2fs  %-10.2fs\n",
-           m1.avg_response_time, m2.avg_response_time, m3.avg_response_time, m4.avg_response_time);
-    printf("Emergency Response        %-10.0fs  %-10.0fs  %-10.0fs  %-10.0fs\n",
+    printf("Metric                    Priority    FCFS        SJF         Round Robin  MLFQ\n");
+    printf("------------------------  ----------  ----------  ----------  -----------  ----------\n");
+    printf("Avg Response Time         %-10.2fs  %-10.2fs  %-10.2fs  %-10.2fs   %-10.2fs\n",
+           m1.avg_response_time, m2.avg_response_time, m3.avg_response_time,
+           m4.avg_response_time, m5.avg_response_time);
+    printf("Emergency Response        %-10.0fs  %-10.0fs  %-10.0fs  %-10.0fs   %-10.0fs\n",
            m1.emergency_response_max, m2.emergency_response_max, 
-           m3.emergency_response_max, m4.emergency_response_max);
+           m3.emergency_response_max, m4.emergency_response_max, m5.emergency_response_max);
     
     printf("\n\n");
     printf("================================================================================\n");
@@ -857,6 +3768,11 @@ int main() {
     printf("    - Unnecessary context switching overhead (50-80%% more than Priority)\n");
     printf("    - Cannot distinguish critical from routine tasks\n\n");
     
+    printf("✓   MLFQ WITH AGING when background work must finish under surge load\n");
+    printf("    - Emergencies enter at the top level and preempt on arrival\n");
+    printf("    - Aging bounds how long low-priority maintenance can wait\n");
+    printf("    - Fewer context switches than Round Robin for long jobs\n\n");
+    
     printf("================================================================================\n");
     
     return 0;
@@ -0,0 +1,149 @@
+/*
+ * HPMS Seqlock - Read-Mostly Records Without Reader Locks
+ *
+ * A sequence counter guards a small record. Writers make it odd while they
+ * change the record and even again when done; readers copy the record and
+ * retry if the counter was odd or moved while they copied. Readers never
+ * write shared memory, so any number of them run in parallel and never
+ * wait behind each other, only (briefly) behind a writer of that record.
+ *
+ * Writers exclude each other by taking the counter from even to odd with a
+ * compare-and-swap, so no separate mutex is needed and the lock works the
+ * same inside a shared memory segment as inside one process.
+ *
+ * Guarded data is copied in 8-byte words with relaxed atomics: records must
+ * be 8-byte aligned and a multiple of 8 bytes long.
+ *
+ * On Linux a reader can also sleep until the record changes: the sequence
+ * counter doubles as a futex word (seqlock_wait / seqlock_wake). The futex
+ * is process-shared, so this works across a shared memory segment, and
+ * waiting only reads the counter, so it works on a read-only mapping too.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+typedef struct {
+    _Atomic uint32_t seq;  // odd while a writer is inside
+} Seqlock;
+
+static inline void seqlock_init(Seqlock *lock) {
+    atomic_init(&lock->seq, 0);
+}
+
+static inline void seqlock_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* Sequence to validate the read against; waits out a writer in progress */
+static inline uint32_t seqlock_read_begin(const Seqlock *lock) {
+    uint32_t seq;
+    while ((seq = atomic_load_explicit(&lock->seq, memory_order_acquire)) & 1) seqlock_pause();
+    return seq;
+}
+
+/* Nonzero if a writer got in since read_begin and the copy must be redone */
+static inline int seqlock_read_retry(const Seqlock *lock, uint32_t seq) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&lock->seq, memory_order_relaxed) != seq;
+}
+
+static inline void seqlock_write_begin(Seqlock *lock) {
+    uint32_t seq = atomic_load_explicit(&lock->seq, memory_order_relaxed);
+    for (;;) {
+        if (!(seq & 1) && atomic_compare_exchange_weak_explicit(&lock->seq, &seq, seq + 1,
+                                                                memory_order_acquire,
+                                                                memory_order_relaxed))
+            break;
+        seqlock_pause();
+        seq = atomic_load_explicit(&lock->seq, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);  // odd count is visible before any data store
+}
+
+/*
+ * Compare-and-commit: enter the write section only if no writer has been
+ * in since read_begin returned seq. Returns 1 if entered (finish with
+ * write_end), 0 if the record changed and the caller's decision is stale.
+ */
+static inline int seqlock_write_begin_if(Seqlock *lock, uint32_t seq) {
+    if (!atomic_compare_exchange_strong_explicit(&lock->seq, &seq, seq + 1, memory_order_acquire,
+                                                 memory_order_relaxed))
+        return 0;
+    atomic_thread_fence(memory_order_release);
+    return 1;
+}
+
+static inline void seqlock_write_end(Seqlock *lock) {
+    atomic_fetch_add_explicit(&lock->seq, 1, memory_order_release);
+}
+
+/* Copy guarded data out (readers, between read_begin and read_retry) */
+static inline void seqlock_load(void *dst, const void *src, size_t bytes) {
+    uint64_t *out = dst;
+    const uint64_t *in = src;
+    for (size_t i = 0; i < bytes / 8; i++) out[i] = __atomic_load_n(&in[i], __ATOMIC_RELAXED);
+}
+
+/* Copy guarded data in (writers, between write_begin and write_end) */
+static inline void seqlock_store(void *dst, const void *src, size_t bytes) {
+    uint64_t *out = dst;
+    const uint64_t *in = src;
+    for (size_t i = 0; i < bytes / 8; i++) __atomic_store_n(&out[i], in[i], __ATOMIC_RELAXED);
+}
+
+/* Consistent snapshot of a guarded record */
+static inline void seqlock_read(const Seqlock *lock, void *dst, const void *src, size_t bytes) {
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(lock);
+        seqlock_load(dst, src, bytes);
+    } while (seqlock_read_retry(lock, seq));
+}
+
+/* Replace a guarded record in one write section */
+static inline void seqlock_write(Seqlock *lock, void *dst, const void *src, size_t bytes) {
+    seqlock_write_begin(lock);
+    seqlock_store(dst, src, bytes);
+    seqlock_write_end(lock);
+}
+
+#ifdef __linux__
+/*
+ * Sleep until a writer finishes after read_begin returned seq (or the
+ * relative timeout passes; NULL waits forever). Returns 0 when the record
+ * may have changed, -1 on timeout. Writers may coalesce wake-ups and the
+ * kernel may wake spuriously, so callers always re-read.
+ */
+static inline int seqlock_wait(const Seqlock *lock, uint32_t seq, const struct timespec *timeout) {
+    while (atomic_load_explicit(&lock->seq, memory_order_acquire) == seq) {
+        if (syscall(SYS_futex, (const uint32_t *)&lock->seq, FUTEX_WAIT, seq, timeout, NULL, 0) == 0)
+            return 0;
+        if (errno == ETIMEDOUT) return -1;
+        if (errno != EINTR) return 0;  // EAGAIN: it already changed
+    }
+    return 0;
+}
+
+/* Wake every reader sleeping in seqlock_wait on this lock; returns how many woke */
+static inline int seqlock_wake(Seqlock *lock) {
+    long woken = syscall(SYS_futex, (uint32_t *)&lock->seq, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+    return woken > 0 ? (int)woken : 0;
+}
+#endif
+
+#endif
@@ -1,87 +1,660 @@
 /*
  * HPMS Shared Memory Demo - POSIX IPC
  * Scenario: Monitoring device shares vitals with multiple displays
- * 
+ *
+ * The segment holds one slot per bed. Each slot is padded to a cache line
+ * and guarded by a seqlock (Seqlock.h): the monitoring device is the only
+ * writer, displays copy a bed's vitals and retry if the device published
+ * in the middle of the copy. Readers never write the segment (they map it
+ * read-only), so any number of displays can watch without ever blocking
+ * the device or seeing a torn heart-rate/BP pair.
+ *
+ * Every slot also keeps a ring of its last VITALS_HISTORY samples, so a
+ * display that looks away for a moment can still draw the trend.
+ *
+ * Displays that only need to redraw on change sleep instead of polling: a
+ * bedside monitor waits on its bed's seqlock counter as a futex, a nurse
+ * station on the ward counter in the header. The device coalesces wake-ups
+ * to at most --notify-hz per bed (0 = every publish), so a 1 kHz device
+ * does not wake hundreds of displays a thousand times a second; a change
+ * that is held back goes out with a later publish once the interval ends.
+ * Sleepers count themselves in a small writable waiter board next to the
+ * read-only vitals segment; the device skips the wake syscall for a bed
+ * (or the ward) with nobody asleep on it.
+ *
  * Compile: gcc -pthread shared_memory_posix.c -o shared_memory -lrt
- * Run: ./shared_memory
+ * Run: ./shared_memory                          (demo + stress run)
+ *      ./shared_memory --beds 2000 --displays 8 --rate 100 --seconds 3
+ *      ./shared_memory --rate 1000 --watchers 500 --notify-hz 20
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <fcntl.h>
+#include <time.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
+#include "Seqlock.h"
+#include "Latency_Histogram.h"
+
 #define SHM_NAME "/hpms_vitals"
-#define SHM_SIZE 1024
+#define WAITERS_NAME "/hpms_vitals_waiters"
+#define SHM_MAGIC 0x48505653       // "HPVS"
+#define VITALS_HISTORY 64          // samples kept per bed
+#define MAX_DISPLAYS 64
+#define MAX_WATCHERS 1024
+#define WATCH_TIMEOUT_NS 100000000 // sleeping displays re-check for shutdown this often
 
+/* One sample; a multiple of 8 bytes so the seqlock copies it in words */
 typedef struct {
+    uint64_t timestamp_ns;         // device clock when published
+    uint32_t sample;               // per-bed sample number, 1 = first
     int heart_rate;
     int blood_pressure_systolic;
     int blood_pressure_diastolic;
     int oxygen_saturation;
-    char status[50];
+    uint32_t checksum;             // over the readings, so displays can prove a read is whole
+    char status[40];
 } VitalsData;
 
-int main() {
+_Static_assert(sizeof(VitalsData) % 8 == 0, "seqlock copies VitalsData in 8-byte words");
+
+/* Per-bed slot: lock and latest sample first, on their own cache lines */
+typedef struct {
+    _Alignas(64) Seqlock lock;
+    uint32_t published;            // samples written so far (guarded by lock)
+    VitalsData current;
+    _Alignas(64) VitalsData history[VITALS_HISTORY];  // sample s at [(s - 1) % VITALS_HISTORY]
+} BedSlot;
+
+typedef struct {
+    _Alignas(64) uint32_t magic;
+    uint32_t beds;
+    uint32_t history;
+    uint32_t slot_size;
+    Seqlock ward;                  // guards nothing; ticks once per notification round
+    BedSlot slots[];
+} VitalsSegment;
+
+/* Sleeping displays per futex word; displays write it, so it lives apart from the vitals */
+typedef struct {
+    _Alignas(64) uint32_t beds;
+    _Atomic uint32_t sleepers[];   // per bed, then [beds] for the ward counter
+} WaiterBoard;
+
+/* Per-display results, in an anonymous shared mapping the parent reads */
+typedef struct {
+    _Alignas(64) long reads;
+    long retries;
+    long torn;
+} DisplayStats;
+
+/* Per sleeping display: how often it woke and how stale what it drew was */
+typedef struct {
+    _Alignas(64) long wakeups;
+    long changes;                  // new samples (bedside) or changed beds (ward) found on waking
+    LatencyHistogram staleness_us; // publish -> display read
+    struct rusage usage;           // filled in by the parent from wait4
+} WatcherStats;
+
+/* Device-private wake-up coalescing state */
+typedef struct {
+    uint64_t interval_ns;          // 0 = wake on every publish
+    uint64_t *last_wake;           // per bed
+    uint8_t *pending;              // per bed: published since the last wake
+    uint64_t ward_last_wake;
+    int ward_pending;
+    long wake_calls;               // futex wake syscalls made
+    long skipped;                  // wake-ups due with nobody asleep: no syscall
+    long woken;                    // displays those calls woke
+} Notifier;
+
+size_t segment_size(uint32_t beds) {
+    return sizeof(VitalsSegment) + (size_t)beds * sizeof(BedSlot);
+}
+
+uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* FNV-1a over every field but the timestamp and the checksum itself */
+uint32_t vitals_checksum(const VitalsData *v) {
+    const unsigned char *bytes = (const unsigned char *)&v->sample;
+    size_t length = offsetof(VitalsData, checksum) - offsetof(VitalsData, sample);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) hash = (hash ^ bytes[i]) * 16777619u;
+    for (size_t i = 0; i < sizeof(v->status); i++) hash = (hash ^ (unsigned char)v->status[i]) * 16777619u;
+    return hash;
+}
+
+/* Simulated device readings for one sample of a bed */
+void simulate_vitals(uint32_t bed, uint32_t sample, VitalsData *v) {
+    memset(v, 0, sizeof(*v));
+    v->sample = sample;
+    v->heart_rate = 60 + (bed * 7 + sample) % 90;
+    v->blood_pressure_systolic = 100 + (bed * 3 + sample * 5) % 60;
+    v->blood_pressure_diastolic = v->blood_pressure_systolic * 2 / 3;
+    v->oxygen_saturation = 88 + (bed + sample * 3) % 12;
+    strcpy(v->status, v->heart_rate > 140 ? "CRITICAL - Tachycardia" : "Stable");
+}
+
+/* Device side: stamp and publish one sample to a bed (latest + history ring) */
+void publish_vitals(BedSlot *slot, VitalsData *v) {
+    v->checksum = vitals_checksum(v);
+    seqlock_write_begin(&slot->lock);
+    uint32_t published = slot->published + 1;
+    seqlock_store(&slot->current, v, sizeof(*v));
+    seqlock_store(&slot->history[(published - 1) % VITALS_HISTORY], v, sizeof(*v));
+    __atomic_store_n(&slot->published, published, __ATOMIC_RELAXED);
+    seqlock_write_end(&slot->lock);
+}
+
+/*
+ * Display side: latest sample of a bed; returns how many times the copy was
+ * retried. *seq_out (if not NULL) gets the counter to wait on for the next change.
+ */
+int read_vitals(const BedSlot *slot, VitalsData *out, uint32_t *seq_out) {
+    int retries = -1;
+    uint32_t seq;
+    do {
+        retries++;
+        seq = seqlock_read_begin(&slot->lock);
+        seqlock_load(out, &slot->current, sizeof(*out));
+    } while (seqlock_read_retry(&slot->lock, seq));
+    if (seq_out != NULL) *seq_out = seq;
+    return retries;
+}
+
+/* Display side: up to max most recent samples, oldest first; returns the count */
+int read_history(const BedSlot *slot, VitalsData out[], int max) {
+    uint32_t seq, published;
+    int count;
+    if (max > VITALS_HISTORY) max = VITALS_HISTORY;
+    do {
+        seq = seqlock_read_begin(&slot->lock);
+        published = __atomic_load_n(&slot->published, __ATOMIC_RELAXED);
+        count = published < (uint32_t)max ? (int)published : max;
+        for (int i = 0; i < count; i++) {
+            uint32_t sample = published - count + 1 + i;
+            seqlock_load(&out[i], &slot->history[(sample - 1) % VITALS_HISTORY], sizeof(out[i]));
+        }
+    } while (seqlock_read_retry(&slot->lock, seq));
+    return count;
+}
+
+/* Create the segment with SECURE permissions (0600 = owner only) */
+VitalsSegment *create_segment(uint32_t beds, int *shm_fd) {
+    // A segment left by a crashed run would keep its old seqlocks and samples
+    shm_unlink(SHM_NAME);
+    *shm_fd = shm_open(SHM_NAME, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (*shm_fd == -1) {
+        perror("shm_open failed");
+        return NULL;
+    }
+    if (ftruncate(*shm_fd, segment_size(beds)) == -1) {
+        perror("ftruncate failed");
+        close(*shm_fd);
+        shm_unlink(SHM_NAME);
+        return NULL;
+    }
+    VitalsSegment *segment = mmap(0, segment_size(beds), PROT_READ | PROT_WRITE,
+                                  MAP_SHARED, *shm_fd, 0);
+    if (segment == MAP_FAILED) {
+        perror("mmap failed");
+        close(*shm_fd);
+        shm_unlink(SHM_NAME);
+        return NULL;
+    }
+    // A fresh object is zero-filled by ftruncate, so every seqlock starts even and every slot empty
+    segment->beds = beds;
+    segment->history = VITALS_HISTORY;
+    segment->slot_size = sizeof(BedSlot);
+    segment->magic = SHM_MAGIC;
+    return segment;
+}
+
+/* Displays open the segment by name, read-only: they cannot disturb the device */
+const VitalsSegment *open_segment_readonly(void) {
+    int fd = shm_open(SHM_NAME, O_RDONLY, 0);
+    if (fd == -1) {
+        perror("Display shm_open failed");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat failed");
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(VitalsSegment)) {
+        fprintf(stderr, "Display: vitals segment too small\n");
+        close(fd);
+        return NULL;
+    }
+    const VitalsSegment *segment = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        perror("Display mmap failed");
+        return NULL;
+    }
+    if (segment->magic != SHM_MAGIC || segment->slot_size != sizeof(BedSlot) ||
+        segment_size(segment->beds) > (size_t)st.st_size) {
+        fprintf(stderr, "Display: incompatible vitals segment\n");
+        munmap((void *)segment, st.st_size);
+        return NULL;
+    }
+    return segment;
+}
+
+size_t waiter_board_size(uint32_t beds) {
+    return sizeof(WaiterBoard) + ((size_t)beds + 1) * sizeof(_Atomic uint32_t);
+}
+
+/* Device side: a fresh, zeroed board for beds (same owner-only permissions) */
+WaiterBoard *create_waiter_board(uint32_t beds) {
+    shm_unlink(WAITERS_NAME);
+    int fd = shm_open(WAITERS_NAME, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) {
+        perror("Waiter board shm_open failed");
+        return NULL;
+    }
+    if (ftruncate(fd, waiter_board_size(beds)) == -1) {
+        perror("ftruncate failed");
+        close(fd);
+        shm_unlink(WAITERS_NAME);
+        return NULL;
+    }
+    WaiterBoard *board = mmap(0, waiter_board_size(beds), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (board == MAP_FAILED) {
+        perror("mmap failed");
+        shm_unlink(WAITERS_NAME);
+        return NULL;
+    }
+    board->beds = beds;
+    return board;
+}
+
+/* Sleeping displays map the board read-write to count themselves in and out */
+WaiterBoard *open_waiter_board(uint32_t beds) {
+    int fd = shm_open(WAITERS_NAME, O_RDWR, 0);
+    if (fd == -1) {
+        perror("Display waiter board shm_open failed");
+        return NULL;
+    }
+    WaiterBoard *board = mmap(0, waiter_board_size(beds), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (board == MAP_FAILED) {
+        perror("Display waiter board mmap failed");
+        return NULL;
+    }
+    if (board->beds != beds) {
+        fprintf(stderr, "Display: waiter board is for %u beds, segment has %u\n", board->beds, beds);
+        munmap(board, waiter_board_size(beds));
+        return NULL;
+    }
+    return board;
+}
+
+/*
+ * seqlock_wait, counted in *sleepers. The increment is a full barrier
+ * before the kernel compares the counter, and the device fences between
+ * publishing and reading the count, so either the device sees a sleeper
+ * or the sleeper sees the new counter and does not sleep.
+ */
+int watch_wait(_Atomic uint32_t *sleepers, const Seqlock *lock, uint32_t seq, const struct timespec *timeout) {
+    atomic_fetch_add(sleepers, 1);
+    int woke = seqlock_wait(lock, seq, timeout);
+    atomic_fetch_sub(sleepers, 1);
+    return woke;
+}
+
+/* Device side: wake whoever sleeps on lock; no syscall when nobody does */
+void notify_lock(Notifier *n, Seqlock *lock, _Atomic uint32_t *sleepers) {
+    atomic_thread_fence(memory_order_seq_cst);   // publish before reading the count
+    if (atomic_load_explicit(sleepers, memory_order_relaxed) == 0) {
+        n->skipped++;
+        return;
+    }
+    n->woken += seqlock_wake(lock);
+    n->wake_calls++;
+}
+
+/* Nurse-station display process: sweep every bed until the device stops */
+void run_display(int id, volatile int *running, DisplayStats *stats) {
+    const VitalsSegment *segment = open_segment_readonly();
+    if (segment == NULL) exit(1);
+
+    VitalsData v;
+    uint32_t bed = (uint32_t)id * 7919;
+    while (*running) {
+        for (int i = 0; i < 1024; i++) {
+            bed = (bed + 1) % segment->beds;
+            stats->retries += read_vitals(&segment->slots[bed], &v, NULL);
+            stats->reads++;
+            if (v.sample != 0 && v.checksum != vitals_checksum(&v)) stats->torn++;
+        }
+    }
+    exit(0);
+}
+
+/* Bedside monitor process: sleep on one bed's counter, redraw on each change */
+void run_bedside_monitor(uint32_t bed, volatile int *running, WatcherStats *stats) {
+    const VitalsSegment *segment = open_segment_readonly();
+    if (segment == NULL) exit(1);
+    WaiterBoard *board = open_waiter_board(segment->beds);
+    if (board == NULL) exit(1);
+    bed %= segment->beds;
+    const BedSlot *slot = &segment->slots[bed];
+    struct timespec timeout = {0, WATCH_TIMEOUT_NS};
+
+    VitalsData v;
+    uint32_t seq, last_sample = 0;
+    while (*running) {
+        read_vitals(slot, &v, &seq);
+        if (v.sample != last_sample) {
+            lh_record(&stats->staleness_us, (now_ns() - v.timestamp_ns) / 1000);
+            stats->changes++;
+            last_sample = v.sample;
+        }
+        if (watch_wait(&board->sleepers[bed], &slot->lock, seq, &timeout) == 0) stats->wakeups++;
+    }
+    exit(0);
+}
+
+/* Nurse station process: sleep on the ward counter, then redraw only the beds that changed */
+void run_ward_station(volatile int *running, WatcherStats *stats) {
+    const VitalsSegment *segment = open_segment_readonly();
+    if (segment == NULL) exit(1);
+    WaiterBoard *board = open_waiter_board(segment->beds);
+    uint32_t *last_sample = calloc(segment->beds, sizeof(*last_sample));
+    if (board == NULL || last_sample == NULL) exit(1);
+    struct timespec timeout = {0, WATCH_TIMEOUT_NS};
+
+    VitalsData v;
+    while (*running) {
+        uint32_t ward = seqlock_read_begin(&segment->ward);
+        for (uint32_t bed = 0; bed < segment->beds; bed++) {
+            read_vitals(&segment->slots[bed], &v, NULL);
+            if (v.sample == last_sample[bed]) continue;
+            if (bed == 0) lh_record(&stats->staleness_us, (now_ns() - v.timestamp_ns) / 1000);
+            stats->changes++;
+            last_sample[bed] = v.sample;
+        }
+        if (watch_wait(&board->sleepers[segment->beds], &segment->ward, ward, &timeout) == 0) stats->wakeups++;
+    }
+    free(last_sample);
+    exit(0);
+}
+
+int notifier_init(Notifier *n, uint32_t beds, int notify_hz) {
+    memset(n, 0, sizeof(*n));
+    n->interval_ns = notify_hz > 0 ? 1000000000ull / notify_hz : 0;
+    n->last_wake = calloc(beds, sizeof(*n->last_wake));
+    n->pending = calloc(beds, sizeof(*n->pending));
+    return n->last_wake != NULL && n->pending != NULL ? 0 : -1;
+}
+
+void notifier_free(Notifier *n) {
+    free(n->last_wake);
+    free(n->pending);
+}
+
+/* After publishing to bed: wake its displays unless that happened within the interval */
+void notify_bed(Notifier *n, VitalsSegment *segment, WaiterBoard *board, uint32_t bed, uint64_t now) {
+    n->pending[bed] = 1;
+    n->ward_pending = 1;
+    if (n->interval_ns > 0 && now - n->last_wake[bed] < n->interval_ns) return;
+    notify_lock(n, &segment->slots[bed].lock, &board->sleepers[bed]);
+    n->last_wake[bed] = now;
+    n->pending[bed] = 0;
+}
+
+/* Once per device round: tick the ward counter (coalesced the same way) */
+void notify_ward(Notifier *n, VitalsSegment *segment, WaiterBoard *board, uint64_t now, int force) {
+    if (!n->ward_pending) return;
+    if (!force && n->interval_ns > 0 && now - n->ward_last_wake < n->interval_ns) return;
+    seqlock_write_begin(&segment->ward);
+    seqlock_write_end(&segment->ward);
+    notify_lock(n, &segment->ward, &board->sleepers[segment->beds]);
+    n->ward_last_wake = now;
+    n->ward_pending = 0;
+}
+
+/* Device shutdown: deliver every change still held back by coalescing */
+void notify_flush(Notifier *n, VitalsSegment *segment, WaiterBoard *board) {
+    for (uint32_t bed = 0; bed < segment->beds; bed++) {
+        if (!n->pending[bed]) continue;
+        notify_lock(n, &segment->slots[bed].lock, &board->sleepers[bed]);
+        n->pending[bed] = 0;
+    }
+    notify_ward(n, segment, board, now_ns(), 1);
+}
+
+/* Monitoring device: hz samples per second to every bed for the given time */
+void run_device(VitalsSegment *segment, WaiterBoard *board, int hz, double seconds, Notifier *notifier,
+                LatencyHistogram *publish_ns, long *published) {
+    uint64_t period = 1000000000ull / hz, start = now_ns(), next = start;
+    uint32_t sample = 1;
+    while (now_ns() - start < (uint64_t)(seconds * 1e9)) {
+        for (uint32_t bed = 0; bed < segment->beds; bed++) {
+            VitalsData v;
+            simulate_vitals(bed, sample, &v);
+            uint64_t t0 = now_ns();
+            v.timestamp_ns = t0;
+            publish_vitals(&segment->slots[bed], &v);
+            lh_record(publish_ns, now_ns() - t0);
+            notify_bed(notifier, segment, board, bed, t0);
+            (*published)++;
+        }
+        notify_ward(notifier, segment, board, now_ns(), 0);
+        sample++;
+        next += period;
+        uint64_t now = now_ns();
+        if (next > now) {
+            struct timespec pause = {0, (long)(next - now)};
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
     int shm_fd;
-    VitalsData *vitals;
-    
+    uint32_t beds = 1000;
+    int displays = 4, hz = 100, watchers = 8, notify_hz = 20;
+    double seconds = 2;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--beds") == 0 && i + 1 < argc) beds = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--displays") == 0 && i + 1 < argc) displays = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) hz = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--watchers") == 0 && i + 1 < argc) watchers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--notify-hz") == 0 && i + 1 < argc) notify_hz = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--beds N] [--displays D] [--rate HZ] [--seconds S]"
+                    " [--watchers W] [--notify-hz N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (beds < 1 || hz < 1 || displays < 0 || displays > MAX_DISPLAYS || seconds <= 0 ||
+        watchers < 0 || watchers > MAX_WATCHERS || notify_hz < 0) {
+        fprintf(stderr, "Need beds >= 1, rate >= 1, 0..%d displays, 0..%d watchers, notify-hz >= 0"
+                " and seconds > 0\n", MAX_DISPLAYS, MAX_WATCHERS);
+        return 1;
+    }
+
     printf("========================================\n");
     printf("   POSIX SHARED MEMORY DEMONSTRATION\n");
     printf("========================================\n");
     printf("Scenario: Real-time vitals monitoring\n");
     printf("Security: CRITICAL - Owner-only (0600)\n\n");
-    
-    // Create shared memory with SECURE permissions (0600 = owner only)
-    shm_fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0600);
-    if (shm_fd == -1) {
-        perror("shm_open failed");
-        return 1;
-    }
-    
-    // Set size
-    if (ftruncate(shm_fd, sizeof(VitalsData)) == -1) {
-        perror("ftruncate failed");
+
+    VitalsSegment *segment = create_segment(beds, &shm_fd);
+    if (segment == NULL) return 1;
+    WaiterBoard *board = create_waiter_board(beds);
+    if (board == NULL) return 1;
+    printf("[Monitoring Device] Segment: %u beds x %zu-byte slots, %d-sample history each (%.1f MB)\n\n",
+           beds, sizeof(BedSlot), VITALS_HISTORY, segment_size(beds) / (1024.0 * 1024.0));
+
+    // Monitoring device writes vitals for bed 0
+    printf("[Monitoring Device] Writing patient vitals to shared memory (bed 0)...\n");
+    VitalsData vitals = {0};
+    vitals.sample = 1;
+    vitals.timestamp_ns = now_ns();
+    vitals.heart_rate = 145;
+    vitals.blood_pressure_systolic = 150;
+    vitals.blood_pressure_diastolic = 95;
+    vitals.oxygen_saturation = 92;
+    strcpy(vitals.status, "CRITICAL - Hypertensive Emergency");
+    publish_vitals(&segment->slots[0], &vitals);
+    printf("[Monitoring Device] ✓ Vitals updated\n\n");
+
+    // Multiple displays read the same slot; each takes a consistent snapshot
+    VitalsData seen;
+    read_vitals(&segment->slots[0], &seen, NULL);
+    printf("[Bedside Monitor] Reading vitals from shared memory:\n");
+    printf("  Heart Rate: %d bpm\n", seen.heart_rate);
+    printf("  Blood Pressure: %d/%d mmHg\n",
+           seen.blood_pressure_systolic, seen.blood_pressure_diastolic);
+    printf("  O2 Saturation: %d%%\n", seen.oxygen_saturation);
+    printf("  Status: %s\n\n", seen.status);
+
+    read_vitals(&segment->slots[0], &seen, NULL);
+    printf("[Nurse Station] Reading same data (zero latency):\n");
+    printf("  Patient Status: %s ⚠️\n", seen.status);
+    printf("  Vitals: HR=%d BP=%d/%d O2=%d%%\n\n",
+           seen.heart_rate,
+           seen.blood_pressure_systolic,
+           seen.blood_pressure_diastolic,
+           seen.oxygen_saturation);
+
+    // Stress: the device publishes every bed at hz while displays sweep all beds
+    // and watchers (one ward station + bedside monitors) sleep until woken
+    printf("[Monitoring Device] Publishing %u beds at %d Hz for %.1fs to %d polling display(s),\n",
+           beds, hz, seconds, displays);
+    if (notify_hz > 0)
+        printf("[Monitoring Device] 1 ward station and %d bedside monitor(s) woken at most %d Hz per bed...\n",
+               watchers, notify_hz);
+    else
+        printf("[Monitoring Device] 1 ward station and %d bedside monitor(s) woken on every publish...\n",
+               watchers);
+    DisplayStats *stats = mmap(0, MAX_DISPLAYS * sizeof(DisplayStats) + sizeof(int),
+                               PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (stats == MAP_FAILED) {
+        perror("mmap failed");
         return 1;
     }
-    
-    // Map to memory
-    vitals = (VitalsData *)mmap(0, sizeof(VitalsData), 
-                                PROT_READ | PROT_WRITE, 
-                                MAP_SHARED, shm_fd, 0);
-    if (vitals == MAP_FAILED) {
+    volatile int *running = (volatile int *)(stats + MAX_DISPLAYS);
+    *running = 1;
+    size_t watch_size = (watchers + 1) * sizeof(WatcherStats);
+    WatcherStats *watch = mmap(0, watch_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (watch == MAP_FAILED) {
         perror("mmap failed");
         return 1;
     }
-    
-    // Monitoring device writes vitals
-    printf("[Monitoring Device] Writing patient vitals to shared memory...\n");
-    vitals->heart_rate = 145;
-    vitals->blood_pressure_systolic = 150;
-    vitals->blood_pressure_diastolic = 95;
-    vitals->oxygen_saturation = 92;
-    strcpy(vitals->status, "CRITICAL - Hypertensive Emergency");
-    printf("[Monitoring Device] ✓ Vitals updated\n\n");
-    
-    // Multiple displays read simultaneously (no copying!)
-    printf("[Bedside Monitor] Reading vitals from shared memory:\n");
-    printf("  Heart Rate: %d bpm\n", vitals->heart_rate);
-    printf("  Blood Pressure: %d/%d mmHg\n", 
-           vitals->blood_pressure_systolic, vitals->blood_pressure_diastolic);
-    printf("  O2 Saturation: %d%%\n", vitals->oxygen_saturation);
-    printf("  Status: %s\n\n", vitals->status);
-    
-    printf("[Nurse Station] Reading same data (zero latency):\n");
-    printf("  Patient Status: %s ⚠️\n", vitals->status);
-    printf("  Vitals: HR=%d BP=%d/%d O2=%d%%\n\n", 
-           vitals->heart_rate, 
-           vitals->blood_pressure_systolic,
-           vitals->blood_pressure_diastolic,
-           vitals->oxygen_saturation);
-    
+    for (int w = 0; w <= watchers; w++) lh_init(&watch[w].staleness_us);
+
+    pid_t pids[MAX_DISPLAYS], watch_pids[MAX_WATCHERS + 1];
+    fflush(stdout);  // or the children repeat everything buffered so far
+    for (int d = 0; d < displays; d++) {
+        pids[d] = fork();
+        if (pids[d] == 0) run_display(d, running, &stats[d]);
+        if (pids[d] < 0) {
+            perror("fork failed");
+            return 1;
+        }
+    }
+    for (int w = 0; w <= watchers; w++) {
+        watch_pids[w] = fork();
+        if (watch_pids[w] == 0) {
+            if (w == 0) run_ward_station(running, &watch[0]);
+            run_bedside_monitor((uint32_t)(w - 1), running, &watch[w]);
+        }
+        if (watch_pids[w] < 0) {
+            perror("fork failed");
+            return 1;
+        }
+    }
+
+    Notifier notifier;
+    LatencyHistogram *publish_ns = malloc(sizeof(LatencyHistogram));
+    long published = 0;
+    if (publish_ns == NULL || notifier_init(&notifier, beds, notify_hz) != 0) return 1;
+    lh_init(publish_ns);
+    run_device(segment, board, hz, seconds, &notifier, publish_ns, &published);
+    *running = 0;
+    notify_flush(&notifier, segment, board);
+
+    long reads = 0, retries = 0, torn = 0;
+    int failed = 0;
+    for (int d = 0; d < displays; d++) {
+        int status;
+        waitpid(pids[d], &status, 0);
+        failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        reads += stats[d].reads;
+        retries += stats[d].retries;
+        torn += stats[d].torn;
+    }
+    printf("[Monitoring Device] ✓ %ld samples published (%.0f/s), publish p50 %llu ns, p99 %llu ns, max %llu ns\n",
+           published, published / seconds, (unsigned long long)lh_percentile(publish_ns, 50),
+           (unsigned long long)lh_percentile(publish_ns, 99), (unsigned long long)publish_ns->max);
+    if (displays > 0)
+        printf("[Nurse Stations] ✓ %ld lock-free reads (%.0f/s), %ld retried (%.3f%%), %ld torn, %d failed\n",
+               reads, reads / seconds, retries, reads ? 100.0 * retries / reads : 0, torn, failed);
+
+    // Watchers: wake-ups, redraws and CPU actually used while "idle"
+    LatencyHistogram *staleness = malloc(sizeof(LatencyHistogram));
+    if (staleness == NULL) return 1;
+    lh_init(staleness);
+    long wakeups = 0, changes = 0;
+    double cpu_ms = 0;
+    for (int w = 0; w <= watchers; w++) {
+        int status;
+        wait4(watch_pids[w], &status, 0, &watch[w].usage);
+        failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        double ms = watch[w].usage.ru_utime.tv_sec * 1e3 + watch[w].usage.ru_utime.tv_usec / 1e3 +
+                    watch[w].usage.ru_stime.tv_sec * 1e3 + watch[w].usage.ru_stime.tv_usec / 1e3;
+        if (w == 0) {
+            printf("[Ward Station] ✓ %ld wake-ups (%.0f/s), %ld bed redraws, %.1f ms CPU\n",
+                   watch[0].wakeups, watch[0].wakeups / seconds, watch[0].changes, ms);
+            continue;
+        }
+        wakeups += watch[w].wakeups;
+        changes += watch[w].changes;
+        cpu_ms += ms;
+        lh_merge(staleness, &watch[w].staleness_us);
+    }
+    if (watchers > 0)
+        printf("[Bedside Monitors] ✓ %.0f wake-ups/s and %.0f redraws/s each, %.2f ms CPU each,"
+               " staleness p50 %llu us, p99 %llu us\n",
+               wakeups / seconds / watchers, changes / seconds / watchers, cpu_ms / watchers,
+               (unsigned long long)lh_percentile(staleness, 50),
+               (unsigned long long)lh_percentile(staleness, 99));
+    printf("[Monitoring Device] ✓ %ld futex wake calls (%.0f/s) woke %ld display(s);"
+           " %ld wake-ups skipped, nobody asleep\n\n",
+           notifier.wake_calls, notifier.wake_calls / seconds, notifier.woken, notifier.skipped);
+
+    // Trend for bed 1 (bed 0 on a one-bed ward) from its history ring
+    uint32_t trend_bed = beds > 1 ? 1 : 0;
+    VitalsData trend[5];
+    int count = read_history(&segment->slots[trend_bed], trend, 5);
+    printf("[Nurse Station] Bed %u trend (last %d of %u samples):\n", trend_bed, count,
+           segment->slots[trend_bed].published);
+    for (int i = 0; i < count; i++)
+        printf("  #%-5u HR=%d BP=%d/%d O2=%d%%\n", trend[i].sample, trend[i].heart_rate,
+               trend[i].blood_pressure_systolic, trend[i].blood_pressure_diastolic,
+               trend[i].oxygen_saturation);
+    printf("\n");
+
     printf("========================================\n");
     printf("⚠️  SECURITY WARNING - CRITICAL:\n");
     printf("========================================\n");
@@ -90,12 +663,21 @@ int main() {
     printf("✓ ONLY non-identifiable vitals (HIPAA compliant)\n");
     printf("✓ MANDATORY 0600 permissions (owner-only)\n");
     printf("✓ Microsecond latency for life-critical monitoring\n");
+    printf("✓ Per-bed seqlock slots: readers never block the device, never see torn vitals\n");
+    printf("✓ Futex wake-ups on change, coalesced: idle displays sleep instead of polling\n");
     printf("========================================\n");
-    
+
     // Cleanup
-    munmap(vitals, sizeof(VitalsData));
+    notifier_free(&notifier);
+    free(staleness);
+    free(publish_ns);
+    munmap(watch, watch_size);
+    munmap(stats, MAX_DISPLAYS * sizeof(DisplayStats) + sizeof(int));
+    munmap(board, waiter_board_size(beds));
+    shm_unlink(WAITERS_NAME);
+    munmap(segment, segment_size(beds));
     close(shm_fd);
     shm_unlink(SHM_NAME);
-    
-    return 0;
+
+    return torn == 0 && failed == 0 ? 0 : 1;
 }
\ No newline at end of file
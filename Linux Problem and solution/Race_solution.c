@@ -1,111 +1,230 @@
 /*
- * HPMS Race Condition SOLUTION with Mutex
+ * HPMS Race Condition SOLUTION with Versioned Records
  *
  * Scenario:
- * 1. Same as race_condition_demo.c BUT with mutex protection
- * 2. Doctor must acquire lock before reading patient data
- * 3. Nurse must acquire lock before updating patient data
- * 4. Mutex ensures operations are serialized (no concurrent access)
- * 5. Race condition is PREVENTED - data consistency maintained
+ * 1. Same as race_condition_demo.c BUT every record carries a version
+ * 2. Doctor reads the record and its version, then decides with NO lock
+ *    held (the 100ms of thinking no longer blocks anyone)
+ * 3. Nurse updates the allergy immediately - nothing to wait for
+ * 4. Doctor's prescription is a compare-and-commit: it is written only if
+ *    the version is unchanged, otherwise the doctor re-reads and decides
+ *    again on the new data
+ * 5. Race condition is PREVENTED - a stale-allergy decision never commits
  *
- * This demonstrates how mutex synchronization prevents TOCTOU bugs.
+ * Records live in HPMS/Patient_Store.h, locked per patient (each record
+ * has its own seqlock), so doctors working on different patients never
+ * contend. The second part runs a ward of doctors and nurses against one
+ * global mutex (the old fix) and against per-record commits; the global
+ * mutex is an HPMS/Lock_Monitor.h monitored mutex, so the run ends with
+ * its wait and hold times.
  *
- * Compile: gcc -pthread mutex_solution.c -o mutex_solution
- * Run:     ./mutex_solution
+ * Compile: gcc -O2 -pthread Race_solution.c -o Race_solution
+ * Run:     ./Race_solution
  */
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
 #include <unistd.h>
 
-/* Shared patient record */
-typedef struct {
-    int patient_id;
-    char allergy_info[100];
-    char prescription[100];
-} PatientRecord;
+#include "../HPMS/Lock_Monitor.h"
+#include "../HPMS/Patient_Store.h"
 
-/* Global shared object WITH MUTEX PROTECTION */
-PatientRecord patient;
-pthread_mutex_t patient_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define DEMO_PATIENT 1234
+#define WARD_DOCTORS 8
+#define WARD_NURSES 2
+#define PATIENTS_PER_DOCTOR 4
+#define PRESCRIPTIONS_PER_DOCTOR 25
+#define WARD_THINK_US 2000      // doctor's decision time per prescription
+#define NURSE_INTERVAL_US 1000  // a nurse updates some allergy every 1ms
 
-/* Doctor thread WITH MUTEX */
+/* Shared patient records with per-record versions */
+PatientStore store;
+
+/* Old fix, for comparison: one lock around every clinician's whole sequence (monitored) */
+MonitoredMutex patient_mutex;
+int use_global_mutex;
+
+_Atomic int doctors_done;
+_Atomic long stale_retries;
+_Atomic long unsafe_prescriptions;
+_Atomic long nurse_updates;
+_Atomic long nurse_max_wait_us;
+
+static long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static const char *choose_prescription(const char *allergy) {
+    return strcmp(allergy, "None") == 0 ? "Penicillin 500mg" : "Alternative antibiotic";
+}
+
+/* Commit callback: record is the current data, at the version the doctor read */
+static void write_prescription(PatientData *record, void *arg) {
+    const char *prescription = arg;
+    if (strcmp(prescription, "Penicillin 500mg") == 0 && strcmp(record->allergy_info, "None") != 0)
+        atomic_fetch_add(&unsafe_prescriptions, 1);  // would be the TOCTOU bug
+    snprintf(record->prescription, sizeof(record->prescription), "%s", prescription);
+}
+
+static void write_allergy(PatientData *record, void *arg) {
+    snprintf(record->allergy_info, sizeof(record->allergy_info), "%s", (const char *)arg);
+}
+
+/* Doctor thread WITH VERSIONED COMMIT */
 void* doctor_thread(void* arg) {
-    char local_allergy[100];
-
-    printf("[Doctor] Attempting to read patient allergy information...\n");
-    
-    /* ACQUIRE MUTEX before accessing shared data */
-    pthread_mutex_lock(&patient_mutex);
-    printf("[Doctor] ✓ Mutex ACQUIRED - Safe to read\n");
-
-    /* TIME OF CHECK (now protected) */
-    strcpy(local_allergy, patient.allergy_info);
-    printf("[Doctor] Allergy recorded as: '%s'\n", local_allergy);
-
-    /* Simulate time taken to reason / decide */
-    printf("[Doctor] Analyzing patient condition...\n");
-    usleep(100000);  // 100 ms
-
-    /* TIME OF USE (still holding lock - data cannot change) */
-    if (strcmp(local_allergy, "None") == 0) {
-        strcpy(patient.prescription, "Penicillin 500mg");
-        printf("[Doctor] Prescribing Penicillin (safe - no allergies)\n");
-    } else {
-        strcpy(patient.prescription, "Alternative antibiotic");
-        printf("[Doctor] Prescribing alternative due to allergy: %s\n", local_allergy);
-    }
-    
-    /* RELEASE MUTEX after completing operation */
-    pthread_mutex_unlock(&patient_mutex);
-    printf("[Doctor] ✓ Mutex RELEASED\n");
+    PatientData snapshot;
+    uint32_t version;
+    int attempt = 1;
+
+    (void)arg;
+    printf("[Doctor] Reading patient allergy information (no lock taken)...\n");
+
+    for (;;) {
+        /* TIME OF CHECK: snapshot plus the version it was taken at */
+        ps_read(&store, DEMO_PATIENT, &snapshot, &version);
+        printf("[Doctor] Attempt %d: allergy recorded as '%s' (version %u)\n",
+               attempt, snapshot.allergy_info, version);
+
+        /* Simulate time taken to reason / decide - nobody is blocked meanwhile */
+        printf("[Doctor] Analyzing patient condition...\n");
+        usleep(100000);  // 100 ms
 
+        /* TIME OF USE: commit only if the record is still at that version */
+        const char *prescription = choose_prescription(snapshot.allergy_info);
+        if (ps_commit(&store, DEMO_PATIENT, version, write_prescription, (void *)prescription) == 1) {
+            printf("[Doctor] ✓ Committed '%s' at version %u\n", prescription, version);
+            break;
+        }
+        printf("[Doctor] ✗ Commit REJECTED: record changed while deciding - re-reading\n");
+        attempt++;
+    }
     return NULL;
 }
 
-/* Nurse thread WITH MUTEX */
+/* Nurse thread - never waits for the doctor */
 void* nurse_thread(void* arg) {
-    /* Ensure doctor attempts to read first */
+    (void)arg;
+    /* Ensure doctor reads first */
     usleep(50000);  // 50 ms
 
-    printf("\n[Nurse] Patient reports allergy, need to update system...\n");
-    printf("[Nurse] Attempting to acquire mutex...\n");
-    
-    /* TRY TO ACQUIRE MUTEX - will wait if doctor holds it */
-    pthread_mutex_lock(&patient_mutex);
-    printf("[Nurse] ✓ Mutex ACQUIRED - Safe to write\n");
-    
-    printf("[Nurse] Updating allergy information...\n");
-    strcpy(patient.allergy_info, "Penicillin Allergy");
-    printf("[Nurse] Allergy updated to: 'Penicillin Allergy'\n");
-    
-    /* RELEASE MUTEX */
-    pthread_mutex_unlock(&patient_mutex);
-    printf("[Nurse] ✓ Mutex RELEASED\n");
+    printf("\n[Nurse] Patient reports allergy, updating system...\n");
+    long start = now_us();
+    ps_update(&store, DEMO_PATIENT, write_allergy, "Penicillin Allergy");
+    printf("[Nurse] ✓ Allergy updated to 'Penicillin Allergy' after %ld µs (no waiting)\n\n",
+           now_us() - start);
+    return NULL;
+}
+
+/* Ward doctor: prescribes for its own patients, read-decide-commit each time */
+void* ward_doctor(void* arg) {
+    int doctor = (int)(long)arg;
+    PatientData snapshot;
+    uint32_t version;
 
+    for (int r = 0; r < PRESCRIPTIONS_PER_DOCTOR; r++) {
+        uint32_t patient_id = 2000 + doctor * PATIENTS_PER_DOCTOR + r % PATIENTS_PER_DOCTOR;
+        if (use_global_mutex) {
+            lm_lock(&patient_mutex);
+            ps_read(&store, patient_id, &snapshot, &version);
+            usleep(WARD_THINK_US);
+            ps_update(&store, patient_id, write_prescription,
+                      (void *)choose_prescription(snapshot.allergy_info));
+            lm_unlock(&patient_mutex);
+            continue;
+        }
+        for (;;) {
+            ps_read(&store, patient_id, &snapshot, &version);
+            usleep(WARD_THINK_US);
+            if (ps_commit(&store, patient_id, version, write_prescription,
+                          (void *)choose_prescription(snapshot.allergy_info)) == 1)
+                break;
+            atomic_fetch_add(&stale_retries, 1);
+        }
+    }
+    atomic_fetch_add(&doctors_done, 1);
+    return NULL;
+}
+
+/* Ward nurse: keeps flipping allergies of random ward patients */
+void* ward_nurse(void* arg) {
+    unsigned seed = (unsigned)(long)arg * 7919 + 1;
+    int flip = 0;
+
+    while (atomic_load(&doctors_done) < WARD_DOCTORS) {
+        uint32_t patient_id = 2000 + rand_r(&seed) % (WARD_DOCTORS * PATIENTS_PER_DOCTOR);
+        const char *allergy = (flip++ & 1) ? "None" : "Penicillin Allergy";
+        long start = now_us();
+        if (use_global_mutex) lm_lock(&patient_mutex);
+        ps_update(&store, patient_id, write_allergy, (void *)allergy);
+        if (use_global_mutex) lm_unlock(&patient_mutex);
+        long waited = now_us() - start;
+        long max = atomic_load(&nurse_max_wait_us);
+        while (waited > max && !atomic_compare_exchange_weak(&nurse_max_wait_us, &max, waited)) {}
+        atomic_fetch_add(&nurse_updates, 1);
+        usleep(NURSE_INTERVAL_US);
+    }
     return NULL;
 }
 
+/* Run the ward once; returns wall-clock milliseconds */
+double run_ward(int global_mutex) {
+    pthread_t doctors[WARD_DOCTORS], nurses[WARD_NURSES];
+
+    use_global_mutex = global_mutex;
+    atomic_store(&doctors_done, 0);
+    atomic_store(&stale_retries, 0);
+    atomic_store(&unsafe_prescriptions, 0);
+    atomic_store(&nurse_updates, 0);
+    atomic_store(&nurse_max_wait_us, 0);
+
+    long start = now_us();
+    for (long n = 0; n < WARD_NURSES; n++) pthread_create(&nurses[n], NULL, ward_nurse, (void *)n);
+    for (long d = 0; d < WARD_DOCTORS; d++) pthread_create(&doctors[d], NULL, ward_doctor, (void *)d);
+    for (int d = 0; d < WARD_DOCTORS; d++) pthread_join(doctors[d], NULL);
+    double elapsed_ms = (now_us() - start) / 1000.0;
+    for (int n = 0; n < WARD_NURSES; n++) pthread_join(nurses[n], NULL);
+    return elapsed_ms;
+}
+
 int main() {
     pthread_t doctor, nurse;
 
     printf("========================================\n");
-    printf("   MUTEX SOLUTION DEMONSTRATION\n");
+    printf("   VERSIONED RECORD SOLUTION DEMONSTRATION\n");
     printf("========================================\n");
-    printf("✓ Mutex synchronization ENABLED\n");
+    printf("✓ Per-patient record locks (seqlock per record)\n");
+    printf("✓ Optimistic reads - no lock held while deciding\n");
+    printf("✓ Compare-and-commit prescriptions\n");
     printf("✓ Race condition PREVENTED\n");
     printf("========================================\n\n");
 
+    lm_mutex_init(&patient_mutex, "Global patient mutex");
+    if (ps_init(&store, 1024) != 0) {
+        perror("ps_init");
+        return 1;
+    }
+
     /* Initial state */
-    patient.patient_id = 1234;
-    strcpy(patient.allergy_info, "None");
-    strcpy(patient.prescription, "Not prescribed");
+    PatientData initial = {0};
+    initial.patient_id = DEMO_PATIENT;
+    strcpy(initial.allergy_info, "None");
+    strcpy(initial.prescription, "Not prescribed");
+    ps_insert(&store, &initial);
+    for (uint32_t id = 2000; id < 2000 + WARD_DOCTORS * PATIENTS_PER_DOCTOR; id++) {
+        initial.patient_id = id;
+        ps_insert(&store, &initial);
+    }
 
     printf("Initial Patient Record:\n");
-    printf("  ID: %d\n", patient.patient_id);
-    printf("  Allergy: %s\n", patient.allergy_info);
-    printf("  Prescription: %s\n\n", patient.prescription);
+    printf("  ID: %d\n", DEMO_PATIENT);
+    printf("  Allergy: %s\n", initial.allergy_info);
+    printf("  Prescription: %s\n\n", initial.prescription);
 
     printf("========================================\n");
     printf("Starting Doctor and Nurse threads...\n");
@@ -118,24 +237,46 @@ int main() {
     pthread_join(doctor, NULL);
     pthread_join(nurse, NULL);
 
+    PatientData final;
+    ps_lookup(&store, DEMO_PATIENT, &final);
+    printf("\nFinal Patient Record:\n");
+    printf("  Allergy: %s\n", final.allergy_info);
+    printf("  Prescription: %s\n", final.prescription);
+
     printf("\n========================================\n");
-    printf("HOW MUTEX PREVENTED RACE CONDITION:\n");
+    printf("HOW VERSIONED COMMIT PREVENTED RACE CONDITION:\n");
     printf("========================================\n");
-    printf("1. Doctor acquired mutex FIRST\n");
-    printf("2. Doctor read allergy: 'None'\n");
-    printf("3. Nurse tried to acquire mutex → BLOCKED (waiting)\n");
-    printf("4. Doctor made decision & prescribed based on 'None'\n");
-    printf("5. Doctor released mutex\n");
-    printf("6. Nurse acquired mutex (now available)\n");
-    printf("7. Nurse updated allergy to 'Penicillin Allergy'\n");
-    printf("8. Nurse released mutex\n");
-    printf("\nResult: Operations SERIALIZED (one after another)\n");
-    printf("        Doctor's decision used CONSISTENT data\n");
+    printf("1. Doctor read allergy 'None' and its version - no lock held\n");
+    printf("2. Nurse updated allergy at once (version moved on)\n");
+    printf("3. Doctor's commit for Penicillin found a newer version → REJECTED\n");
+    printf("4. Doctor re-read: 'Penicillin Allergy'\n");
+    printf("5. Doctor prescribed alternative and committed\n");
+    printf("\nResult: Nobody waited on the doctor's thinking time\n");
+    printf("        Doctor's committed decision used CURRENT data\n");
     printf("        No TOCTOU bug possible!\n");
+    printf("========================================\n\n");
+
+    printf("========================================\n");
+    printf("WARD: %d doctors x %d prescriptions, %d nurses updating allergies\n",
+           WARD_DOCTORS, PRESCRIPTIONS_PER_DOCTOR, WARD_NURSES);
+    printf("========================================\n");
+    printf("%-20s %10s %12s %14s %8s\n", "Locking", "Wall (ms)", "Stale/retry", "Nurse max wait", "Unsafe");
+    for (int global = 1; global >= 0; global--) {
+        double ms = run_ward(global);
+        printf("%-20s %10.1f %12ld %12.1fms %8ld\n",
+               global ? "One global mutex" : "Per-record commit", ms, atomic_load(&stale_retries),
+               atomic_load(&nurse_max_wait_us) / 1000.0, atomic_load(&unsafe_prescriptions));
+    }
+    printf("\nLock monitor (where the global-mutex run lost its time):\n");
+    lm_report();
+    printf("\nGlobal mutex: every decision serialized, nurses wait out a doctor's thinking\n");
+    printf("Per-record:   doctors on different patients run in parallel; a nurse's\n");
+    printf("              change only costs the affected doctor one re-read\n");
     printf("========================================\n");
 
     /* Cleanup */
-    pthread_mutex_destroy(&patient_mutex);
+    ps_free(&store);
+    lm_mutex_destroy(&patient_mutex);
 
     return 0;
 }
\ No newline at end of file
@@ -2,162 +2,371 @@
  * HPMS Resource Exhaustion SOLUTION
  *
  * Scenario:
- * 1. Same as resource_exhaustion_demo.c BUT with proper cleanup
- * 2. Parent process calls waitpid() to reap terminated children
- * 3. No zombie processes accumulate
- * 4. System resources remain available
- * 5. New emergency patients can always be registered
+ * 1. Same patients as resource_exhaustion_demo.c BUT no fork() per patient
+ * 2. A fixed pool of registration workers is forked once at startup
+ * 3. Registrations reach the workers over socketpairs (one per worker)
+ * 4. One worker is reserved for CRITICAL patients, so an emergency
+ *    registration never waits behind a routine backlog
+ * 5. Admission control: the routine backlog is capped, so a flood of
+ *    arrivals is turned away early instead of exhausting the system
+ * 6. Parent reaps the workers once at shutdown - no zombies, and the
+ *    process table holds the same few entries however many patients come
  *
- * This demonstrates proper process management preventing resource exhaustion.
+ * The run also times fork()+waitpid() against one round trip to a pooled
+ * worker, and reports per-registration latency for each class.
  *
- * Compile: gcc proper_cleanup_solution.c -o proper_cleanup
- * Run:     ./proper_cleanup
+ * Compile: gcc -O2 Resource_solution.c -o Resource_solution
+ * Run:     ./Resource_solution
  * Monitor: Open another terminal: watch -n 1 'ps aux | grep defunct'
  *          (Should see NO zombies!)
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <poll.h>
+#include <time.h>
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
 #include <errno.h>
 #include <string.h>
 
-#define MAX_PATIENTS 100
-#define CRITICAL_PATIENT 101
+#include "../HPMS/Latency_Histogram.h"
 
-/* Simulate patient registration */
-void register_patient(int patient_id) {
-    /* REMOVED: Verbose output for clean screenshots */
-    sleep(1);
-    exit(0);  /* Child exits */
+#define MAX_PATIENTS 1000
+#define BURST_PATIENTS 400              // arrive all at once near the end
+#define CRITICAL_PATIENT (MAX_PATIENTS + BURST_PATIENTS + 1)
+#define CRITICAL_EVERY 50               // every 50th arrival is critical
+#define GENERAL_WORKERS 8
+#define RESERVED_WORKERS 1              // critical-only
+#define POOL_SIZE (GENERAL_WORKERS + RESERVED_WORKERS)
+#define ADMISSION_LIMIT 256             // routine patients allowed to wait
+#define ARRIVAL_US 1000                 // 1ms between arrivals
+#define REGISTRATION_WORK_US 5000       // 5ms of registration work
+#define OVERHEAD_SAMPLES 200
+
+enum { ROUTINE = 0, CRITICAL = 1 };
+
+typedef struct {
+    int patient_id;
+    int priority;
+    int work_us;
+    int64_t submitted_ns;
+} RegistrationRequest;
+
+typedef struct {
+    int patient_id;
+    int priority;
+    int pid;
+    int64_t submitted_ns;
+    int64_t started_ns;
+    int64_t finished_ns;
+} RegistrationReply;
+
+typedef struct {
+    pid_t pid;
+    int fd;                             // parent's end of the socketpair
+    int busy;
+    int reserved;
+    long served;
+} Worker;
+
+typedef struct {
+    RegistrationRequest items[MAX_PATIENTS + BURST_PATIENTS + 1];
+    int head, tail;
+} Backlog;
+
+static Worker workers[POOL_SIZE];
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* When patient arrives: steady arrivals, then the burst and the critical patient together */
+int64_t arrival_ns(int64_t start, int patient) {
+    if (patient > MAX_PATIENTS) patient = MAX_PATIENTS + 1;
+    return start + (int64_t)patient * ARRIVAL_US * 1000;
+}
+
+/* Worker process: register patients until the parent closes the socket */
+void registration_worker(int fd) {
+    RegistrationRequest req;
+    ssize_t n;
+
+    while ((n = recv(fd, &req, sizeof(req), 0)) == sizeof(req)) {
+        RegistrationReply reply = {req.patient_id, req.priority, getpid(), req.submitted_ns, now_ns(), 0};
+        if (req.work_us > 0) usleep(req.work_us);  /* Simulate registration work */
+        reply.finished_ns = now_ns();
+        if (send(fd, &reply, sizeof(reply), 0) != sizeof(reply)) break;
+    }
+    exit(0);
+}
+
+/* Fork the pool once; worker 0 is the reserved critical worker */
+int start_pool(void) {
+    for (int i = 0; i < POOL_SIZE; i++) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, sv) < 0) {
+            perror("socketpair");
+            return -1;
+        }
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) {
+            printf("ERROR: fork() failed - %s\n", strerror(errno));
+            return -1;
+        }
+        if (pid == 0) {
+            for (int j = 0; j < i; j++) close(workers[j].fd);
+            close(sv[0]);
+            registration_worker(sv[1]);
+        }
+        close(sv[1]);
+        workers[i] = (Worker){pid, sv[0], 0, i < RESERVED_WORKERS, 0};
+    }
+    return 0;
+}
+
+/* Close every socket (workers exit on EOF) and reap them; returns how many were reaped */
+int stop_pool(void) {
+    int reaped = 0;
+    for (int i = 0; i < POOL_SIZE; i++) close(workers[i].fd);
+    for (int i = 0; i < POOL_SIZE; i++)
+        if (waitpid(workers[i].pid, NULL, 0) == workers[i].pid) reaped++;
+    return reaped;
+}
+
+/* An idle worker allowed to take this priority, or -1 */
+int idle_worker(int priority) {
+    if (priority == CRITICAL)
+        for (int i = 0; i < POOL_SIZE; i++)
+            if (workers[i].reserved && !workers[i].busy) return i;
+    for (int i = 0; i < POOL_SIZE; i++)
+        if (!workers[i].reserved && !workers[i].busy) return i;
+    return -1;
+}
+
+/* Returns 0, or -1 if the worker cannot take it (it is then left busy, out of rotation) */
+int dispatch(int w, const RegistrationRequest *req) {
+    workers[w].busy = 1;
+    if (send(workers[w].fd, req, sizeof(*req), 0) != sizeof(*req)) {
+        perror("send");
+        return -1;
+    }
+    return 0;
+}
+
+/* Hand queued patients to idle workers, critical first; a failed send goes back to the queue */
+void drain_backlogs(Backlog *critical, Backlog *routine) {
+    int w;
+    while (critical->head < critical->tail && (w = idle_worker(CRITICAL)) >= 0)
+        if (dispatch(w, &critical->items[critical->head]) == 0) critical->head++;
+    while (routine->head < routine->tail && (w = idle_worker(ROUTINE)) >= 0)
+        if (dispatch(w, &routine->items[routine->head]) == 0) routine->head++;
+}
+
+/* Average microseconds to fork a child that does nothing and reap it */
+double measure_fork_cost(void) {
+    int64_t start = now_ns();
+    for (int i = 0; i < OVERHEAD_SAMPLES; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return -1;
+        }
+        if (pid == 0) _exit(0);
+        waitpid(pid, NULL, 0);
+    }
+    return (now_ns() - start) / 1000.0 / OVERHEAD_SAMPLES;
+}
+
+/* Average microseconds for one zero-work registration round trip to a pooled worker */
+double measure_pool_cost(void) {
+    int w = idle_worker(ROUTINE);
+    RegistrationRequest req = {0, ROUTINE, 0, 0};
+    RegistrationReply reply;
+    int64_t start = now_ns();
+    for (int i = 0; i < OVERHEAD_SAMPLES; i++) {
+        if (send(workers[w].fd, &req, sizeof(req), 0) != sizeof(req) ||
+            recv(workers[w].fd, &reply, sizeof(reply), 0) != sizeof(reply)) {
+            perror("round trip");
+            return -1;
+        }
+    }
+    return (now_ns() - start) / 1000.0 / OVERHEAD_SAMPLES;
 }
 
 int main() {
-    pid_t pid;
-    int status;
-    int active_children = 0;
-    int completed_registrations = 0;
-    
+    static Backlog critical_backlog, routine_backlog;
+    LatencyHistogram latency[2], queue_wait[2];
+    int completed[2] = {0, 0};
+    int turned_away = 0;
+    int peak_backlog = 0;
+    int64_t critical_latency_ns = -1;
+
     printf("========================================\n");
-    printf("   PROPER PROCESS CLEANUP SOLUTION\n");
+    printf("   PRE-FORKED REGISTRATION POOL SOLUTION\n");
     printf("========================================\n");
     printf("Simulating emergency room patient registrations\n");
-    printf("✓ Parent PROPERLY cleans up child processes\n");
+    printf("✓ %d workers forked ONCE, reused for every patient\n", POOL_SIZE);
+    printf("✓ %d worker reserved for CRITICAL patients\n", RESERVED_WORKERS);
+    printf("✓ Routine backlog capped at %d (admission control)\n", ADMISSION_LIMIT);
     printf("✓ No zombie accumulation\n");
     printf("========================================\n\n");
-    
-    printf("Registering %d emergency patients...\n\n", MAX_PATIENTS);
-    
-    /* Create processes for emergency patients WITH proper cleanup */
-    for (int i = 1; i <= MAX_PATIENTS; i++) {
-        pid = fork();
-        
-        if (pid < 0) {
-            /* Fork failed */
-            printf("\n*** ERROR at Patient %d ***\n", i);
-            printf("ERROR: fork() failed - %s\n", strerror(errno));
-            break;
+
+    for (int c = 0; c < 2; c++) {
+        lh_init(&latency[c]);
+        lh_init(&queue_wait[c]);
+    }
+
+    printf("Measuring per-patient overhead (%d samples each)...\n", OVERHEAD_SAMPLES);
+    double fork_us = measure_fork_cost();
+
+    if (start_pool() < 0) {
+        printf("\n*** ERROR: Cannot start registration pool ***\n");
+        return 1;
+    }
+    double pool_us = measure_pool_cost();
+    printf("  fork() + waitpid() per patient:  %8.1f µs\n", fork_us);
+    printf("  Pooled worker round trip:        %8.1f µs\n\n", pool_us);
+
+    printf("Registering %d emergency patients (1 every %dms), then a burst of %d...\n\n",
+           MAX_PATIENTS, ARRIVAL_US / 1000, BURST_PATIENTS);
+
+    int total = MAX_PATIENTS + BURST_PATIENTS + 1;
+    int next_patient = 1;
+    int outstanding = 0;
+    int64_t start = now_ns();
+
+    while (next_patient <= total || outstanding > 0) {
+        /* Admit every patient whose arrival time has come */
+        int64_t now = now_ns();
+        while (next_patient <= total) {
+            if (arrival_ns(start, next_patient) > now) break;
+
+            RegistrationRequest req = {next_patient, ROUTINE, REGISTRATION_WORK_US, now};
+            if (next_patient == CRITICAL_PATIENT || next_patient % CRITICAL_EVERY == 0)
+                req.priority = CRITICAL;
+            if (next_patient == CRITICAL_PATIENT)
+                printf("[System] CRITICAL: Patient %d arrives behind %d waiting patients\n",
+                       CRITICAL_PATIENT, routine_backlog.tail - routine_backlog.head);
+
+            Backlog *b = req.priority == CRITICAL ? &critical_backlog : &routine_backlog;
+            if (req.priority == ROUTINE && b->tail - b->head >= ADMISSION_LIMIT) {
+                turned_away++;  /* Admission control: divert rather than queue forever */
+            } else {
+                b->items[b->tail++] = req;
+                outstanding++;
+            }
+            next_patient++;
         }
-        else if (pid == 0) {
-            /* Child process - register patient */
-            register_patient(i);
+        if (routine_backlog.tail - routine_backlog.head > peak_backlog)
+            peak_backlog = routine_backlog.tail - routine_backlog.head;
+        drain_backlogs(&critical_backlog, &routine_backlog);
+
+        /* Wait for a worker to finish or for the next arrival */
+        int timeout_ms = -1;
+        if (next_patient <= total) {
+            int64_t wait = arrival_ns(start, next_patient) - now_ns();
+            timeout_ms = wait > 0 ? (int)((wait + 999999) / 1000000) : 0;
+        }
+        struct pollfd fds[POOL_SIZE];
+        for (int i = 0; i < POOL_SIZE; i++) fds[i] = (struct pollfd){workers[i].fd, POLLIN, 0};
+        if (poll(fds, POOL_SIZE, timeout_ms) < 0 && errno != EINTR) {
+            perror("poll");
+            return 1;
         }
-        else {
-            /* Parent process - track active children */
-            active_children++;
-            
-            if (i % 10 == 0) {
-                printf("[System] %d patients registered, cleaning up...\n", i);
-                
-                /* PROPER CLEANUP: Reap completed children */
-                while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-                    active_children--;
-                    completed_registrations++;
-                }
+
+        for (int i = 0; i < POOL_SIZE; i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP))) continue;
+            RegistrationReply reply;
+            if (recv(workers[i].fd, &reply, sizeof(reply), 0) != sizeof(reply)) {
+                printf("ERROR: Worker %d (pid %d) died\n", i, workers[i].pid);
+                return 1;
             }
+            int64_t done = now_ns();
+            workers[i].busy = 0;
+            workers[i].served++;
+            outstanding--;
+            completed[reply.priority]++;
+            lh_record(&latency[reply.priority], (uint64_t)((done - reply.submitted_ns) / 1000));
+            lh_record(&queue_wait[reply.priority], (uint64_t)((reply.started_ns - reply.submitted_ns) / 1000));
+            if (reply.patient_id == CRITICAL_PATIENT) critical_latency_ns = done - reply.submitted_ns;
+            if ((completed[0] + completed[1]) % 200 == 0)
+                printf("[System] %d patients registered...\n", completed[0] + completed[1]);
         }
-        
-        /* Small delay between registrations */
-        usleep(10000);  /* 10ms */
+        drain_backlogs(&critical_backlog, &routine_backlog);
     }
-    
-    printf("\n[System] All %d patients spawned, waiting for completion...\n", MAX_PATIENTS);
-    
-    /* Wait for ALL remaining children to complete */
-    printf("[System] Cleaning up remaining processes...\n");
-    while ((pid = waitpid(-1, &status, 0)) > 0) {
-        active_children--;
-        completed_registrations++;
-    }
-    
+    double elapsed = (now_ns() - start) / 1e9;
+
+    int reaped = stop_pool();
+
     printf("\n========================================\n");
-    printf("All %d emergency patients processed\n", MAX_PATIENTS);
+    printf("All %d emergency patients processed\n", completed[0] + completed[1] + turned_away);
     printf("========================================\n\n");
-    
+
+    printf("%-10s %9s %12s %12s %12s %12s\n", "Class", "Count", "Wait p50", "Latency p50",
+           "Latency p99", "Latency max");
+    const char *names[2] = {"Routine", "Critical"};
+    for (int c = CRITICAL; c >= ROUTINE; c--)
+        printf("%-10s %9d %10.2fms %10.2fms %10.2fms %10.2fms\n", names[c], completed[c],
+               lh_percentile(&queue_wait[c], 50) / 1000.0, lh_percentile(&latency[c], 50) / 1000.0,
+               lh_percentile(&latency[c], 99) / 1000.0, latency[c].max / 1000.0);
+    printf("Throughput: %.0f registrations/s over %.2fs\n\n", (completed[0] + completed[1]) / elapsed,
+           elapsed);
+
     /* Check system status */
     printf("System Resource Status:\n");
-    printf("  Total processes spawned: %d\n", MAX_PATIENTS);
-    printf("  Completed registrations: %d\n", completed_registrations);
-    printf("  Active children remaining: %d\n", active_children);
-    printf("  Zombie processes: 0 ✓ (properly cleaned up!)\n");
-    printf("  Parent properly called waitpid()\n\n");
-    
-    printf("✓ NO RESOURCE EXHAUSTION\n");
-    printf("All child processes properly reaped\n");
-    printf("Check with: ps aux | grep defunct (should be empty)\n\n");
-    
-    /* Try to register one more CRITICAL emergency patient */
+    printf("  Total processes spawned: %d (%d pool workers + %d fork-cost samples; was %d with fork-per-patient)\n",
+           POOL_SIZE + OVERHEAD_SAMPLES, POOL_SIZE, OVERHEAD_SAMPLES, total);
+    printf("  Completed registrations: %d\n", completed[0] + completed[1]);
+    printf("  Turned away at admission: %d (peak routine backlog %d)\n", turned_away, peak_backlog);
+    printf("  Workers reaped at shutdown: %d of %d\n", reaped, POOL_SIZE);
+    printf("  Zombie processes: 0 ✓ (properly cleaned up!)\n\n");
+
+    printf("Worker utilisation:\n");
+    for (int i = 0; i < POOL_SIZE; i++)
+        printf("  Worker %d (pid %d)%s: %ld registrations\n", i, workers[i].pid,
+               workers[i].reserved ? " [reserved]" : "", workers[i].served);
+    printf("\n");
+
     printf("========================================\n");
-    printf("CRITICAL: New emergency patient arrives!\n");
-    printf("Patient %d needs immediate registration...\n", CRITICAL_PATIENT);
+    printf("CRITICAL: Emergency patient %d\n", CRITICAL_PATIENT);
     printf("========================================\n");
-    
-    pid = fork();
-    
-    if (pid < 0) {
-        printf("\n*** UNEXPECTED ERROR ***\n");
-        printf("ERROR: Cannot register emergency patient!\n");
-        printf("fork() failed: %s\n", strerror(errno));
-    }
-    else if (pid == 0) {
-        register_patient(CRITICAL_PATIENT);
-    }
-    else {
-        printf("[System] ✓ Emergency patient %d registration started\n", CRITICAL_PATIENT);
-        printf("[System] System has capacity for new patients\n");
-        
-        /* Wait for critical patient */
-        waitpid(pid, &status, 0);
-        printf("[System] ✓ Emergency patient %d registration complete\n\n", CRITICAL_PATIENT);
-    }
-    
+    if (critical_latency_ns >= 0)
+        printf("[System] ✓ Registered in %.2fms despite the routine burst\n\n", critical_latency_ns / 1e6);
+    else
+        printf("[System] *** Emergency patient was NOT registered ***\n\n");
+
     printf("========================================\n");
     printf("SOLUTION ANALYSIS:\n");
     printf("========================================\n");
-    printf("✓ Parent created %d child processes\n", MAX_PATIENTS);
-    printf("✓ Parent called waitpid() to reap all children\n");
-    printf("✓ Zero zombie processes remain\n");
-    printf("✓ System resources available for new patients\n");
-    printf("✓ Emergency patient #%d successfully registered\n\n", CRITICAL_PATIENT);
-    
+    printf("✓ Parent forked %d workers once instead of %d children\n", POOL_SIZE, total);
+    printf("✓ Per-patient overhead: %.1f µs round trip vs %.1f µs fork+reap\n", pool_us, fork_us);
+    printf("✓ Reserved worker keeps critical latency near the work time\n");
+    printf("✓ Routine backlog capped - overload is refused, not absorbed\n");
+    printf("✓ Zero zombie processes remain\n\n");
+
     printf("Comparison with BROKEN version:\n");
     printf("  BROKEN: Zombies accumulate → resource exhaustion\n");
-    printf("  FIXED:  Proper cleanup → resources available\n\n");
-    
+    printf("  FIXED:  Fixed worker pool → process count never grows\n\n");
+
     printf("Key Difference:\n");
-    printf("  waitpid(-1, &status, WNOHANG) in loop\n");
-    printf("  Reaps terminated children without blocking\n");
-    printf("  Prevents process table exhaustion\n");
+    printf("  socketpair(AF_UNIX, SOCK_SEQPACKET) per worker\n");
+    printf("  One message per registration, one reply per completion\n");
+    printf("  poll() on all workers; waitpid() only at shutdown\n");
     printf("========================================\n\n");
-    
+
     printf("Best Practices Applied:\n");
-    printf("1. Regular cleanup during operation (every 10 patients)\n");
-    printf("2. Final cleanup at end (wait for all remaining)\n");
-    printf("3. WNOHANG flag allows non-blocking cleanup\n");
-    printf("4. System remains responsive throughout\n");
+    printf("1. Pre-fork workers; never fork on the request path\n");
+    printf("2. Reserve capacity for the work that must not wait\n");
+    printf("3. Bound every queue and refuse work beyond it\n");
+    printf("4. Final cleanup at end (close sockets, reap all workers)\n");
     printf("========================================\n");
-    
+
     return 0;
 }
\ No newline at end of file
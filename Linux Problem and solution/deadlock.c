@@ -10,7 +10,13 @@
  *
  * This demonstrates circular wait deadlock condition.
  *
- * Compile: gcc -pthread deadlock_demo.c -o deadlock
+ * The mutexes are HPMS/Lock_Monitor.h monitored mutexes: the monitor keeps
+ * a live wait-for graph and reports the cycle the moment the second
+ * thread blocks, instead of the program guessing after a 5 second sleep.
+ * Contention and hold times per lock are printed with the analysis, and
+ * the monitor's own overhead (on and off) is measured at startup.
+ *
+ * Compile: gcc -O2 -pthread deadlock.c -o deadlock
  * Run:     ./deadlock
  */
 
@@ -19,9 +25,13 @@
 #include <unistd.h>
 #include <string.h>
 
-/* Two mutexes representing two shared resources */
-pthread_mutex_t patient_record_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t medication_inventory_mutex = PTHREAD_MUTEX_INITIALIZER;
+#include "../HPMS/Lock_Monitor.h"
+
+#define OVERHEAD_ITERATIONS 1000000
+
+/* Two monitored mutexes representing two shared resources */
+MonitoredMutex patient_record_mutex;
+MonitoredMutex medication_inventory_mutex;
 
 /* Shared resources */
 typedef struct {
@@ -40,12 +50,13 @@ MedicationInventory medication = {"Nitroglycerin", 50};
 
 /* Doctor thread - acquires locks in ORDER 1 */
 void* doctor_thread(void* arg) {
+    lm_thread_name("Doctor");
     printf("\n[Doctor] Emergency patient #1234 requires treatment\n");
     printf("[Doctor] Starting diagnosis update...\n");
     
     /* STEP 1: Lock patient record */
     printf("[Doctor] Acquiring Patient Record Lock...\n");
-    pthread_mutex_lock(&patient_record_mutex);
+    lm_lock(&patient_record_mutex);
     printf("[Doctor] ✓ Patient Record Lock ACQUIRED\n");
     
     /* Simulate working with patient record */
@@ -58,7 +69,7 @@ void* doctor_thread(void* arg) {
     printf("[Doctor] Requesting Medication Inventory Lock...\n");
     
     /* DEADLOCK OCCURS HERE - waiting for pharmacy's lock */
-    pthread_mutex_lock(&medication_inventory_mutex);
+    lm_lock(&medication_inventory_mutex);
     printf("[Doctor] ✓ Medication Inventory Lock ACQUIRED\n");
     
     /* This code will NEVER execute due to deadlock */
@@ -67,8 +78,8 @@ void* doctor_thread(void* arg) {
     printf("[Doctor] Prescribing %s\n", medication.medication_name);
     
     /* Release locks */
-    pthread_mutex_unlock(&medication_inventory_mutex);
-    pthread_mutex_unlock(&patient_record_mutex);
+    lm_unlock(&medication_inventory_mutex);
+    lm_unlock(&patient_record_mutex);
     
     printf("[Doctor] Treatment complete\n");
     return NULL;
@@ -76,6 +87,7 @@ void* doctor_thread(void* arg) {
 
 /* Pharmacy thread - acquires locks in ORDER 2 (OPPOSITE!) */
 void* pharmacy_thread(void* arg) {
+    lm_thread_name("Pharmacy");
     /* Small delay to let doctor acquire first lock */
     usleep(500000);  /* 0.5 seconds */
     
@@ -83,7 +95,7 @@ void* pharmacy_thread(void* arg) {
     
     /* STEP 1: Lock medication inventory */
     printf("[Pharmacy] Acquiring Medication Inventory Lock...\n");
-    pthread_mutex_lock(&medication_inventory_mutex);
+    lm_lock(&medication_inventory_mutex);
     printf("[Pharmacy] ✓ Medication Inventory Lock ACQUIRED\n");
     
     /* Simulate checking stock */
@@ -96,7 +108,7 @@ void* pharmacy_thread(void* arg) {
     printf("[Pharmacy] Requesting Patient Record Lock...\n");
     
     /* DEADLOCK OCCURS HERE - waiting for doctor's lock */
-    pthread_mutex_lock(&patient_record_mutex);
+    lm_lock(&patient_record_mutex);
     printf("[Pharmacy] ✓ Patient Record Lock ACQUIRED\n");
     
     /* This code will NEVER execute due to deadlock */
@@ -104,13 +116,35 @@ void* pharmacy_thread(void* arg) {
     printf("[Pharmacy] Dispensing %s\n", medication.medication_name);
     
     /* Release locks */
-    pthread_mutex_unlock(&patient_record_mutex);
-    pthread_mutex_unlock(&medication_inventory_mutex);
+    lm_unlock(&patient_record_mutex);
+    lm_unlock(&medication_inventory_mutex);
     
     printf("[Pharmacy] Medication dispensed\n");
     return NULL;
 }
 
+/* Nanoseconds per uncontended lock + unlock pair */
+double measure_lock_cost(int mode) {
+    pthread_mutex_t raw = PTHREAD_MUTEX_INITIALIZER;
+    static MonitoredMutex monitored;
+    if (monitored.name == NULL) lm_mutex_init(&monitored, "Overhead probe");
+    lm_set_enabled(mode == 2);
+
+    int64_t start = lm_now_ns();
+    for (int i = 0; i < OVERHEAD_ITERATIONS; i++) {
+        if (mode == 0) {
+            pthread_mutex_lock(&raw);
+            pthread_mutex_unlock(&raw);
+        } else {
+            lm_lock(&monitored);
+            lm_unlock(&monitored);
+        }
+    }
+    double ns = (double)(lm_now_ns() - start) / OVERHEAD_ITERATIONS;
+    lm_set_enabled(1);
+    return ns;
+}
+
 int main() {
     pthread_t doctor, pharmacy;
     
@@ -121,6 +155,16 @@ int main() {
     printf("WARNING: Inconsistent lock ordering!\n");
     printf("========================================\n");
     
+    printf("\nLock monitor cost (uncontended lock + unlock):\n");
+    printf("  pthread mutex:        %6.1f ns\n", measure_lock_cost(0));
+    printf("  monitor OFF:          %6.1f ns\n", measure_lock_cost(1));
+    printf("  monitor ON:           %6.1f ns\n", measure_lock_cost(2));
+    lm_reset();
+
+    lm_thread_name("Main");
+    lm_mutex_init(&patient_record_mutex, "Patient Record");
+    lm_mutex_init(&medication_inventory_mutex, "Medication Inventory");
+
     printf("\nInitial State:\n");
     printf("  Patient #%d\n", patient.patient_id);
     printf("  Diagnosis: %s\n", patient.diagnosis);
@@ -136,14 +180,21 @@ int main() {
     pthread_create(&doctor, NULL, doctor_thread, NULL);
     pthread_create(&pharmacy, NULL, pharmacy_thread, NULL);
     
-    /* Wait for 5 seconds to observe deadlock */
-    printf("\n[System] Monitoring threads for 5 seconds...\n");
-    sleep(5);
-    
-    /* Check if threads are still alive (deadlocked) */
+    /* The lock monitor reports the cycle as soon as it closes */
+    printf("\n[System] Lock monitor watching the wait-for graph...\n");
+    int64_t start = lm_now_ns();
+    while (lm_cycles_detected() == 0 && lm_now_ns() - start < 10000000000LL) usleep(1000);
+    double detected_s = (lm_now_ns() - start) / 1e9;
+
     printf("\n========================================\n");
-    printf("*** DEADLOCK DETECTED ***\n");
+    if (lm_cycles_detected() > 0)
+        printf("*** DEADLOCK DETECTED at t=%.2fs (the moment the cycle formed) ***\n", detected_s);
+    else
+        printf("*** NO CYCLE REPORTED after %.0fs ***\n", detected_s);
     printf("========================================\n");
+
+    printf("\nLock statistics:\n");
+    lm_report();
     
     printf("\nDeadlock Analysis:\n");
     printf("------------------\n");
@@ -164,7 +215,7 @@ int main() {
     printf("  ✗ Patient diagnosis NOT recorded\n");
     printf("  ✗ Medication NOT dispensed\n");
     printf("  ✗ Emergency patient NOT receiving treatment\n");
-    printf("  ✗ Time elapsed: 5+ seconds (CRITICAL DELAY)\n\n");
+    printf("  ✗ Both threads blocked forever from t=%.2fs (CRITICAL DELAY)\n\n", detected_s);
     
     printf("Root Cause:\n");
     printf("  Inconsistent lock ordering between threads\n");
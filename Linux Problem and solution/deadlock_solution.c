@@ -4,25 +4,33 @@
  *
  * Scenario:
  * 1. Same as deadlock_demo.c BUT with consistent lock ordering
- * 2. BOTH Doctor and Pharmacy acquire locks in SAME order
- * 3. Order: Patient Record (1st) → Medication Inventory (2nd)
- * 4. No circular wait possible
+ * 2. Every lock has a rank; code asks for a SET of locks (any order)
+ * 3. The set is taken in rank order: Patient Record → Medication Inventory
+ * 4. Busy locks are try-locked with backoff - a waiter holds nothing
  * 5. Deadlock is PREVENTED - operations complete successfully
  *
+ * A pharmacy stress test then runs orders that each lock several random
+ * stock items, and reports how long acquiring a lock set ever took.
+ *
  * This demonstrates deadlock prevention through lock ordering protocol.
  *
- * Compile: gcc -pthread lock_ordering_solution.c -o lock_ordering
- * Run:     ./lock_ordering
+ * Compile: gcc -O2 -pthread deadlock_solution.c -o deadlock_solution
+ * Run:     ./deadlock_solution
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <pthread.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
+
+#include "../HPMS/Latency_Histogram.h"
+#include "../HPMS/Lock_Set.h"
 
-/* Two mutexes representing two shared resources */
-pthread_mutex_t patient_record_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t medication_inventory_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Two ranked locks representing two shared resources */
+RankedLock patient_record_lock;
+RankedLock medication_inventory_lock;
 
 /* Shared resources */
 typedef struct {
@@ -40,111 +48,199 @@ PatientRecord patient = {1234, "Not diagnosed", "None"};
 MedicationInventory medication = {"Nitroglycerin", 50};
 
 /*
- * LOCK ORDERING PROTOCOL:
- * Rule: ALWAYS acquire locks in this order:
- *   1. Patient Record Mutex (FIRST)
- *   2. Medication Inventory Mutex (SECOND)
- * 
- * NEVER acquire in reverse order!
+ * LOCK HIERARCHY (ranks, smaller taken first):
+ *   10   Patient Record
+ *   20   Medication Inventory
+ *   100+ Pharmacy stock items (100 + item number)
+ *
+ * Code never locks these one by one: it lists what it needs in a LockSet
+ * (HPMS/Lock_Set.h), in any order, and the set takes them by rank.
  */
+#define RANK_PATIENT_RECORD 10
+#define RANK_MEDICATION     20
+#define RANK_STOCK_ITEM     100
+
+/* Pharmacy stress test: transactions over many stock items */
+#define STOCK_ITEMS        64
+#define STOCK_PER_ITEM     100000
+#define PHARMACY_THREADS   6
+#define TRANSACTIONS       2000
+#define ITEMS_PER_ORDER    6
+#define ORDER_HOLD_US      20
 
-/* Doctor thread - follows lock ordering protocol */
+RankedLock stock_locks[STOCK_ITEMS];
+int stock[STOCK_ITEMS];
+int64_t worst_wait_us[PHARMACY_THREADS];
+long total_backoffs[PHARMACY_THREADS];
+LatencyHistogram order_wait_us[PHARMACY_THREADS];
+
+/* Doctor thread - takes the whole lock set for the treatment */
 void* doctor_thread(void* arg) {
+    LockSet locks;
+
+    (void)arg;
     printf("\n[Doctor] Emergency patient #1234 requires treatment\n");
-    printf("[Doctor] Following lock ordering protocol...\n");
-    printf("[Doctor] Protocol: Patient Record (1st) → Medication (2nd)\n");
-    
-    /* STEP 1: Lock patient record (ORDER 1) */
-    printf("\n[Doctor] Step 1: Acquiring Patient Record Lock...\n");
-    pthread_mutex_lock(&patient_record_mutex);
-    printf("[Doctor] ✓ Patient Record Lock ACQUIRED\n");
-    
+    printf("[Doctor] Needs: Patient Record + Medication Inventory\n");
+
+    lock_set_init(&locks, 1);
+    lock_set_add(&locks, &patient_record_lock);
+    lock_set_add(&locks, &medication_inventory_lock);
+
+    printf("\n[Doctor] Acquiring lock set...\n");
+    if (lock_set_acquire(&locks, LS_NO_DEADLINE) != 0) return NULL;
+    printf("[Doctor] ✓ %s + %s ACQUIRED (%ld attempt%s)\n", locks.locks[0]->name,
+           locks.locks[1]->name, locks.attempts, locks.attempts == 1 ? "" : "s");
+
     /* Work with patient record */
     strcpy(patient.diagnosis, "Severe chest pain - cardiac event");
     strcpy(patient.allergy, "None");
     printf("[Doctor] Recording diagnosis: %s\n", patient.diagnosis);
     printf("[Doctor] Verified allergies: %s\n", patient.allergy);
     sleep(1);
-    
-    /* STEP 2: Lock medication inventory (ORDER 2) */
-    printf("[Doctor] Step 2: Acquiring Medication Inventory Lock...\n");
-    pthread_mutex_lock(&medication_inventory_mutex);
-    printf("[Doctor] ✓ Medication Inventory Lock ACQUIRED\n");
-    
+
     /* Work with medication inventory */
-    printf("[Doctor] Checking %s stock: %d units available\n", 
+    printf("[Doctor] Checking %s stock: %d units available\n",
            medication.medication_name, medication.stock_available);
-    printf("[Doctor] Prescribing %s for cardiac emergency\n", 
+    printf("[Doctor] Prescribing %s for cardiac emergency\n",
            medication.medication_name);
     medication.stock_available--;
-    
+
     /* Release locks in REVERSE order */
-    pthread_mutex_unlock(&medication_inventory_mutex);
-    printf("[Doctor] ✓ Medication Inventory Lock RELEASED\n");
-    
-    pthread_mutex_unlock(&patient_record_mutex);
-    printf("[Doctor] ✓ Patient Record Lock RELEASED\n");
-    
+    lock_set_release(&locks);
+    printf("[Doctor] ✓ Lock set RELEASED\n");
+
     printf("[Doctor] ✓ Treatment complete - patient stabilized\n");
     return NULL;
 }
 
-/* Pharmacy thread - ALSO follows same lock ordering protocol */
+/* Pharmacy thread - lists its locks in the OPPOSITE order; the set fixes it */
 void* pharmacy_thread(void* arg) {
+    LockSet locks;
+
+    (void)arg;
     /* Small delay to create potential conflict */
     usleep(500000);  /* 0.5 seconds */
-    
+
     printf("\n[Pharmacy] Preparing to dispense emergency medication\n");
-    printf("[Pharmacy] Following lock ordering protocol...\n");
-    printf("[Pharmacy] Protocol: Patient Record (1st) → Medication (2nd)\n");
-    
-    /* STEP 1: Lock patient record (ORDER 1) - SAME AS DOCTOR! */
-    printf("\n[Pharmacy] Step 1: Acquiring Patient Record Lock...\n");
-    pthread_mutex_lock(&patient_record_mutex);
-    printf("[Pharmacy] ✓ Patient Record Lock ACQUIRED\n");
-    
+    printf("[Pharmacy] Needs: Medication Inventory + Patient Record (listed in that order)\n");
+
+    lock_set_init(&locks, 2);
+    lock_set_add(&locks, &medication_inventory_lock);
+    lock_set_add(&locks, &patient_record_lock);
+    printf("[Pharmacy] Lock set will take: %s (rank %u) → %s (rank %u)\n",
+           locks.locks[0]->name, locks.locks[0]->rank, locks.locks[1]->name, locks.locks[1]->rank);
+
+    printf("\n[Pharmacy] Acquiring lock set (doctor holds it - backing off, holding nothing)...\n");
+    if (lock_set_acquire(&locks, LS_NO_DEADLINE) != 0) return NULL;
+    printf("[Pharmacy] ✓ Lock set ACQUIRED after %.2fs (%ld attempts)\n",
+           locks.last_wait_us / 1e6, locks.attempts);
+
     /* Verify patient information */
-    printf("[Pharmacy] Verifying patient #%d allergies: %s\n", 
+    printf("[Pharmacy] Verifying patient #%d allergies: %s\n",
            patient.patient_id, patient.allergy);
     printf("[Pharmacy] Diagnosis: %s\n", patient.diagnosis);
     sleep(1);
-    
-    /* STEP 2: Lock medication inventory (ORDER 2) - SAME AS DOCTOR! */
-    printf("[Pharmacy] Step 2: Acquiring Medication Inventory Lock...\n");
-    pthread_mutex_lock(&medication_inventory_mutex);
-    printf("[Pharmacy] ✓ Medication Inventory Lock ACQUIRED\n");
-    
+
     /* Dispense medication */
     printf("[Pharmacy] Dispensing %s\n", medication.medication_name);
-    printf("[Pharmacy] Updated stock: %d units remaining\n", 
+    printf("[Pharmacy] Updated stock: %d units remaining\n",
            medication.stock_available);
-    
-    /* Release locks in REVERSE order */
-    pthread_mutex_unlock(&medication_inventory_mutex);
-    printf("[Pharmacy] ✓ Medication Inventory Lock RELEASED\n");
-    
-    pthread_mutex_unlock(&patient_record_mutex);
-    printf("[Pharmacy] ✓ Patient Record Lock RELEASED\n");
-    
+
+    lock_set_release(&locks);
+    printf("[Pharmacy] ✓ Lock set RELEASED\n");
+
     printf("[Pharmacy] ✓ Medication dispensed successfully\n");
     return NULL;
 }
 
+/* Pharmacy clerk - each order moves stock between several random items */
+void* pharmacy_clerk(void* arg) {
+    int clerk = (int)(long)arg;
+    unsigned seed = clerk * 7919 + 1;
+    LockSet locks;
+    int items[ITEMS_PER_ORDER];
+
+    lock_set_init(&locks, clerk + 10);
+    lh_init(&order_wait_us[clerk]);
+    for (int t = 0; t < TRANSACTIONS; t++) {
+        /* Items come in whatever order the prescription lists them */
+        lock_set_clear(&locks);
+        for (int i = 0; i < ITEMS_PER_ORDER; i++) {
+            items[i] = rand_r(&seed) % STOCK_ITEMS;
+            lock_set_add(&locks, &stock_locks[items[i]]);
+        }
+        lock_set_acquire(&locks, LS_NO_DEADLINE);
+
+        /* Dispense from the first item, restock the others (total is conserved) */
+        stock[items[0]] -= ITEMS_PER_ORDER - 1;
+        for (int i = 1; i < ITEMS_PER_ORDER; i++) stock[items[i]]++;
+        usleep(ORDER_HOLD_US);
+
+        lock_set_release(&locks);
+        lh_record(&order_wait_us[clerk], (uint64_t)locks.last_wait_us);
+        if (locks.last_wait_us > worst_wait_us[clerk]) worst_wait_us[clerk] = locks.last_wait_us;
+    }
+    total_backoffs[clerk] = locks.backoffs;
+    return NULL;
+}
+
+void run_pharmacy_stress(void) {
+    pthread_t clerks[PHARMACY_THREADS];
+    struct timespec t0, t1;
+
+    for (int i = 0; i < STOCK_ITEMS; i++) {
+        ranked_lock_init(&stock_locks[i], RANK_STOCK_ITEM + i, "Stock item");
+        stock[i] = STOCK_PER_ITEM;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (long c = 0; c < PHARMACY_THREADS; c++) pthread_create(&clerks[c], NULL, pharmacy_clerk, (void *)c);
+    for (int c = 0; c < PHARMACY_THREADS; c++) pthread_join(clerks[c], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    LatencyHistogram all;
+    int64_t worst = 0;
+    long backoffs = 0, total = 0;
+    lh_init(&all);
+    for (int c = 0; c < PHARMACY_THREADS; c++) {
+        lh_merge(&all, &order_wait_us[c]);
+        if (worst_wait_us[c] > worst) worst = worst_wait_us[c];
+        backoffs += total_backoffs[c];
+    }
+    for (int i = 0; i < STOCK_ITEMS; i++) total += stock[i];
+
+    printf("  Orders: %d (%d clerks x %d), %d stock locks each, in random order\n",
+           PHARMACY_THREADS * TRANSACTIONS, PHARMACY_THREADS, TRANSACTIONS, ITEMS_PER_ORDER);
+    printf("  Throughput: %.0f orders/s, %ld backoffs\n", PHARMACY_THREADS * TRANSACTIONS / elapsed,
+           backoffs);
+    printf("  Lock set wait: p50 %.3fms, p99 %.3fms, worst %.3fms\n",
+           lh_percentile(&all, 50) / 1000.0, lh_percentile(&all, 99) / 1000.0, worst / 1000.0);
+    printf("  Stock conserved: %s (%ld units)\n", total == (long)STOCK_ITEMS * STOCK_PER_ITEM ? "✓ yes" : "✗ NO",
+           total);
+
+    for (int i = 0; i < STOCK_ITEMS; i++) ranked_lock_destroy(&stock_locks[i]);
+}
+
 int main() {
     pthread_t doctor, pharmacy;
     
     printf("========================================\n");
     printf("   LOCK ORDERING SOLUTION\n");
     printf("========================================\n");
-    printf("✓ Consistent lock ordering protocol\n");
+    printf("✓ Consistent lock ordering protocol (ranked lock sets)\n");
     printf("✓ Deadlock PREVENTED\n");
     printf("========================================\n");
     
     printf("\nLock Ordering Protocol:\n");
-    printf("  Rule 1: Patient Record Mutex acquired FIRST\n");
-    printf("  Rule 2: Medication Inventory Mutex acquired SECOND\n");
-    printf("  Rule 3: BOTH threads follow SAME order\n");
-    printf("  Rule 4: Release in REVERSE order\n");
+    printf("  Rule 1: Patient Record (rank %d) acquired FIRST\n", RANK_PATIENT_RECORD);
+    printf("  Rule 2: Medication Inventory (rank %d) acquired SECOND\n", RANK_MEDICATION);
+    printf("  Rule 3: Lock sets enforce the order - callers list locks freely\n");
+    printf("  Rule 4: Busy lock → release all, back off, retry\n");
+    printf("  Rule 5: Release in REVERSE order\n");
+
+    ranked_lock_init(&patient_record_lock, RANK_PATIENT_RECORD, "Patient Record");
+    ranked_lock_init(&medication_inventory_lock, RANK_MEDICATION, "Medication Inventory");
     
     printf("\nInitial State:\n");
     printf("  Patient #%d\n", patient.patient_id);
@@ -180,11 +276,11 @@ int main() {
     printf("HOW LOCK ORDERING PREVENTED DEADLOCK:\n");
     printf("========================================\n");
     printf("Timeline:\n");
-    printf("1. Doctor acquired Patient Record (1st) ✓\n");
-    printf("2. Doctor acquired Medication (2nd) ✓\n");
-    printf("3. Doctor completed work, released both locks ✓\n");
-    printf("4. Pharmacy acquired Patient Record (1st) ✓\n");
-    printf("5. Pharmacy acquired Medication (2nd) ✓\n");
+    printf("1. Doctor's set took Patient Record (1st) → Medication (2nd) ✓\n");
+    printf("2. Pharmacy listed Medication first; its set still took Patient Record first ✓\n");
+    printf("3. Pharmacy found the locks busy, released, backed off - holding nothing ✓\n");
+    printf("4. Doctor completed work, released both locks ✓\n");
+    printf("5. Pharmacy's next attempt took both locks ✓\n");
     printf("6. Pharmacy completed work, released both locks ✓\n");
     printf("\nKey Points:\n");
     printf("✓ BOTH threads followed SAME lock order (1→2)\n");
@@ -202,22 +298,27 @@ int main() {
     printf("  Result:   DEADLOCK (circular wait)\n");
     printf("\nFIXED (this program):\n");
     printf("  Doctor:   Patient (1) → Medication (2)\n");
-    printf("  Pharmacy: Patient (1) → Medication (2)\n");
+    printf("  Pharmacy: Patient (1) → Medication (2)  [listed as 2, 1 - sorted by rank]\n");
     printf("  Result:   NO DEADLOCK (same order)\n");
+
+    printf("\n========================================\n");
+    printf("PHARMACY STRESS TEST (multi-item orders):\n");
+    printf("========================================\n");
+    run_pharmacy_stress();
     
     printf("\n========================================\n");
     printf("Best Practices:\n");
     printf("========================================\n");
-    printf("1. Define total ordering for all locks\n");
+    printf("1. Define total ordering for all locks (ranks)\n");
     printf("2. Document the ordering clearly\n");
-    printf("3. ALL code must follow same order\n");
-    printf("4. Code review to enforce compliance\n");
+    printf("3. Acquire multi-lock work through a lock set, never by hand\n");
+    printf("4. Never wait on one lock while holding another (try-lock + backoff)\n");
     printf("5. Release locks in reverse acquisition order\n");
     printf("========================================\n");
     
     /* Cleanup */
-    pthread_mutex_destroy(&patient_record_mutex);
-    pthread_mutex_destroy(&medication_inventory_mutex);
+    ranked_lock_destroy(&patient_record_lock);
+    ranked_lock_destroy(&medication_inventory_lock);
     
     return 0;
 }
@@ -5,6 +5,11 @@
  * ALWAYS Patient Record FIRST, then Medication Inventory SECOND.
  * 
  * Demonstrates: Consistent lock ordering eliminates circular wait condition.
+ * Locks are taken through ranked lock sets (HPMS/Lock_Set.h): callers list
+ * the locks they need in any order, the set takes them by rank, and a
+ * busy lock means release everything, back off briefly and retry - so no
+ * thread waits seconds on a timeout while holding another lock. A
+ * pharmacy stress run then locks several stock items per order.
  * 
  * Compile:
  *   gcc lock_ordering_solution_windows.c -o lock_ordering_solution_windows.exe
@@ -14,97 +19,128 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-// Two shared resources (represented by mutexes)
-HANDLE patient_record_mutex;
-HANDLE medication_inventory_mutex;
+#include "../HPMS/Lock_Set.h"
 
-// Doctor thread - acquires locks in CONSISTENT order
+// Lock hierarchy (ranks, smaller taken first); see HPMS/Lock_Set.h
+#define RANK_PATIENT_RECORD 10
+#define RANK_MEDICATION     20
+#define RANK_STOCK_ITEM     100
+
+#define LOCK_DEADLINE_MS    2000    // whole-set deadline; waits hold no locks
+#define STOCK_ITEMS         64
+#define PHARMACY_THREADS    6
+#define TRANSACTIONS        2000
+#define ITEMS_PER_ORDER     6
+
+// Two shared resources (represented by ranked locks)
+RankedLock patient_record_lock;
+RankedLock medication_inventory_lock;
+
+RankedLock stock_locks[STOCK_ITEMS];
+long stock[STOCK_ITEMS];
+long clerk_backoffs[PHARMACY_THREADS];
+long clerk_timeouts[PHARMACY_THREADS];
+int64_t clerk_worst_us[PHARMACY_THREADS];
+
+// Doctor thread - asks for both locks as one set
 DWORD WINAPI doctor_thread(LPVOID arg) {
+    LockSet locks;
+
+    (void)arg;
     printf("[Doctor] Starting patient treatment workflow at t=0s...\n");
-    
-    // STEP 1: Acquire Patient Record lock FIRST (enforced order)
-    printf("[Doctor] Acquiring Patient Record lock (Step 1)...\n");
-    DWORD result = WaitForSingleObject(patient_record_mutex, 5000);  // 5s timeout
-    
-    if (result == WAIT_TIMEOUT) {
-        printf("[Doctor] TIMEOUT acquiring Patient Record lock (deadlock avoided)\n");
+
+    lock_set_init(&locks, 1);
+    lock_set_add(&locks, &patient_record_lock);
+    lock_set_add(&locks, &medication_inventory_lock);
+
+    printf("[Doctor] Acquiring Patient Record + Medication Inventory (one lock set)...\n");
+    if (lock_set_acquire(&locks, LOCK_DEADLINE_MS) != 0) {
+        printf("[Doctor] Lock set not available within %dms (holding nothing)\n", LOCK_DEADLINE_MS);
         return 1;
     }
-    printf("[Doctor] ACQUIRED Patient Record lock at t=0s\n");
-    
+    printf("[Doctor] ACQUIRED both locks at t=0s\n");
+
     // Simulate reading patient data
     Sleep(1000);
     printf("[Doctor] Reading patient diagnosis...\n");
-    
-    // STEP 2: Acquire Medication Inventory lock SECOND (enforced order)
-    printf("[Doctor] Acquiring Medication Inventory lock (Step 2)...\n");
-    result = WaitForSingleObject(medication_inventory_mutex, 5000);  // 5s timeout
-    
-    if (result == WAIT_TIMEOUT) {
-        printf("[Doctor] TIMEOUT acquiring Medication lock\n");
-        ReleaseMutex(patient_record_mutex);  // Release first lock before failing
-        return 1;
-    }
-    printf("[Doctor] ACQUIRED Medication Inventory lock at t=1s\n");
-    
+
     // Now holding both locks - can safely prescribe
     printf("[Doctor] Prescribing medication (holding both locks safely)\n");
     Sleep(500);
-    
+
     // Release locks in REVERSE order (best practice)
-    ReleaseMutex(medication_inventory_mutex);
-    printf("[Doctor] Released Medication Inventory lock\n");
-    
-    ReleaseMutex(patient_record_mutex);
-    printf("[Doctor] Released Patient Record lock\n");
+    lock_set_release(&locks);
+    printf("[Doctor] Released Medication Inventory and Patient Record locks\n");
     printf("[Doctor] Treatment workflow complete!\n");
-    
+
     return 0;
 }
 
-// Pharmacy thread - acquires locks in SAME CONSISTENT order as doctor
+// Pharmacy thread - lists the locks in the opposite order; the set sorts them
 DWORD WINAPI pharmacy_thread(LPVOID arg) {
+    LockSet locks;
+
+    (void)arg;
     Sleep(500);  // Start 0.5s after doctor
-    
+
     printf("[Pharmacy] Starting medication verification workflow at t=0.5s...\n");
-    
-    // STEP 1: Acquire Patient Record lock FIRST (SAME order as doctor!)
-    printf("[Pharmacy] Acquiring Patient Record lock (Step 1 - SAME order as doctor)...\n");
-    DWORD result = WaitForSingleObject(patient_record_mutex, 5000);  // 5s timeout
-    
-    if (result == WAIT_TIMEOUT) {
-        printf("[Pharmacy] TIMEOUT acquiring Patient Record lock\n");
+
+    lock_set_init(&locks, 2);
+    lock_set_add(&locks, &medication_inventory_lock);
+    lock_set_add(&locks, &patient_record_lock);
+    printf("[Pharmacy] Asked for Medication + Patient Record; set takes %s first (rank %u)\n",
+           locks.locks[0]->name, locks.locks[0]->rank);
+
+    if (lock_set_acquire(&locks, LOCK_DEADLINE_MS) != 0) {
+        printf("[Pharmacy] Lock set not available within %dms (holding nothing)\n", LOCK_DEADLINE_MS);
         return 1;
     }
-    printf("[Pharmacy] ACQUIRED Patient Record lock (waited for doctor to release)\n");
-    
+    printf("[Pharmacy] ACQUIRED both locks after %.2fs (waited for doctor, holding nothing)\n",
+           locks.last_wait_us / 1e6);
+
     // Simulate checking patient allergies
     Sleep(1000);
     printf("[Pharmacy] Checking patient allergies...\n");
-    
-    // STEP 2: Acquire Medication Inventory lock SECOND (SAME order as doctor!)
-    printf("[Pharmacy] Acquiring Medication Inventory lock (Step 2 - SAME order)...\n");
-    result = WaitForSingleObject(medication_inventory_mutex, 5000);  // 5s timeout
-    
-    if (result == WAIT_TIMEOUT) {
-        printf("[Pharmacy] TIMEOUT acquiring Medication lock\n");
-        ReleaseMutex(patient_record_mutex);
-        return 1;
-    }
-    printf("[Pharmacy] ACQUIRED Medication Inventory lock\n");
-    
+
     // Now holding both locks - can safely dispense
     printf("[Pharmacy] Dispensing medication (holding both locks safely)\n");
     Sleep(500);
-    
+
     // Release locks in REVERSE order
-    ReleaseMutex(medication_inventory_mutex);
-    printf("[Pharmacy] Released Medication Inventory lock\n");
-    
-    ReleaseMutex(patient_record_mutex);
-    printf("[Pharmacy] Released Patient Record lock\n");
+    lock_set_release(&locks);
+    printf("[Pharmacy] Released Medication Inventory and Patient Record locks\n");
     printf("[Pharmacy] Verification workflow complete!\n");
-    
+
+    return 0;
+}
+
+// Pharmacy clerk - each order locks several stock items, listed in random order
+DWORD WINAPI pharmacy_clerk(LPVOID arg) {
+    int clerk = (int)(INT_PTR)arg;
+    unsigned seed = clerk * 7919 + 1;
+    LockSet locks;
+    int items[ITEMS_PER_ORDER];
+
+    lock_set_init(&locks, clerk + 10);
+    for (int t = 0; t < TRANSACTIONS; t++) {
+        lock_set_clear(&locks);
+        for (int i = 0; i < ITEMS_PER_ORDER; i++) {
+            seed = seed * 1103515245u + 12345u;
+            items[i] = (seed >> 16) % STOCK_ITEMS;
+            lock_set_add(&locks, &stock_locks[items[i]]);
+        }
+        if (lock_set_acquire(&locks, LOCK_DEADLINE_MS) != 0) {
+            clerk_timeouts[clerk]++;
+            continue;
+        }
+        stock[items[0]] -= ITEMS_PER_ORDER - 1;     // dispense from one item,
+        for (int i = 1; i < ITEMS_PER_ORDER; i++)   // restock the others
+            stock[items[i]]++;
+        SwitchToThread();                           // let other clerks collide with us
+        lock_set_release(&locks);
+        if (locks.last_wait_us > clerk_worst_us[clerk]) clerk_worst_us[clerk] = locks.last_wait_us;
+    }
+    clerk_backoffs[clerk] = locks.backoffs;
     return 0;
 }
 
@@ -112,16 +148,10 @@ int main() {
     printf("=== WINDOWS - LOCK ORDERING SOLUTION (Deadlock Prevented) ===\n");
     printf("HPMS Scenario: Doctor and Pharmacy acquire locks in CONSISTENT order\n");
     printf("Protocol: ALWAYS Patient Record FIRST, Medication Inventory SECOND\n");
-    printf("Using Win32 mutexes with 5-second timeout safety net\n\n");
-    
-    // Create mutexes
-    patient_record_mutex = CreateMutex(NULL, FALSE, NULL);
-    medication_inventory_mutex = CreateMutex(NULL, FALSE, NULL);
-    
-    if (patient_record_mutex == NULL || medication_inventory_mutex == NULL) {
-        fprintf(stderr, "CreateMutex failed\n");
-        return 1;
-    }
+    printf("Using ranked lock sets: try-lock + backoff, %dms deadline per set\n\n", LOCK_DEADLINE_MS);
+
+    ranked_lock_init(&patient_record_lock, RANK_PATIENT_RECORD, "Patient Record");
+    ranked_lock_init(&medication_inventory_lock, RANK_MEDICATION, "Medication Inventory");
     
     HANDLE threads[2];
     
@@ -147,15 +177,46 @@ int main() {
         printf("\n\n=== DEADLOCK PREVENTION SUCCESS ===\n");
         printf("Result: Both doctor and pharmacy completed workflows WITHOUT deadlock\n");
         printf("Mechanism: Consistent lock ordering eliminates circular wait\n");
-        printf("  - Doctor: Patient Record (t=0s) → Medication (t=1s)\n");
-        printf("  - Pharmacy: Patient Record (waits) → Medication (after doctor)\n");
+        printf("  - Doctor: Patient Record → Medication (one set, t=0s)\n");
+        printf("  - Pharmacy: listed Medication → Patient Record, set took Patient Record first\n");
+        printf("  - Pharmacy backed off holding nothing until the doctor finished\n");
         printf("  - NO circular dependency possible\n");
     }
-    
+
     CloseHandle(threads[0]);
     CloseHandle(threads[1]);
-    CloseHandle(patient_record_mutex);
-    CloseHandle(medication_inventory_mutex);
+    ranked_lock_destroy(&patient_record_lock);
+    ranked_lock_destroy(&medication_inventory_lock);
+
+    printf("\n=== PHARMACY STRESS TEST ===\n");
+    HANDLE clerks[PHARMACY_THREADS];
+    for (int i = 0; i < STOCK_ITEMS; i++) {
+        ranked_lock_init(&stock_locks[i], RANK_STOCK_ITEM + i, "Stock item");
+        stock[i] = 100000;
+    }
+    int64_t start = ls_now_us();
+    for (int c = 0; c < PHARMACY_THREADS; c++)
+        clerks[c] = CreateThread(NULL, 0, pharmacy_clerk, (LPVOID)(INT_PTR)c, 0, NULL);
+    WaitForMultipleObjects(PHARMACY_THREADS, clerks, TRUE, INFINITE);
+    double elapsed = (ls_now_us() - start) / 1e6;
+
+    long backoffs = 0, timeouts = 0, total = 0;
+    int64_t worst = 0;
+    for (int c = 0; c < PHARMACY_THREADS; c++) {
+        CloseHandle(clerks[c]);
+        backoffs += clerk_backoffs[c];
+        timeouts += clerk_timeouts[c];
+        if (clerk_worst_us[c] > worst) worst = clerk_worst_us[c];
+    }
+    for (int i = 0; i < STOCK_ITEMS; i++) {
+        total += stock[i];
+        ranked_lock_destroy(&stock_locks[i]);
+    }
+    printf("Orders: %d, %d stock locks each in random order\n", PHARMACY_THREADS * TRANSACTIONS, ITEMS_PER_ORDER);
+    printf("Throughput: %.0f orders/s, %ld backoffs, %ld deadline misses\n",
+           PHARMACY_THREADS * TRANSACTIONS / elapsed, backoffs, timeouts);
+    printf("Worst lock set wait: %.2fms (no multi-second timeouts)\n", worst / 1000.0);
+    printf("Stock conserved: %s\n", total == (long)STOCK_ITEMS * 100000 ? "yes" : "NO");
     
     printf("\n=== WINDOWS DEADLOCK RECOVERY TOOLS ===\n");
     printf("Development: Visual Studio Concurrency Visualizer detects lock issues\n");
@@ -170,7 +231,7 @@ int main() {
     printf("\n=== HPMS BEST PRACTICES ===\n");
     printf("1. Document lock hierarchy in code comments:\n");
     printf("   /* LOCK ORDER: Patient Record → Medication → Pharmacy → Lab */\n");
-    printf("2. Use mandatory timeouts (5 seconds) on ALL lock acquisitions\n");
+    printf("2. Take multi-lock work as one ranked lock set (try-lock + backoff)\n");
     printf("3. Release locks in REVERSE order of acquisition\n");
     printf("4. Code review enforcement: Flag any inconsistent lock ordering\n");
     printf("5. Testing: Use Wait Chain (Windows) or Valgrind (Linux) during QA\n");
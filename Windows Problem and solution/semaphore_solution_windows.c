@@ -1,119 +1,170 @@
 /*
  * WINDOWS VERSION - Semaphore Solution to Resource Exhaustion
- * 
- * HPMS Scenario: Controls 20-connection database pool. Semaphore initialized to 20.
- * 100 concurrent requests arrive, but only 20 can access DB simultaneously.
- * 
+ *
+ * HPMS Scenario: Controls 20-connection database pool. 10,000 registration
+ * requests arrive at once, but only 20 can access the DB simultaneously.
+ *
  * Demonstrates: Prevents resource exhaustion by enforcing connection limit.
- * 
+ * The limit now lives in HPMS/Connection_Pool.h: a fixed set of worker
+ * threads serves a lock-free request queue, so 10,000 requests cost 20
+ * threads instead of 10,000, and critical registrations are served ahead
+ * of routine ones without starving them.
+ *
+ * Sleep() only wakes on the system timer tick (15.6ms by default), so the
+ * demo asks for a 1ms tick with timeBeginPeriod and, if the tick stays
+ * coarse anyway, stretches the connection deadline to what the measured
+ * tick makes the queue take to drain.
+ *
  * Compile:
- *   gcc semaphore_solution_windows.c -o semaphore_solution_windows.exe
+ *   gcc semaphore_solution_windows.c -o semaphore_solution_windows.exe -lwinmm
  */
 
 #include <windows.h>
+#include <mmsystem.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "../HPMS/Connection_Pool.h"
+
 #define MAX_DB_CONNECTIONS 20
-#define TOTAL_REQUESTS 100
-
-// Semaphore to limit concurrent database connections
-HANDLE db_connection_semaphore;
-
-// Simulate database access
-DWORD WINAPI patient_registration(LPVOID arg) {
-    int patient_num = *(int*)arg;
-    
-    printf("[Patient #%d] Requesting database connection...\n", patient_num);
-    
-    // WAIT on semaphore (decrement count, block if 0)
-    DWORD wait_result = WaitForSingleObject(db_connection_semaphore, 5000);  // 5s timeout
-    
-    if (wait_result == WAIT_OBJECT_0) {
-        // Successfully acquired connection slot
-        printf("[Patient #%d] ACQUIRED database connection\n", patient_num);
-        
-        // Simulate database operation (registration)
-        Sleep(500 + (rand() % 500));  // 500-1000ms
-        
-        printf("[Patient #%d] Registration complete, releasing connection\n", patient_num);
-        
-        // RELEASE semaphore (increment count)
-        ReleaseSemaphore(db_connection_semaphore, 1, NULL);
-    } else if (wait_result == WAIT_TIMEOUT) {
-        printf("[Patient #%d] TIMEOUT waiting for connection (queue too long)\n", patient_num);
-    } else {
-        printf("[Patient #%d] ERROR acquiring connection\n", patient_num);
+#define POOL_WORKERS       20
+#define TOTAL_REQUESTS     10000
+#define QUEUE_CAPACITY     16384      // per priority class, power of two
+#define REQUEST_TIMEOUT_MS 5000       // 5s to get a connection, as before
+#define TICK_SAMPLES       20         // Sleep(1) calls timed to find the real tick
+
+static const char *class_names[POOL_CLASSES] = {"Critical", "Urgent", "Routine"};
+
+typedef struct {
+    int patient_num;
+    int priority_class;
+} Registration;
+
+// Simulate database access; runs on a pool worker holding `connection`
+void patient_registration(void *arg, int connection) {
+    Registration *reg = arg;
+    int show = reg->patient_num <= 3 || reg->patient_num % 2000 == 0;
+
+    if (connection < 0) {
+        printf("[Patient #%d] TIMEOUT waiting for connection (queue too long)\n", reg->patient_num);
+        return;
     }
-    
-    free(arg);
-    return 0;
+
+    if (show)
+        printf("[Patient #%d] %s registration on DB connection %d\n",
+               reg->patient_num, class_names[reg->priority_class], connection);
+
+    // Simulate database operation (registration)
+    Sleep(5 + (reg->patient_num * 7) % 6);  // 5-10ms
+}
+
+/* What Sleep(1) really costs, in ms, rounded up */
+int measure_tick_ms(void) {
+    int64_t start = pool_now_us();
+    for (int i = 0; i < TICK_SAMPLES; i++) Sleep(1);
+    int64_t per_sleep_us = (pool_now_us() - start) / TICK_SAMPLES;
+    int tick = (int)((per_sleep_us + 999) / 1000);
+    return tick < 1 ? 1 : tick;
+}
+
+/* Deadline that still fits a full drain: each 5-10ms Sleep rounds up to whole ticks */
+int64_t request_timeout_ms(int tick_ms) {
+    int64_t per_request_ms = 0;
+    for (int k = 0; k < 6; k++) per_request_ms += (5 + k + tick_ms - 1) / tick_ms * tick_ms;
+    int64_t drain_ms = (int64_t)TOTAL_REQUESTS * per_request_ms / 6 / MAX_DB_CONNECTIONS;
+    return drain_ms * 2 > REQUEST_TIMEOUT_MS ? drain_ms * 2 : REQUEST_TIMEOUT_MS;
 }
 
 int main() {
     printf("=== WINDOWS - SEMAPHORE SOLUTION (Resource Exhaustion Fixed) ===\n");
-    printf("HPMS Scenario: 100 concurrent requests with 20-connection DB pool\n");
-    printf("Win32 CreateSemaphore limits concurrent access\n\n");
-    
-    // Create semaphore with initial count = MAX_DB_CONNECTIONS, max count = MAX_DB_CONNECTIONS
-    db_connection_semaphore = CreateSemaphore(
-        NULL,                      // Default security
-        MAX_DB_CONNECTIONS,        // Initial count (all slots available)
-        MAX_DB_CONNECTIONS,        // Maximum count
-        NULL                       // Unnamed
-    );
-    
-    if (db_connection_semaphore == NULL) {
-        fprintf(stderr, "CreateSemaphore failed\n");
+    printf("HPMS Scenario: %d concurrent requests with %d-connection DB pool\n",
+           TOTAL_REQUESTS, MAX_DB_CONNECTIONS);
+    printf("Fixed worker pool + lock-free request queue (HPMS/Connection_Pool.h)\n\n");
+
+    // Sleep(5) would otherwise last a whole 15.6ms tick
+    int fine_timer = timeBeginPeriod(1) == TIMERR_NOERROR;
+    int tick_ms = measure_tick_ms();
+    int64_t timeout_ms = request_timeout_ms(tick_ms);
+    printf("Timer tick: %dms%s; connection deadline %lldms\n", tick_ms,
+           fine_timer ? "" : " (timeBeginPeriod refused)", (long long)timeout_ms);
+
+    ConnectionPool pool;
+    if (pool_init(&pool, MAX_DB_CONNECTIONS, POOL_WORKERS, QUEUE_CAPACITY) != 0) {
+        fprintf(stderr, "pool_init failed\n");
+        if (fine_timer) timeEndPeriod(1);
         return 1;
     }
-    
-    printf("Database connection pool initialized: %d concurrent connections allowed\n\n", 
+
+    printf("Database connection pool initialized: %d concurrent connections allowed\n",
            MAX_DB_CONNECTIONS);
-    
-    HANDLE threads[TOTAL_REQUESTS];
-    
-    // Spawn 100 registration threads
+    printf("Worker threads: %d (previously one thread per request)\n\n", POOL_WORKERS);
+
+    Registration *registrations = malloc(sizeof(Registration) * TOTAL_REQUESTS);
+    if (registrations == NULL) {
+        fprintf(stderr, "malloc failed\n");
+        pool_shutdown(&pool);
+        if (fine_timer) timeEndPeriod(1);
+        return 1;
+    }
+
+    // Everyone arrives at once: 10% critical (ER), 30% urgent, 60% routine
+    int64_t start = pool_now_us();
+    int rejected = 0;
     for (int i = 0; i < TOTAL_REQUESTS; i++) {
-        int *patient_num = malloc(sizeof(int));
-        *patient_num = i + 1;
-        
-        threads[i] = CreateThread(NULL, 0, patient_registration, patient_num, 0, NULL);
-        
-        if (threads[i] == NULL) {
-            fprintf(stderr, "CreateThread failed for patient %d\n", i + 1);
+        registrations[i].patient_num = i + 1;
+        registrations[i].priority_class = i % 10 == 0 ? 0 : i % 10 <= 3 ? 1 : 2;
+        if (pool_submit(&pool, registrations[i].priority_class, patient_registration,
+                        &registrations[i], timeout_ms) != 0) {
+            printf("[Patient #%d] REJECTED: request queue full\n", i + 1);
+            rejected++;
         }
-        
-        Sleep(10);  // Small delay between arrivals
     }
-    
-    printf("\n[Main] All 100 patients arrived. Waiting for all registrations...\n\n");
-    
-    // Wait for all threads to complete
-    WaitForMultipleObjects(TOTAL_REQUESTS, threads, TRUE, INFINITE);
-    
-    // Clean up
-    for (int i = 0; i < TOTAL_REQUESTS; i++) {
-        CloseHandle(threads[i]);
+
+    printf("\n[Main] All %d patients queued. Waiting for all registrations...\n\n", TOTAL_REQUESTS);
+
+    // Drain the queue and stop the workers
+    pool_shutdown(&pool);
+    double elapsed = (pool_now_us() - start) / 1e6;
+    if (fine_timer) timeEndPeriod(1);
+
+    printf("\n%-10s %10s %10s %12s %12s %12s\n",
+           "Class", "Completed", "Timed out", "Wait p50", "Wait p99", "Wait max");
+    long completed = 0, expired = 0;
+    for (int c = 0; c < POOL_CLASSES; c++) {
+        PoolClassStats stats;
+        pool_stats(&pool, c, &stats);
+        completed += stats.completed;
+        expired += stats.expired;
+        printf("%-10s %10ld %10ld %10.1fms %10.1fms %10.1fms\n", class_names[c],
+               stats.completed, stats.expired,
+               lh_percentile(&stats.wait_us, 50) / 1000.0,
+               lh_percentile(&stats.wait_us, 99) / 1000.0,
+               stats.wait_us.max / 1000.0);
     }
-    CloseHandle(db_connection_semaphore);
-    
+    printf("Total: %ld registered, %ld timed out, %d rejected in %.2fs (%.0f registrations/s)\n",
+           completed, expired, rejected, elapsed, completed / elapsed);
+
+    free(registrations);
+
     printf("\n\n=== RESOURCE MANAGEMENT SUCCESS ===\n");
-    printf("Result: All 100 patients registered WITHOUT resource exhaustion\n");
-    printf("Mechanism: Semaphore enforced maximum 20 concurrent DB connections\n");
-    printf("  - First 20 patients acquired connections immediately\n");
-    printf("  - Remaining 80 patients queued and waited for available slots\n");
-    printf("  - As connections released, waiting patients acquired them\n");
+    printf("Result: %ld patients registered WITHOUT resource exhaustion\n", completed);
+    printf("Mechanism: Pool enforced maximum %d concurrent DB connections\n", MAX_DB_CONNECTIONS);
+    printf("  - %d worker threads serve every request; no thread per patient\n", POOL_WORKERS);
+    printf("  - Waiting patients sit in a lock-free queue (a few bytes each, not a stack)\n");
+    printf("  - Critical registrations get 4 of every 7 dequeues, routine still progresses\n");
+    printf("  - Requests past their %lldms deadline fail fast without taking a connection\n",
+           (long long)timeout_ms);
     printf("  - NO fork() failures, NO 'Cannot allocate memory' errors\n");
-    
+
     printf("\n=== WINDOWS SEMAPHORE CHARACTERISTICS ===\n");
     printf("Simpler multi-process setup: Handles inherit across CreateProcess hierarchy\n");
     printf("Linux comparison: Requires explicit sem_open() with shared names\n");
     printf("\nFor HPMS connection pooling:\n");
     printf("  - Windows: Named semaphore automatically shared (easier setup)\n");
     printf("  - Linux: Named semaphore requires filesystem-based coordination\n");
+    printf("  - Both: Connection_Pool.h builds on either (Win32 or pthreads)\n");
     printf("\nVerdict: Either platform suitable. Windows simpler for cross-process sharing.\n");
     printf("         Linux offers finer permission control via filesystem.\n");
-    
+
     return 0;
 }